@@ -0,0 +1,224 @@
+#pragma once
+
+#include "Types.h"
+#include "Logger.h"
+#include "PageMemory.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Terrain {
+
+// How a freshly acquired buffer is filled
+enum class BufferInit {
+    Zero,           // All elements zero
+    Uninitialized   // Unspecified contents; the caller overwrites every element
+};
+
+// A reference-counted buffer that may be owned by a BufferPool
+template<typename T>
+struct PooledBuffer {
+    Shared<PageVector<T>> data;
+    bool pooled = false; // The pool holds one extra reference
+
+    // References held outside the pool
+    long GetOwnerCount() const { return data.use_count() - (pooled ? 1 : 0); }
+};
+
+struct BufferPoolStats {
+    uint64 allocations = 0;  // Acquisitions that had to allocate
+    uint64 reuses = 0;       // Acquisitions served by an idle buffer
+    uint64 pooledBytes = 0;  // Capacity of all buffers owned by the pool
+    uint64 idleBytes = 0;    // Capacity of pooled buffers nobody else holds
+};
+
+// Size-class pool of sample buffers for Heightfield, Texture and kernel
+// scratch space. The pool keeps one reference to every buffer it hands out;
+// once that is the only reference left the buffer is idle and is handed out
+// again without clearing, so repeated executions at the same resolution stop
+// allocating (and page faulting) after the first run.
+//
+// Pooled buffers are page-mapped (see PageMemory). A fresh one is faulted in
+// by the job system's workers rather than the acquiring thread, and a reused
+// one is cleared in parallel, so on a multi-socket machine its pages are
+// spread over the nodes of the threads that will process it.
+template<typename T>
+class BufferPool {
+public:
+    static BufferPool& Get() {
+        static BufferPool instance;
+        return instance;
+    }
+
+    PooledBuffer<T> Acquire(size_t count, BufferInit init);
+
+    // Buffers are retained until the pool owns this many bytes; beyond that
+    // idle buffers are freed to make room, and if that is not enough new
+    // buffers are handed out unpooled
+    void SetMaxPooledBytes(uint64 bytes);
+
+    // Free all idle buffers
+    void Trim();
+
+    BufferPoolStats GetStats();
+    void LogStats(const char* name);
+
+private:
+    BufferPool() = default;
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Four size classes per power of two bound the wasted capacity to 25%
+    // while exact powers of two (the usual resolutions) fit exactly
+    static size_t GetClassCapacity(size_t count) {
+        size_t step = std::max<size_t>(std::bit_floor(count) / 4, 1);
+        return (count + step - 1) / step * step;
+    }
+
+    // Free idle buffers until `needed` more bytes fit (locked)
+    void ReleaseIdle(uint64 needed);
+
+    // Small buffers are cheap to allocate and not worth tracking. Pooled
+    // ones are always page-mapped, so fresh ones start zeroed.
+    static constexpr size_t kMinPooledBytes = PageMemory::kMinMappedBytes;
+
+    std::mutex m_Mutex;
+    std::unordered_map<size_t, std::vector<Shared<PageVector<T>>>> m_Classes; // By capacity
+    uint64 m_PooledBytes = 0;
+    uint64 m_MaxPooledBytes = 16ull * 1024 * 1024 * 1024; // 16 GB
+    uint64 m_Allocations = 0;
+    uint64 m_Reuses = 0;
+};
+
+template<typename T>
+PooledBuffer<T> BufferPool<T>::Acquire(size_t count, BufferInit init) {
+    PooledBuffer<T> result;
+    size_t capacity = GetClassCapacity(count);
+    uint64 bytes = static_cast<uint64>(capacity) * sizeof(T);
+
+    if (bytes < kMinPooledBytes) {
+        result.data = MakeShared<PageVector<T>>(count, T());
+        return result;
+    }
+
+    bool fresh = false;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        for (const auto& buffer : m_Classes[capacity]) {
+            if (buffer.use_count() == 1) {
+                // Pairs with the release in the last owner's reference drop
+                std::atomic_thread_fence(std::memory_order_acquire);
+                result.data = buffer;
+                result.pooled = true;
+                m_Reuses++;
+                break;
+            }
+        }
+
+        if (!result.data) {
+            fresh = true;
+            m_Allocations++;
+            if (m_PooledBytes + bytes > m_MaxPooledBytes) {
+                ReleaseIdle(bytes);
+            }
+
+            result.data = MakeShared<PageVector<T>>();
+            result.data->reserve(capacity);
+            if (m_PooledBytes + bytes <= m_MaxPooledBytes) {
+                m_Classes[capacity].push_back(result.data);
+                m_PooledBytes += bytes;
+                result.pooled = true;
+            }
+        }
+    }
+
+    // Parallel work runs outside the lock: waiting threads run other jobs,
+    // which may acquire buffers themselves.
+    // Resizing within the capacity never reallocates.
+    result.data->resize(count);
+    if (fresh) {
+        // Fresh pages are zeroed anyway
+        if (PageMemory::Get().GetOptions().parallelFirstTouch) {
+            PageMemory::Get().FirstTouch(result.data->data(), bytes);
+        }
+    } else if (init == BufferInit::Zero) {
+        T* elements = result.data->data();
+        ParallelForSamples(count, [elements](uint64 begin, uint64 end) {
+            std::fill(elements + begin, elements + end, T());
+        });
+    }
+    return result;
+}
+
+template<typename T>
+void BufferPool<T>::SetMaxPooledBytes(uint64 bytes) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_MaxPooledBytes = bytes;
+    if (m_PooledBytes > m_MaxPooledBytes) {
+        ReleaseIdle(0);
+    }
+}
+
+template<typename T>
+void BufferPool<T>::ReleaseIdle(uint64 needed) {
+    for (auto& [capacity, buffers] : m_Classes) {
+        uint64 bytes = static_cast<uint64>(capacity) * sizeof(T);
+        for (size_t i = 0; i < buffers.size() && m_PooledBytes + needed > m_MaxPooledBytes;) {
+            if (buffers[i].use_count() == 1) {
+                buffers[i] = std::move(buffers.back());
+                buffers.pop_back();
+                m_PooledBytes -= bytes;
+            } else {
+                i++;
+            }
+        }
+    }
+}
+
+template<typename T>
+void BufferPool<T>::Trim() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (auto& [capacity, buffers] : m_Classes) {
+        uint64 bytes = static_cast<uint64>(capacity) * sizeof(T);
+        auto idle = std::remove_if(buffers.begin(), buffers.end(),
+                                   [](const auto& buffer) { return buffer.use_count() == 1; });
+        m_PooledBytes -= bytes * static_cast<uint64>(std::distance(idle, buffers.end()));
+        buffers.erase(idle, buffers.end());
+    }
+}
+
+template<typename T>
+BufferPoolStats BufferPool<T>::GetStats() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    BufferPoolStats stats;
+    stats.allocations = m_Allocations;
+    stats.reuses = m_Reuses;
+    stats.pooledBytes = m_PooledBytes;
+    for (const auto& [capacity, buffers] : m_Classes) {
+        for (const auto& buffer : buffers) {
+            if (buffer.use_count() == 1) {
+                stats.idleBytes += static_cast<uint64>(capacity) * sizeof(T);
+            }
+        }
+    }
+    return stats;
+}
+
+template<typename T>
+void BufferPool<T>::LogStats(const char* name) {
+    BufferPoolStats stats = GetStats();
+    LOG_INFO("%s buffer pool: %llu allocations, %llu reuses, %.1f MB pooled (%.1f MB idle)",
+             name,
+             static_cast<unsigned long long>(stats.allocations),
+             static_cast<unsigned long long>(stats.reuses),
+             stats.pooledBytes / (1024.0 * 1024.0),
+             stats.idleBytes / (1024.0 * 1024.0));
+}
+
+} // namespace Terrain
@@ -0,0 +1,197 @@
+#include "CounterRNG.h"
+#include "Logger.h"
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+namespace Terrain {
+
+namespace {
+    constexpr uint32 kMultiplier0 = 0xD2511F53u;
+    constexpr uint32 kMultiplier1 = 0xCD9E8D57u;
+    constexpr uint32 kWeyl0 = 0x9E3779B9u;
+    constexpr uint32 kWeyl1 = 0xBB67AE85u;
+    constexpr int32 kRounds = 10;
+
+    void MulHiLo(uint32 a, uint32 b, uint32& hi, uint32& lo) {
+        uint64 product = static_cast<uint64>(a) * b;
+        hi = static_cast<uint32>(product >> 32);
+        lo = static_cast<uint32>(product);
+    }
+
+    // Philox on a lane's worth of counters at once, keeping only word 0 of
+    // each result
+#if defined(__AVX2__)
+    constexpr uint32 kLanes = 8;
+
+    __m256i MulHi(__m256i a, __m256i b) {
+        __m256i even = _mm256_mul_epu32(a, b);
+        __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b);
+        return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+    }
+
+    void PhiloxWord0(const uint32* c0, const uint32* c1, const uint32* c2, const uint32* c3,
+                     std::array<uint32, 2> key, uint32* words) {
+        __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c0));
+        __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c1));
+        __m256i x2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c2));
+        __m256i x3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c3));
+        const __m256i m0 = _mm256_set1_epi32(static_cast<int32>(kMultiplier0));
+        const __m256i m1 = _mm256_set1_epi32(static_cast<int32>(kMultiplier1));
+
+        for (int32 round = 0; round < kRounds; round++) {
+            __m256i k0 = _mm256_set1_epi32(static_cast<int32>(key[0]));
+            __m256i k1 = _mm256_set1_epi32(static_cast<int32>(key[1]));
+            __m256i hi0 = MulHi(x0, m0);
+            __m256i lo0 = _mm256_mullo_epi32(x0, m0);
+            __m256i hi1 = MulHi(x2, m1);
+            __m256i lo1 = _mm256_mullo_epi32(x2, m1);
+            x0 = _mm256_xor_si256(_mm256_xor_si256(hi1, x1), k0);
+            x1 = lo1;
+            x2 = _mm256_xor_si256(_mm256_xor_si256(hi0, x3), k1);
+            x3 = lo0;
+            key[0] += kWeyl0;
+            key[1] += kWeyl1;
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(words), x0);
+    }
+#elif defined(__SSE4_1__)
+    constexpr uint32 kLanes = 4;
+
+    __m128i MulHi(__m128i a, __m128i b) {
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), b);
+        return _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xCC);
+    }
+
+    void PhiloxWord0(const uint32* c0, const uint32* c1, const uint32* c2, const uint32* c3,
+                     std::array<uint32, 2> key, uint32* words) {
+        __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c0));
+        __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c1));
+        __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c2));
+        __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c3));
+        const __m128i m0 = _mm_set1_epi32(static_cast<int32>(kMultiplier0));
+        const __m128i m1 = _mm_set1_epi32(static_cast<int32>(kMultiplier1));
+
+        for (int32 round = 0; round < kRounds; round++) {
+            __m128i k0 = _mm_set1_epi32(static_cast<int32>(key[0]));
+            __m128i k1 = _mm_set1_epi32(static_cast<int32>(key[1]));
+            __m128i hi0 = MulHi(x0, m0);
+            __m128i lo0 = _mm_mullo_epi32(x0, m0);
+            __m128i hi1 = MulHi(x2, m1);
+            __m128i lo1 = _mm_mullo_epi32(x2, m1);
+            x0 = _mm_xor_si128(_mm_xor_si128(hi1, x1), k0);
+            x1 = lo1;
+            x2 = _mm_xor_si128(_mm_xor_si128(hi0, x3), k1);
+            x3 = lo0;
+            key[0] += kWeyl0;
+            key[1] += kWeyl1;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(words), x0);
+    }
+#endif
+}
+
+std::array<uint32, 4> CounterRNG::Generate(int64 x, int64 y) const {
+    uint64 ux = static_cast<uint64>(x);
+    uint64 uy = static_cast<uint64>(y);
+    std::array<uint32, 4> counter = { static_cast<uint32>(ux), static_cast<uint32>(ux >> 32),
+                                      static_cast<uint32>(uy), static_cast<uint32>(uy >> 32) };
+    std::array<uint32, 2> key = m_Key;
+
+    for (int32 round = 0; round < kRounds; round++) {
+        uint32 hi0, lo0, hi1, lo1;
+        MulHiLo(kMultiplier0, counter[0], hi0, lo0);
+        MulHiLo(kMultiplier1, counter[2], hi1, lo1);
+        counter = { hi1 ^ counter[1] ^ key[0], lo1, hi0 ^ counter[3] ^ key[1], lo0 };
+        key[0] += kWeyl0;
+        key[1] += kWeyl1;
+    }
+    return counter;
+}
+
+void CounterRNG::FillFloats(int64 x0, int64 y, float32* dest, uint32 count) const {
+    uint32 i = 0;
+#if defined(__AVX2__) || defined(__SSE4_1__)
+    {
+        uint64 uy = static_cast<uint64>(y);
+        uint32 c0[kLanes], c1[kLanes], c2[kLanes], c3[kLanes], words[kLanes];
+        for (uint32 lane = 0; lane < kLanes; lane++) {
+            c2[lane] = static_cast<uint32>(uy);
+            c3[lane] = static_cast<uint32>(uy >> 32);
+        }
+        for (; i + kLanes <= count; i += kLanes) {
+            for (uint32 lane = 0; lane < kLanes; lane++) {
+                uint64 ux = static_cast<uint64>(x0 + i + lane);
+                c0[lane] = static_cast<uint32>(ux);
+                c1[lane] = static_cast<uint32>(ux >> 32);
+            }
+            PhiloxWord0(c0, c1, c2, c3, m_Key, words);
+            for (uint32 lane = 0; lane < kLanes; lane++) {
+                dest[i + lane] = ToUnitFloat(words[lane]);
+            }
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        dest[i] = GetFloat(x0 + i, y);
+    }
+}
+
+bool CounterRNG::SelfTest() {
+    // Philox4x32-10 known answers from Random123 (kat_vectors): counter
+    // words and key in, four words out. Words 0-1 of the counter are x and
+    // words 2-3 are y.
+    struct KnownAnswer {
+        uint32 counter[4];
+        uint32 key[2];
+        uint32 result[4];
+    };
+    const KnownAnswer knownAnswers[] = {
+        { { 0x00000000u, 0x00000000u, 0x00000000u, 0x00000000u }, { 0x00000000u, 0x00000000u },
+          { 0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u } },
+        { { 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu }, { 0xffffffffu, 0xffffffffu },
+          { 0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu } },
+        { { 0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u }, { 0xa4093822u, 0x299f31d0u },
+          { 0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u } },
+    };
+
+    bool passed = true;
+    for (const KnownAnswer& answer : knownAnswers) {
+        int64 x = static_cast<int64>(static_cast<uint64>(answer.counter[1]) << 32 | answer.counter[0]);
+        int64 y = static_cast<int64>(static_cast<uint64>(answer.counter[3]) << 32 | answer.counter[2]);
+        std::array<uint32, 4> result = CounterRNG(answer.key[0], answer.key[1]).Generate(x, y);
+        for (uint32 word = 0; word < 4; word++) {
+            if (result[word] != answer.result[word]) {
+                LOG_ERROR("CounterRNG: Philox word %u for key %08x %08x is %08x, expected %08x", word, answer.key[0],
+                          answer.key[1], result[word], answer.result[word]);
+                passed = false;
+            }
+        }
+    }
+
+    // A span that is not a whole number of lanes, crossing x = 0 and the
+    // 32-bit boundary of the counter's low word
+    const CounterRNG rng(42, 3);
+    const int64 starts[] = { -37, (int64(1) << 32) - 37 };
+    const int64 rows[] = { 0, -5 };
+    constexpr uint32 kCount = 83;
+    float32 values[kCount];
+    for (int64 y : rows) {
+        for (int64 x0 : starts) {
+            rng.FillFloats(x0, y, values, kCount);
+            for (uint32 i = 0; i < kCount; i++) {
+                if (values[i] != rng.GetFloat(x0 + i, y)) {
+                    LOG_ERROR("CounterRNG: FillFloats differs from GetFloat at (%lld, %lld)",
+                              static_cast<long long>(x0 + i), static_cast<long long>(y));
+                    passed = false;
+                    break;
+                }
+            }
+        }
+    }
+    return passed;
+}
+
+} // namespace Terrain
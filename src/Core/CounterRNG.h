@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Types.h"
+#include <array>
+
+namespace Terrain {
+
+// Counter-based random numbers: Philox4x32-10 (Salmon et al., "Parallel
+// Random Numbers: As Easy as 1, 2, 3", SC 2011). There is no state to
+// advance: the numbers for a counter are a pure function of (seed, stream,
+// x, y), so any thread can generate any sample in any order and get the
+// same value. Generators use the sample's texel as (x, y), which makes
+// their output independent of the thread count and of how the image or
+// world is cut into tiles.
+//
+// Streams give one seed several independent sequences (e.g. one per
+// parameter a sample draws).
+class CounterRNG {
+public:
+    explicit CounterRNG(uint32 seed, uint32 stream = 0) : m_Key{ seed, stream } {}
+
+    // Four independent random words for counter (x, y)
+    std::array<uint32, 4> Generate(int64 x, int64 y) const;
+
+    uint32 GetUInt(int64 x, int64 y) const { return Generate(x, y)[0]; }
+    float32 GetFloat(int64 x, int64 y) const { return ToUnitFloat(GetUInt(x, y)); } // [0, 1)
+
+    // GetFloat for counters (x0 + i, y), i in [0, count), several counters
+    // at a time on SIMD lanes where the build allows
+    void FillFloats(int64 x0, int64 y, float32* dest, uint32 count) const;
+
+    // Top 24 bits as a float in [0, 1)
+    static float32 ToUnitFloat(uint32 bits) { return static_cast<float32>(bits >> 8) * (1.0f / 16777216.0f); }
+
+    // Check Generate against the Random123 known answers and FillFloats'
+    // SIMD lanes against GetFloat. Every seeded node depends on both, so a
+    // mismatch is logged as an error.
+    static bool SelfTest();
+
+private:
+    std::array<uint32, 2> m_Key;
+};
+
+} // namespace Terrain
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Types.h"
+#include <type_traits>
+
+namespace Terrain {
+
+// Incremental 64-bit FNV-1a hasher used to build content keys (node
+// parameters, input hashes). Values are hashed by their bytes, so add
+// struct members individually rather than whole structs with padding.
+class Hasher {
+public:
+    void AddBytes(const void* data, size_t size) {
+        const uint8* bytes = static_cast<const uint8*>(data);
+        for (size_t i = 0; i < size; i++) {
+            m_Hash ^= bytes[i];
+            m_Hash *= kPrime;
+        }
+    }
+
+    template<typename T>
+    void Add(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>, "Hasher::Add requires a trivially copyable type");
+        AddBytes(&value, sizeof(T));
+    }
+
+    void Add(const String& value) {
+        Add(static_cast<uint64>(value.size()));
+        AddBytes(value.data(), value.size());
+    }
+
+    // Final hash; never 0 so callers can use 0 as "no hash"
+    uint64 Get() const {
+        // Final avalanche (splitmix64) so similar inputs spread over all bits
+        uint64 h = m_Hash;
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebull;
+        h ^= h >> 31;
+        return h != 0 ? h : 1;
+    }
+
+private:
+    static constexpr uint64 kOffsetBasis = 0xcbf29ce484222325ull;
+    static constexpr uint64 kPrime = 0x100000001b3ull;
+
+    uint64 m_Hash = kOffsetBasis;
+};
+
+} // namespace Terrain
@@ -0,0 +1,306 @@
+#include "JobSystem.h"
+#include "Logger.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Terrain {
+
+namespace {
+    thread_local int32 t_WorkerIndex = -1;
+}
+
+JobSystem::JobSystem() {
+    Start(0);
+}
+
+JobSystem::~JobSystem() {
+    Stop();
+}
+
+void JobSystem::SetWorkerCount(uint32 workerCount) {
+    Stop();
+    Start(workerCount);
+}
+
+void JobSystem::SetThreadPinning(bool pin) {
+    Stop();
+    m_PinThreads = pin;
+    Start(m_RequestedWorkers);
+}
+
+void JobSystem::Start(uint32 workerCount) {
+    m_RequestedWorkers = workerCount;
+    if (workerCount == 0) {
+        uint32 hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    m_Queues.clear();
+    for (uint32 i = 0; i < workerCount + 1; i++) {
+        m_Queues.push_back(MakeUnique<WorkQueue>());
+    }
+
+    m_Running = true;
+    for (uint32 i = 0; i < workerCount; i++) {
+        m_Workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+    if (m_PinThreads) {
+        PinWorkers();
+    }
+
+    LOG_INFO("Job system started with %u worker threads%s", workerCount, m_PinThreads ? " (pinned)" : "");
+}
+
+void JobSystem::PinWorkers() {
+    // Worker i gets the (i + 1)th CPU the process may run on, leaving the
+    // first to the main thread; with more workers than CPUs they wrap
+#ifdef _WIN32
+    DWORD_PTR processMask = 0;
+    DWORD_PTR systemMask = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+    std::vector<uint32> cpus;
+    for (uint32 cpu = 0; cpu < sizeof(DWORD_PTR) * 8; cpu++) {
+        if (processMask & (DWORD_PTR(1) << cpu)) {
+            cpus.push_back(cpu);
+        }
+    }
+#elif defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    std::vector<uint32> cpus;
+    for (uint32 cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            cpus.push_back(cpu);
+        }
+    }
+#else
+    std::vector<uint32> cpus;
+#endif
+
+    if (cpus.empty()) {
+        LOG_WARN("Thread pinning is not supported here; workers stay unpinned");
+        return;
+    }
+
+    for (size_t i = 0; i < m_Workers.size(); i++) {
+        uint32 cpu = cpus[(i + 1) % cpus.size()];
+#ifdef _WIN32
+        SetThreadAffinityMask(m_Workers[i].native_handle(), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (pthread_setaffinity_np(m_Workers[i].native_handle(), sizeof(set), &set) != 0) {
+            LOG_WARN("Failed to pin worker %zu to CPU %u", i, cpu);
+        }
+#endif
+    }
+}
+
+void JobSystem::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_Running = false;
+    }
+    m_WakeCondition.notify_all();
+
+    for (auto& worker : m_Workers) {
+        worker.join();
+    }
+    m_Workers.clear();
+
+    // Drain anything left so no counter waits forever
+    QueuedJob queued;
+    while (TryPop(queued) || TrySteal(0, queued)) {
+        Run(queued);
+    }
+}
+
+int32 JobSystem::GetCurrentWorkerIndex() {
+    return t_WorkerIndex;
+}
+
+void JobSystem::Submit(JobCounter& counter, Job job) {
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+    // No workers: run inline
+    if (m_Workers.empty()) {
+        job();
+        counter.pending.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+
+    // Count the job before it becomes visible so the counter never underflows
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_QueuedJobs.fetch_add(1, std::memory_order_release);
+    }
+
+    // Workers push to their own deque, other threads to the injection queue
+    int32 worker = t_WorkerIndex;
+    WorkQueue& queue = worker >= 0 ? *m_Queues[worker] : *m_Queues.back();
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back({ std::move(job), &counter });
+    }
+
+    m_WakeCondition.notify_one();
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+    while (!counter.IsDone()) {
+        if (!TryRunOne()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::TryPop(QueuedJob& out) {
+    int32 worker = t_WorkerIndex;
+    WorkQueue& queue = worker >= 0 ? *m_Queues[worker] : *m_Queues.back();
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty()) {
+        return false;
+    }
+
+    // Owner takes the most recent job
+    out = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    return true;
+}
+
+bool JobSystem::TrySteal(uint32 thiefIndex, QueuedJob& out) {
+    uint32 queueCount = static_cast<uint32>(m_Queues.size());
+
+    // Start at a different victim per thief to spread contention
+    for (uint32 i = 0; i < queueCount; i++) {
+        WorkQueue& queue = *m_Queues[(thiefIndex + i + 1) % queueCount];
+
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            // Thieves take the oldest job
+            out = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobSystem::TryRunOne() {
+    QueuedJob queued;
+    int32 worker = t_WorkerIndex;
+    uint32 thiefIndex = worker >= 0 ? static_cast<uint32>(worker) : static_cast<uint32>(m_Queues.size() - 1);
+
+    if (TryPop(queued) || TrySteal(thiefIndex, queued)) {
+        Run(queued);
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::Run(QueuedJob& queued) {
+    m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    queued.job();
+    queued.counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::WorkerLoop(uint32 index) {
+    t_WorkerIndex = static_cast<int32>(index);
+
+    while (true) {
+        if (TryRunOne()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        m_WakeCondition.wait(lock, [this]() {
+            return !m_Running || m_QueuedJobs.load(std::memory_order_acquire) > 0;
+        });
+
+        if (!m_Running) {
+            break;
+        }
+    }
+
+    t_WorkerIndex = -1;
+}
+
+// ============================================================================
+// Parallel loops
+// ============================================================================
+
+void ParallelFor(uint32 begin, uint32 end, uint32 grain,
+                 const std::function<void(uint32, uint32)>& fn) {
+    if (end <= begin) {
+        return;
+    }
+
+    JobSystem& jobs = JobSystem::Get();
+    uint32 count = end - begin;
+
+    if (grain == 0) {
+        grain = std::max(1u, count / (jobs.GetThreadCount() * 4));
+    }
+
+    if (count <= grain || jobs.GetThreadCount() == 1) {
+        fn(begin, end);
+        return;
+    }
+
+    JobCounter counter;
+    for (uint32 chunkBegin = begin; chunkBegin < end; chunkBegin += grain) {
+        uint32 chunkEnd = std::min(end, chunkBegin + grain);
+        jobs.Submit(counter, [&fn, chunkBegin, chunkEnd]() {
+            fn(chunkBegin, chunkEnd);
+        });
+
+        // Guard against overflow at the top of the range
+        if (chunkEnd == end) {
+            break;
+        }
+    }
+    jobs.Wait(counter);
+}
+
+void ParallelForRows(uint32 height, const std::function<void(uint32, uint32)>& fn) {
+    ParallelFor(0, height, 0, fn);
+}
+
+void ParallelForSamples(uint64 count, const std::function<void(uint64, uint64)>& fn) {
+    // Split into fixed chunks first so the chunk indices fit in 32 bits
+    constexpr uint64 kChunkSize = 16 * 1024;
+    uint64 chunkCount = (count + kChunkSize - 1) / kChunkSize;
+
+    ParallelFor(0, static_cast<uint32>(chunkCount), 0, [&](uint32 chunkBegin, uint32 chunkEnd) {
+        fn(chunkBegin * kChunkSize, std::min(count, chunkEnd * kChunkSize));
+    });
+}
+
+void ParallelForTiles(uint32 width, uint32 height, uint32 tileSize,
+                      const std::function<void(uint32, uint32, uint32, uint32)>& fn) {
+    if (width == 0 || height == 0 || tileSize == 0) {
+        return;
+    }
+
+    uint32 tilesX = (width + tileSize - 1) / tileSize;
+    uint32 tilesY = (height + tileSize - 1) / tileSize;
+
+    ParallelFor(0, tilesX * tilesY, 1, [&](uint32 tileBegin, uint32 tileEnd) {
+        for (uint32 tile = tileBegin; tile < tileEnd; tile++) {
+            uint32 x0 = (tile % tilesX) * tileSize;
+            uint32 y0 = (tile / tilesX) * tileSize;
+            fn(x0, y0, std::min(width, x0 + tileSize), std::min(height, y0 + tileSize));
+        }
+    });
+}
+
+} // namespace Terrain
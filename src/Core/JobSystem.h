@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Types.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace Terrain {
+
+// Tracks completion of a group of submitted jobs
+struct JobCounter {
+    std::atomic<uint32> pending{0};
+
+    bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Work-stealing job system.
+// Every worker owns a deque: it pushes and pops its own jobs at the back
+// (LIFO, cache-warm) while idle workers steal from the front of other
+// workers' deques (FIFO, oldest and usually largest work first). Threads that
+// are not workers submit into a shared injection queue. Waiting on a counter
+// executes pending jobs instead of blocking, so jobs may submit and wait on
+// nested work (e.g. a node running on a worker calling ParallelFor).
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+
+    static JobSystem& Get() {
+        static JobSystem instance;
+        return instance;
+    }
+
+    // Number of threads that execute jobs (workers + the waiting caller)
+    uint32 GetThreadCount() const { return static_cast<uint32>(m_Workers.size()) + 1; }
+
+    // Restart with a different worker count (0 = hardware concurrency - 1)
+    void SetWorkerCount(uint32 workerCount);
+
+    // Restart with every worker pinned to its own CPU (or unpinned). Pinned
+    // workers stay on the NUMA node holding the pages they first touched.
+    // Ignored on platforms without thread affinity.
+    void SetThreadPinning(bool pin);
+    bool IsThreadPinning() const { return m_PinThreads; }
+
+    // Submit a job; the counter is decremented when it finishes
+    void Submit(JobCounter& counter, Job job);
+
+    // Execute jobs until the counter reaches zero
+    void Wait(JobCounter& counter);
+
+    // Returns the calling worker's index, or -1 for non-worker threads
+    static int32 GetCurrentWorkerIndex();
+
+private:
+    JobSystem();
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    struct QueuedJob {
+        Job job;
+        JobCounter* counter = nullptr;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<QueuedJob> jobs;
+    };
+
+    void Start(uint32 workerCount);
+    void Stop();
+    void PinWorkers();
+    void WorkerLoop(uint32 index);
+
+    bool TryPop(QueuedJob& out);
+    bool TrySteal(uint32 thiefIndex, QueuedJob& out);
+    bool TryRunOne();
+    void Run(QueuedJob& queued);
+
+    std::vector<std::thread> m_Workers;
+    std::vector<Unique<WorkQueue>> m_Queues; // one per worker + injection queue (last)
+
+    std::mutex m_SleepMutex;
+    std::condition_variable m_WakeCondition;
+    std::atomic<uint32> m_QueuedJobs{0};
+    std::atomic<bool> m_Running{false};
+    uint32 m_RequestedWorkers = 0;
+    bool m_PinThreads = false;
+};
+
+// Split [begin, end) into chunks of at most `grain` items and run
+// fn(chunkBegin, chunkEnd) for each chunk on the job system.
+// Chunk boundaries depend only on the range and grain (never on the thread
+// count), so per-chunk work is identical to a serial loop. grain == 0 picks a
+// grain that gives every thread a few chunks to balance load.
+void ParallelFor(uint32 begin, uint32 end, uint32 grain,
+                 const std::function<void(uint32, uint32)>& fn);
+
+// Run fn(rowBegin, rowEnd) over the rows of a width x height image
+void ParallelForRows(uint32 height, const std::function<void(uint32, uint32)>& fn);
+
+// Run fn(sampleBegin, sampleEnd) over [0, count) in contiguous ranges.
+// 64-bit so it covers heightfields of more than 2^32 samples.
+void ParallelForSamples(uint64 count, const std::function<void(uint64, uint64)>& fn);
+
+// Run fn(x0, y0, x1, y1) over tileSize x tileSize tiles of an image
+void ParallelForTiles(uint32 width, uint32 height, uint32 tileSize,
+                      const std::function<void(uint32, uint32, uint32, uint32)>& fn);
+
+} // namespace Terrain
@@ -0,0 +1,192 @@
+#include "MappedFile.h"
+#include "Logger.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Terrain {
+
+Shared<MappedFile> MappedFile::Create(const String& path, uint64 size, const MapOptions& options) {
+    Shared<MappedFile> file(new MappedFile());
+    if (!file->Map(path, size, MapMode::Shared, true)) {
+        return nullptr;
+    }
+    file->Advise(options.access);
+    if (options.hugePages) {
+        file->AdviseHugePages();
+    }
+    return file;
+}
+
+Shared<MappedFile> MappedFile::Open(const String& path, MapMode mode, const MapOptions& options) {
+    Shared<MappedFile> file(new MappedFile());
+    if (!file->Map(path, 0, mode, false)) {
+        return nullptr;
+    }
+    file->Advise(options.access);
+    if (options.hugePages) {
+        file->AdviseHugePages();
+    }
+    return file;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Map(const String& path, uint64 size, MapMode mode, bool create) {
+    m_Path = path;
+    m_Mode = mode;
+
+    DWORD access = (create || mode == MapMode::Shared) ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ;
+    HANDLE file = CreateFileA(path.c_str(), access, FILE_SHARE_READ, nullptr,
+                              create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        LOG_ERROR("Failed to open %s for mapping", path.c_str());
+        return false;
+    }
+    m_File = file;
+
+    if (!create) {
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        size = static_cast<uint64>(fileSize.QuadPart);
+    }
+    m_Size = size;
+    if (size == 0) {
+        return true;
+    }
+
+    // Private mappings are copy-on-write views of a read-only file
+    DWORD protect = mode == MapMode::Shared ? PAGE_READWRITE : PAGE_WRITECOPY;
+    HANDLE mapping = CreateFileMappingA(file, nullptr, protect,
+                                        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+    if (!mapping) {
+        LOG_ERROR("Failed to create mapping for %s", path.c_str());
+        return false;
+    }
+    m_Mapping = mapping;
+
+    m_Data = MapViewOfFile(mapping, mode == MapMode::Shared ? FILE_MAP_WRITE : FILE_MAP_COPY, 0, 0, size);
+    if (!m_Data) {
+        LOG_ERROR("Failed to map %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+MappedFile::~MappedFile() {
+    if (m_Data) {
+        UnmapViewOfFile(m_Data);
+    }
+    if (m_Mapping) {
+        CloseHandle(m_Mapping);
+    }
+    if (m_File) {
+        CloseHandle(m_File);
+    }
+}
+
+bool MappedFile::Sync() {
+    if (!m_Data || m_Mode == MapMode::Private) {
+        return true;
+    }
+    return FlushViewOfFile(m_Data, 0) && FlushFileBuffers(m_File);
+}
+
+void MappedFile::Advise(MapAccess access) {
+    (void)access;
+}
+
+void MappedFile::AdviseHugePages() {
+}
+
+#else
+
+bool MappedFile::Map(const String& path, uint64 size, MapMode mode, bool create) {
+    m_Path = path;
+    m_Mode = mode;
+
+    int flags = create ? (O_RDWR | O_CREAT | O_TRUNC) : (mode == MapMode::Shared ? O_RDWR : O_RDONLY);
+    m_File = open(path.c_str(), flags, 0644);
+    if (m_File < 0) {
+        LOG_ERROR("Failed to open %s for mapping", path.c_str());
+        return false;
+    }
+
+    if (create) {
+        if (ftruncate(m_File, static_cast<off_t>(size)) != 0) {
+            LOG_ERROR("Failed to size %s to %llu bytes", path.c_str(), static_cast<unsigned long long>(size));
+            return false;
+        }
+    } else {
+        struct stat info;
+        if (fstat(m_File, &info) != 0) {
+            LOG_ERROR("Failed to stat %s", path.c_str());
+            return false;
+        }
+        size = static_cast<uint64>(info.st_size);
+    }
+    m_Size = size;
+    if (size == 0) {
+        return true;
+    }
+
+    // Private mappings are copy-on-write: pages are only copied when written
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      mode == MapMode::Shared ? MAP_SHARED : MAP_PRIVATE, m_File, 0);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("Failed to map %s", path.c_str());
+        return false;
+    }
+    m_Data = data;
+    return true;
+}
+
+MappedFile::~MappedFile() {
+    if (m_Data) {
+        munmap(m_Data, m_Size);
+    }
+    if (m_File >= 0) {
+        close(m_File);
+    }
+}
+
+bool MappedFile::Sync() {
+    if (!m_Data || m_Mode == MapMode::Private) {
+        return true;
+    }
+    return msync(m_Data, m_Size, MS_SYNC) == 0;
+}
+
+void MappedFile::Advise(MapAccess access) {
+    if (!m_Data) {
+        return;
+    }
+
+    int advice = MADV_NORMAL;
+    if (access == MapAccess::Sequential) {
+        advice = MADV_SEQUENTIAL;
+    } else if (access == MapAccess::Random) {
+        advice = MADV_RANDOM;
+    }
+    madvise(m_Data, m_Size, advice);
+}
+
+void MappedFile::AdviseHugePages() {
+#ifdef MADV_HUGEPAGE
+    // Only honoured where the kernel supports huge pages for the backing
+    // filesystem (e.g. tmpfs); elsewhere it is a harmless no-op
+    if (m_Data) {
+        madvise(m_Data, m_Size, MADV_HUGEPAGE);
+    }
+#endif
+}
+
+#endif
+
+} // namespace Terrain
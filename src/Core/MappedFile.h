@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Types.h"
+
+namespace Terrain {
+
+// How the pages of a mapping will be touched, passed to madvise
+enum class MapAccess {
+    Normal,
+    Sequential,  // Streamed front to back: read ahead aggressively, drop behind
+    Random       // Scattered reads: no read-ahead
+};
+
+enum class MapMode {
+    Shared,  // Writes go to the file (msync to make them durable)
+    Private  // Writes stay in this process; the file is never modified
+};
+
+struct MapOptions {
+    MapAccess access = MapAccess::Sequential;
+    bool hugePages = false;  // Ask for transparent huge pages where supported
+};
+
+// A file mapped into memory. On platforms without madvise the access and
+// huge page hints are ignored.
+class MappedFile {
+public:
+    // Create (or truncate) the file at the given size and map it shared
+    static Shared<MappedFile> Create(const String& path, uint64 size, const MapOptions& options = MapOptions());
+
+    // Map an existing file
+    static Shared<MappedFile> Open(const String& path, MapMode mode, const MapOptions& options = MapOptions());
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void* GetData() const { return m_Data; }
+    uint64 GetSize() const { return m_Size; }
+    const String& GetPath() const { return m_Path; }
+    MapMode GetMode() const { return m_Mode; }
+
+    // Write dirty pages back to the file and wait for completion
+    // (no-op for private mappings)
+    bool Sync();
+
+    void Advise(MapAccess access);
+
+private:
+    MappedFile() = default;
+
+    bool Map(const String& path, uint64 size, MapMode mode, bool create);
+    void AdviseHugePages();
+
+    String m_Path;
+    void* m_Data = nullptr;
+    uint64 m_Size = 0;
+    MapMode m_Mode = MapMode::Shared;
+
+#ifdef _WIN32
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#else
+    int m_File = -1;
+#endif
+};
+
+} // namespace Terrain
@@ -0,0 +1,156 @@
+#include "PageMemory.h"
+#include "JobSystem.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Terrain {
+
+namespace {
+    constexpr uint64 kPageBytes = 4096;
+
+    uint64 AlignUp(uint64 value, uint64 alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+uint64 PageMemory::GetMappedSize(uint64 bytes) {
+    // Whole huge pages from 2 MB up, so either kind of page can back them
+    return AlignUp(bytes, bytes >= kHugePageBytes ? kHugePageBytes : kPageBytes);
+}
+
+void* PageMemory::Allocate(uint64 bytes) {
+    if (bytes < kMinMappedBytes) {
+        return ::operator new(bytes);
+    }
+
+    uint64 size = GetMappedSize(bytes);
+    void* data = Map(size);
+    if (!data) {
+        throw std::bad_alloc();
+    }
+    m_MappedBytes += size;
+    m_Mappings++;
+    return data;
+}
+
+void PageMemory::Free(void* data, uint64 bytes) {
+    if (!data) {
+        return;
+    }
+    if (bytes < kMinMappedBytes) {
+        ::operator delete(data);
+        return;
+    }
+
+    uint64 size = GetMappedSize(bytes);
+    Unmap(data, size);
+    m_MappedBytes -= size;
+}
+
+void PageMemory::FirstTouch(void* data, uint64 bytes) {
+    uint8* base = static_cast<uint8*>(data);
+    uint64 blockCount = (bytes + kHugePageBytes - 1) / kHugePageBytes;
+
+    // The memory is already zero: writing a zero faults a page in on the
+    // writing thread without changing its contents
+    ParallelFor(0, static_cast<uint32>(blockCount), 1, [&](uint32 blockBegin, uint32 blockEnd) {
+        uint64 end = std::min(bytes, static_cast<uint64>(blockEnd) * kHugePageBytes);
+        for (uint64 offset = static_cast<uint64>(blockBegin) * kHugePageBytes; offset < end; offset += kPageBytes) {
+            reinterpret_cast<volatile uint8*>(base)[offset] = 0;
+        }
+    });
+}
+
+PageMemoryStats PageMemory::GetStats() const {
+    PageMemoryStats stats;
+    stats.mappedBytes = m_MappedBytes.load();
+    stats.mappings = m_Mappings.load();
+    stats.hugeTlbMappings = m_HugeTlbMappings.load();
+    stats.hugeTlbFallbacks = m_HugeTlbFallbacks.load();
+    return stats;
+}
+
+void PageMemory::LogStats() const {
+    PageMemoryStats stats = GetStats();
+    LOG_INFO("Page memory: %llu mappings (%llu from the huge page pool, %llu fell back), %.1f MB mapped",
+             static_cast<unsigned long long>(stats.mappings),
+             static_cast<unsigned long long>(stats.hugeTlbMappings),
+             static_cast<unsigned long long>(stats.hugeTlbFallbacks),
+             stats.mappedBytes / (1024.0 * 1024.0));
+}
+
+#ifdef _WIN32
+
+void* PageMemory::Map(uint64 size) {
+    // Committed pages are zero and only backed once touched. Large pages
+    // need a privilege most accounts lack, so the huge page options are
+    // ignored here.
+    return VirtualAlloc(nullptr, static_cast<SIZE_T>(size), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+void PageMemory::Unmap(void* data, uint64 size) {
+    (void)size;
+    VirtualFree(data, 0, MEM_RELEASE);
+}
+
+#else
+
+void* PageMemory::Map(uint64 size) {
+    bool huge = size >= kHugePageBytes;
+
+#ifdef MAP_HUGETLB
+    if (huge && m_Options.explicitHugePages) {
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            m_HugeTlbMappings++;
+            return data;
+        }
+        m_HugeTlbFallbacks++;
+    }
+#endif
+
+    // Over-map by a huge page and trim, so the mapping starts on a huge
+    // page boundary and transparent huge pages can back all of it
+    uint64 slack = huge ? kHugePageBytes : 0;
+    void* mapped = mmap(nullptr, size + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+        LOG_ERROR("Failed to map %llu bytes", static_cast<unsigned long long>(size));
+        return nullptr;
+    }
+
+    uint8* base = static_cast<uint8*>(mapped);
+    uint8* data = base;
+    if (huge) {
+        data = reinterpret_cast<uint8*>(AlignUp(reinterpret_cast<uintptr_t>(base), kHugePageBytes));
+        if (data > base) {
+            munmap(base, static_cast<size_t>(data - base));
+        }
+        uint64 tail = slack - static_cast<uint64>(data - base);
+        if (tail > 0) {
+            munmap(data + size, tail);
+        }
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (huge && m_Options.transparentHugePages) {
+        madvise(data, size, MADV_HUGEPAGE);
+    }
+#endif
+    return data;
+}
+
+void PageMemory::Unmap(void* data, uint64 size) {
+    munmap(data, size);
+}
+
+#endif
+
+} // namespace Terrain
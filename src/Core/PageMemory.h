@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Types.h"
+#include <atomic>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Terrain {
+
+struct PageMemoryOptions {
+    // Ask for transparent huge pages on large allocations (madvise)
+    bool transparentHugePages = true;
+
+    // Map large allocations from the reserved huge page pool (MAP_HUGETLB),
+    // falling back to normal pages when the pool is exhausted
+    bool explicitHugePages = false;
+
+    // Fault fresh large allocations in on the job system, so their pages
+    // are spread over the NUMA nodes of the workers instead of all landing
+    // on the allocating thread's node
+    bool parallelFirstTouch = true;
+};
+
+struct PageMemoryStats {
+    uint64 mappedBytes = 0;         // Live page-mapped allocations
+    uint64 mappings = 0;            // Page-mapped allocations made
+    uint64 hugeTlbMappings = 0;     // Of those, served from the huge page pool
+    uint64 hugeTlbFallbacks = 0;    // Huge page pool requests that fell back
+};
+
+// Page-granular allocations for sample buffers. Allocations of at least
+// kMinMappedBytes are mapped straight from the OS: they start zeroed, no
+// page is touched until someone writes it, and those of at least a huge
+// page are huge page aligned so the kernel can back them with 2 MB pages
+// (one TLB entry instead of 512). Smaller ones come from the heap.
+//
+// On platforms without madvise / MAP_HUGETLB the huge page options are
+// ignored.
+class PageMemory {
+public:
+    static PageMemory& Get() {
+        static PageMemory instance;
+        return instance;
+    }
+
+    static constexpr uint64 kMinMappedBytes = 64 * 1024;
+    static constexpr uint64 kHugePageBytes = 2 * 1024 * 1024;
+
+    // Set once at startup, before large buffers are allocated
+    void SetOptions(const PageMemoryOptions& options) { m_Options = options; }
+    const PageMemoryOptions& GetOptions() const { return m_Options; }
+
+    void* Allocate(uint64 bytes);
+    void Free(void* data, uint64 bytes);
+
+    // Write one byte of every page of a fresh zeroed allocation from the job
+    // system, a huge page per job, so each page is first touched (and placed)
+    // by a worker
+    void FirstTouch(void* data, uint64 bytes);
+
+    PageMemoryStats GetStats() const;
+    void LogStats() const;
+
+private:
+    PageMemory() = default;
+    PageMemory(const PageMemory&) = delete;
+    PageMemory& operator=(const PageMemory&) = delete;
+
+    // Bytes actually mapped for a request of the given size
+    static uint64 GetMappedSize(uint64 bytes);
+
+    void* Map(uint64 size);
+    void Unmap(void* data, uint64 size);
+
+    PageMemoryOptions m_Options;
+    std::atomic<uint64> m_MappedBytes{0};
+    std::atomic<uint64> m_Mappings{0};
+    std::atomic<uint64> m_HugeTlbMappings{0};
+    std::atomic<uint64> m_HugeTlbFallbacks{0};
+};
+
+// Standard allocator over PageMemory. Elements are default-initialized, so
+// growing a vector of samples leaves its pages untouched; the first write
+// places each page on the NUMA node of the thread making it.
+template<typename T>
+struct PageAllocator {
+    using value_type = T;
+
+    PageAllocator() = default;
+    template<typename U>
+    PageAllocator(const PageAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(PageMemory::Get().Allocate(static_cast<uint64>(count) * sizeof(T)));
+    }
+
+    void deallocate(T* data, size_t count) {
+        PageMemory::Get().Free(data, static_cast<uint64>(count) * sizeof(T));
+    }
+
+    template<typename U>
+    void construct(U* element) {
+        ::new (static_cast<void*>(element)) U;
+    }
+
+    template<typename U, typename... Args>
+    void construct(U* element, Args&&... args) {
+        ::new (static_cast<void*>(element)) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    bool operator==(const PageAllocator<U>&) const { return true; }
+};
+
+// Sample storage for BufferPool. Note that vector(count) and resize() leave
+// new elements uninitialized; pass a value to fill them.
+template<typename T>
+using PageVector = std::vector<T, PageAllocator<T>>;
+
+} // namespace Terrain
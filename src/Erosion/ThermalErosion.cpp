@@ -1,10 +1,25 @@
 #include "ThermalErosion.h"
 #include "Core/Logger.h"
+#include "Core/JobSystem.h"
 #include <algorithm>
 #include <cmath>
+#include <optional>
 
 namespace Terrain {
 
+namespace {
+    struct NeighborOffset {
+        int32 dx, dy;
+    };
+
+    // Neighbor order used for the flow mask bits
+    constexpr NeighborOffset kNeighbors[8] = {
+        {-1, -1}, {0, -1}, {1, -1},
+        {-1,  0},          {1,  0},
+        {-1,  1}, {0,  1}, {1,  1}
+    };
+}
+
 ThermalErosion::ThermalErosion() {
 }
 
@@ -15,100 +30,182 @@ bool ThermalErosion::Erode(Heightfield& heightfield, const ThermalErosionParams&
     uint32 width = heightfield.GetWidth();
     uint32 height = heightfield.GetHeight();
 
-    // Create delta buffer for accumulating changes
-    Heightfield delta(width, height);
+    if (width < 3 || height < 3) {
+        return true;
+    }
 
-    for (int32 iteration = 0; iteration < params.iterations; iteration++) {
-        // Clear delta
-        for (uint32 y = 0; y < height; y++) {
-            for (uint32 x = 0; x < width; x++) {
-                delta.SetHeight(x, y, 0.0f);
-            }
-        }
+    // Erode the values, not the stored samples: apply a pending remap (and
+    // expand sparse tiles) in place, so the eroded samples written back
+    // below are not remapped a second time or replaced by a stale remap
+    heightfield.Resolve();
 
-        // Perform erosion pass
-        ErodePass(heightfield, delta, params.talusAngle, params.strength);
+    TiledHeightfield heights = ToTiled(heightfield, params.tileable ? BorderMode::Wrap : BorderMode::Clamp);
+    Run(heights, nullptr, nullptr, params);
+    heights.CopyToRowMajor(heightfield.GetDataMutable().data());
+    return true;
+}
 
-        // Apply delta
-        for (uint32 y = 0; y < height; y++) {
-            for (uint32 x = 0; x < width; x++) {
-                float h = heightfield.GetHeight(x, y);
-                float d = delta.GetHeight(x, y);
-                heightfield.SetHeight(x, y, h + d);
-            }
-        }
+bool ThermalErosion::Erode(TerrainLayerStack& layers, const ThermalErosionParams& params) {
+    if (!layers.HasLayer(TerrainLayer::Height)) {
+        LOG_ERROR("Thermal erosion needs a Height layer");
+        return false;
+    }
+
+    uint32 width = layers.GetWidth();
+    uint32 height = layers.GetHeight();
+
+    if (width < 3 || height < 3) {
+        return true;
+    }
+
+    TiledHeightfield heights(width, height, BufferInit::Uninitialized);
+    heights.CopyFromView(layers.GetLayer(TerrainLayer::Height), params.tileable ? BorderMode::Wrap : BorderMode::Clamp);
+
+    // Hardness and sediment are only read at the cell itself, so they need
+    // no halo
+    std::optional<TiledGrid<float32>> hardness;
+    if (layers.HasLayer(TerrainLayer::Hardness)) {
+        hardness.emplace(width, height, BufferInit::Uninitialized, 0);
+        hardness->CopyFromView(layers.GetLayer(TerrainLayer::Hardness), BorderMode::Clamp);
     }
 
+    layers.AddLayer(TerrainLayer::Sediment);
+    TiledGrid<float32> sediment(width, height, BufferInit::Uninitialized, 0);
+    sediment.CopyFromView(layers.GetLayer(TerrainLayer::Sediment), BorderMode::Clamp);
+
+    Run(heights, hardness ? &*hardness : nullptr, &sediment, params);
+
+    heights.CopyToView(layers.GetLayerMutable(TerrainLayer::Height));
+    sediment.CopyToView(layers.GetLayerMutable(TerrainLayer::Sediment));
     return true;
 }
 
-void ThermalErosion::ErodePass(Heightfield& heightfield, Heightfield& delta, float32 talusAngle, float32 strength) {
-    uint32 width = heightfield.GetWidth();
-    uint32 height = heightfield.GetHeight();
+void ThermalErosion::Run(TiledHeightfield& heights, const TiledGrid<float32>* hardness, TiledGrid<float32>* sediment,
+                         const ThermalErosionParams& params) {
+    uint32 width = heights.GetWidth();
+    uint32 height = heights.GetHeight();
+
+    // Erosion is computed as a gather instead of scattering into a delta
+    // buffer, so tiles can run in parallel and still produce exactly the
+    // result of the serial scatter loop. All three grids are tiled so the
+    // 3x3 neighborhoods stay within one tile and its halo.
+    //
+    // With fixed edges, border cells are never written, so the flow grids
+    // must start zeroed, and their halos outside the map are zero so nothing
+    // flows in from beyond the edge. Tileable maps wrap all three grids, so
+    // border cells erode like any other and material leaving one edge
+    // arrives at the opposite one.
+    BorderMode heightBorder = params.tileable ? BorderMode::Wrap : BorderMode::Clamp;
+    BorderMode flowBorder = params.tileable ? BorderMode::Wrap : BorderMode::Constant;
+
+    TiledGrid<float32> outflow(width, height, BufferInit::Zero);
+    TiledGrid<uint8> flowMask(width, height, BufferInit::Zero);
 
-    // For each cell
-    for (uint32 y = 1; y < height - 1; y++) {
-        for (uint32 x = 1; x < width - 1; x++) {
-            float centerHeight = heightfield.GetHeight(x, y);
-
-            // Check all 8 neighbors
-            float totalDiff = 0.0f;
-            int32 numHigher = 0;
-
-            struct Neighbor {
-                int32 dx, dy;
-                float height;
-                float diff;
-            };
-
-            Neighbor neighbors[8] = {
-                {-1, -1, 0.0f, 0.0f}, {0, -1, 0.0f, 0.0f}, {1, -1, 0.0f, 0.0f},
-                {-1,  0, 0.0f, 0.0f},                       {1,  0, 0.0f, 0.0f},
-                {-1,  1, 0.0f, 0.0f}, {0,  1, 0.0f, 0.0f}, {1,  1, 0.0f, 0.0f}
-            };
-
-            // Gather neighbor heights
-            for (int32 i = 0; i < 8; i++) {
-                int32 nx = x + neighbors[i].dx;
-                int32 ny = y + neighbors[i].dy;
-                neighbors[i].height = heightfield.GetHeight(nx, ny);
-                neighbors[i].diff = centerHeight - neighbors[i].height;
-            }
+    for (int32 iteration = 0; iteration < params.iterations; iteration++) {
+        ErodePass(heights, hardness, outflow, flowMask, params.talusAngle, params.strength, !params.tileable);
+        outflow.UpdateHalos(flowBorder);
+        flowMask.UpdateHalos(flowBorder);
 
-            // Find neighbors that are lower by more than talus angle
-            for (int32 i = 0; i < 8; i++) {
-                float distance = (neighbors[i].dx == 0 || neighbors[i].dy == 0) ? 1.0f : 1.414f; // diagonal
-                float maxDiff = talusAngle * distance; // Maximum stable height difference
+        ApplyPass(heights, sediment, outflow, flowMask);
+        heights.UpdateHalos(heightBorder);
+    }
+}
+
+void ThermalErosion::ErodePass(const TiledHeightfield& heights, const TiledGrid<float32>* hardness, TiledGrid<float32>& outflow,
+                               TiledGrid<uint8>& flowMask, float32 talusAngle, float32 strength, bool fixedEdges) {
+    uint32 width = heights.GetWidth();
+    uint32 height = heights.GetHeight();
+
+    // For each interior cell, or every cell if the edges wrap
+    heights.ForEachTile([&](uint32 index) {
+        GridTile<const float32> tile = heights.GetTile(index);
+        GridTile<float32> outflowTile = outflow.GetTile(index);
+        GridTile<uint8> maskTile = flowMask.GetTile(index);
+        GridTile<const float32> hardnessTile = hardness ? hardness->GetTile(index) : GridTile<const float32>();
+
+        int32 xBegin = fixedEdges && tile.x == 0 ? 1 : 0;
+        int32 xEnd = static_cast<int32>(fixedEdges && tile.x + tile.width == width ? tile.width - 1 : tile.width);
+        int32 yBegin = fixedEdges && tile.y == 0 ? 1 : 0;
+        int32 yEnd = static_cast<int32>(fixedEdges && tile.y + tile.height == height ? tile.height - 1 : tile.height);
+
+        for (int32 y = yBegin; y < yEnd; y++) {
+            for (int32 x = xBegin; x < xEnd; x++) {
+                float centerHeight = tile.At(x, y);
 
-                if (neighbors[i].diff > maxDiff) {
-                    totalDiff += neighbors[i].diff - maxDiff;
-                    numHigher++;
+                float totalDiff = 0.0f;
+                int32 numHigher = 0;
+                uint8 mask = 0;
+
+                // Find neighbors that are lower by more than talus angle
+                for (int32 i = 0; i < 8; i++) {
+                    float diff = centerHeight - tile.At(x + kNeighbors[i].dx, y + kNeighbors[i].dy);
+
+                    float distance = (kNeighbors[i].dx == 0 || kNeighbors[i].dy == 0) ? 1.0f : 1.414f; // diagonal
+                    float maxDiff = talusAngle * distance; // Maximum stable height difference
+
+                    if (diff > maxDiff) {
+                        totalDiff += diff - maxDiff;
+                        numHigher++;
+                        mask |= static_cast<uint8>(1u << i);
+                    }
                 }
+
+                maskTile.At(x, y) = mask;
+
+                // Material to move from center to each lower neighbor; hard
+                // ground gives up proportionally less
+                float cellStrength = hardnessTile.origin ? strength * (1.0f - std::clamp(hardnessTile.At(x, y), 0.0f, 1.0f)) : strength;
+                outflowTile.At(x, y) = numHigher > 0 ? totalDiff * cellStrength / static_cast<float>(numHigher) : 0.0f;
             }
+        }
+    });
+}
+
+void ThermalErosion::ApplyPass(TiledHeightfield& heights, TiledGrid<float32>* sediment, const TiledGrid<float32>& outflow,
+                               const TiledGrid<uint8>& flowMask) {
+    heights.ForEachTile([&](uint32 index) {
+        GridTile<float32> tile = heights.GetTile(index);
+        GridTile<float32> sedimentTile = sediment ? sediment->GetTile(index) : GridTile<float32>();
+        GridTile<const float32> outflowTile = outflow.GetTile(index);
+        GridTile<const uint8> maskTile = flowMask.GetTile(index);
+
+        for (int32 y = 0; y < static_cast<int32>(tile.height); y++) {
+            for (int32 x = 0; x < static_cast<int32>(tile.width); x++) {
+                float delta = 0.0f;
+
+                // Incoming material from the source at (x - dx, y - dy) if it
+                // flows towards this cell through its neighbor i. Sources
+                // beyond the map edge have an empty mask.
+                auto gather = [&](int32 i) {
+                    int32 sx = x - kNeighbors[i].dx;
+                    int32 sy = y - kNeighbors[i].dy;
+                    if (maskTile.At(sx, sy) & (1u << i)) {
+                        delta += outflowTile.At(sx, sy);
+                    }
+                };
 
-            if (numHigher > 0) {
-                // Material to move from center
-                float materialToMove = totalDiff * strength / static_cast<float>(numHigher);
+                // Accumulate in the order the serial scan visited the sources
+                gather(7); gather(6); gather(5); gather(4);
 
-                // Distribute to lower neighbors
+                uint8 mask = maskTile.At(x, y);
                 for (int32 i = 0; i < 8; i++) {
-                    float distance = (neighbors[i].dx == 0 || neighbors[i].dy == 0) ? 1.0f : 1.414f;
-                    float maxDiff = talusAngle * distance;
+                    if (mask & (1u << i)) {
+                        delta -= outflowTile.At(x, y);
+                    }
+                }
 
-                    if (neighbors[i].diff > maxDiff) {
-                        int32 nx = x + neighbors[i].dx;
-                        int32 ny = y + neighbors[i].dy;
+                gather(3); gather(2); gather(1); gather(0);
 
-                        float currentDelta = delta.GetHeight(nx, ny);
-                        delta.SetHeight(nx, ny, currentDelta + materialToMove);
+                tile.At(x, y) = tile.At(x, y) + delta;
 
-                        float centerDelta = delta.GetHeight(x, y);
-                        delta.SetHeight(x, y, centerDelta - materialToMove);
-                    }
+                // Loose material left behind is sediment; what leaves a cell
+                // comes out of its sediment first
+                if (sedimentTile.origin) {
+                    sedimentTile.At(x, y) = std::max(sedimentTile.At(x, y) + delta, 0.0f);
                 }
             }
         }
-    }
+    });
 }
 
 } // namespace Terrain
@@ -2,6 +2,8 @@
 
 #include "Core/Types.h"
 #include "Terrain/Heightfield.h"
+#include "Terrain/TerrainLayerStack.h"
+#include "Terrain/TiledGrid.h"
 
 namespace Terrain {
 
@@ -9,6 +11,7 @@ struct ThermalErosionParams {
     int32 iterations = 10;              // Number of passes
     float32 talusAngle = 0.7f;          // Angle of repose (in radians, ~40 degrees)
     float32 strength = 0.5f;            // Erosion strength (0-1)
+    bool tileable = false;              // Material crosses to the opposite edge; else the outer ring stays fixed
 };
 
 class ThermalErosion {
@@ -19,12 +22,30 @@ public:
     // Apply thermal erosion to heightfield (CPU-based)
     bool Erode(Heightfield& heightfield, const ThermalErosionParams& params);
 
+    // Erode the stack's Height layer. A Hardness layer, if present, scales
+    // the material leaving each cell by (1 - hardness). Material settling in
+    // a cell is added to the Sediment layer (created if missing) and
+    // material leaving it is taken from there, in the same sweeps.
+    bool Erode(TerrainLayerStack& layers, const ThermalErosionParams& params);
+
     // Get/set parameters
     const ThermalErosionParams& GetParams() const { return m_Params; }
     void SetParams(const ThermalErosionParams& params) { m_Params = params; }
 
 private:
-    void ErodePass(Heightfield& heightfield, Heightfield& delta, float32 talusAngle, float32 strength);
+    // Iterates both passes over tiled heights; hardness and sediment are
+    // optional halo-less grids of the same dimensions
+    void Run(TiledHeightfield& heights, const TiledGrid<float32>* hardness, TiledGrid<float32>* sediment,
+             const ThermalErosionParams& params);
+
+    // Computes, per cell, the material leaving it and the mask of lower
+    // neighbors receiving it (bit i = neighbor i in row-major order)
+    void ErodePass(const TiledHeightfield& heights, const TiledGrid<float32>* hardness, TiledGrid<float32>& outflow,
+                   TiledGrid<uint8>& flowMask, float32 talusAngle, float32 strength, bool fixedEdges);
+
+    // Gathers incoming and outgoing material into each cell and applies it
+    void ApplyPass(TiledHeightfield& heights, TiledGrid<float32>* sediment, const TiledGrid<float32>& outflow,
+                   const TiledGrid<uint8>& flowMask);
 
     ThermalErosionParams m_Params;
 };
@@ -18,6 +18,9 @@ struct PushConstantData {
     float32 param4;
     float32 param5;
     uint32 seed;
+    float32 param6;
+    float32 param7;
+    float32 param8;
 };
 
 class ComputePipeline {
@@ -67,13 +67,16 @@ void MeshGenerator::GenerateVertices(Mesh* mesh, const Heightfield& heightfield,
         offset.z = -(meshHeight - 1) * params.scaleZ * 0.5f;
     }
 
+    Heightfield resolved = heightfield.GetResolved();
+    HeightfieldView<const float32> heights = resolved.GetView();
+
     // Generate vertices
     for (uint32 z = 0; z < meshHeight; z++) {
+        std::span<const float32> row = heights.Row(std::min(z * lodStep, heightHeight - 1));
         for (uint32 x = 0; x < meshWidth; x++) {
             // Sample heightfield (with LOD)
             uint32 hx = std::min(x * lodStep, heightWidth - 1);
-            uint32 hz = std::min(z * lodStep, heightHeight - 1);
-            float32 height = heightfield.GetHeight(hx, hz);
+            float32 height = row[hx];
 
             // Calculate position
             glm::vec3 pos;
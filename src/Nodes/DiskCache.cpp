@@ -0,0 +1,438 @@
+#include "DiskCache.h"
+#include "Core/Hash.h"
+#include "Core/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace Terrain {
+
+namespace {
+    constexpr uint32 kMagic = 0x43484554; // "TEHC"
+    constexpr uint32 kVersion = 1;
+
+    enum class EntryKind : uint32 {
+        Heightfield = 0,
+        Texture = 1
+    };
+
+    struct EntryHeader {
+        uint32 magic = kMagic;
+        uint32 version = kVersion;
+        uint32 kind = 0;
+        uint32 width = 0;
+        uint32 height = 0;
+        uint32 format = 0;
+        uint64 rawSize = 0;   // Decoded payload size in bytes
+        uint64 checksum = 0;  // Hash of the decoded payload
+    };
+    static_assert(sizeof(EntryHeader) == 40, "EntryHeader must not contain padding");
+
+    // Run-length coding (PackBits variant). Control byte c < 128 is followed
+    // by c + 1 literal bytes; c >= 128 repeats the next byte c - 125 times.
+    void PackBits(const std::vector<uint8>& input, std::vector<uint8>& output) {
+        size_t size = input.size();
+        size_t i = 0;
+        size_t literalStart = 0;
+
+        auto flushLiterals = [&](size_t end) {
+            while (literalStart < end) {
+                size_t count = std::min<size_t>(end - literalStart, 128);
+                output.push_back(static_cast<uint8>(count - 1));
+                output.insert(output.end(), input.begin() + literalStart, input.begin() + literalStart + count);
+                literalStart += count;
+            }
+        };
+
+        while (i < size) {
+            size_t run = 1;
+            while (i + run < size && run < 130 && input[i + run] == input[i]) {
+                run++;
+            }
+
+            if (run >= 3) {
+                flushLiterals(i);
+                output.push_back(static_cast<uint8>(run + 125));
+                output.push_back(input[i]);
+                i += run;
+                literalStart = i;
+            } else {
+                i += run;
+            }
+        }
+        flushLiterals(size);
+    }
+
+    bool UnpackBits(const uint8* input, size_t size, std::vector<uint8>& output, size_t expectedSize) {
+        output.clear();
+        output.reserve(expectedSize);
+
+        size_t i = 0;
+        while (i < size) {
+            uint8 control = input[i++];
+            if (control < 128) {
+                size_t count = static_cast<size_t>(control) + 1;
+                if (i + count > size || output.size() + count > expectedSize) {
+                    return false;
+                }
+                output.insert(output.end(), input + i, input + i + count);
+                i += count;
+            } else {
+                size_t count = static_cast<size_t>(control) - 125;
+                if (i >= size || output.size() + count > expectedSize) {
+                    return false;
+                }
+                output.insert(output.end(), count, input[i++]);
+            }
+        }
+        return output.size() == expectedSize;
+    }
+
+    // Heightfields: XOR each sample's bits with its predecessor, then split
+    // into byte planes. Neighboring samples share sign, exponent and high
+    // mantissa bits, so the upper planes become long zero runs.
+    void EncodeSamples(std::span<const float32> samples, std::vector<uint8>& planes) {
+        size_t count = samples.size();
+        planes.resize(count * 4);
+
+        uint32 previous = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint32 bits;
+            std::memcpy(&bits, &samples[i], sizeof(bits));
+            uint32 delta = bits ^ previous;
+            previous = bits;
+
+            for (uint32 b = 0; b < 4; b++) {
+                planes[b * count + i] = static_cast<uint8>(delta >> (8 * b));
+            }
+        }
+    }
+
+    void DecodeSamples(const std::vector<uint8>& planes, std::span<float32> samples) {
+        size_t count = samples.size();
+
+        uint32 previous = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint32 delta = 0;
+            for (uint32 b = 0; b < 4; b++) {
+                delta |= static_cast<uint32>(planes[b * count + i]) << (8 * b);
+            }
+            uint32 bits = delta ^ previous;
+            previous = bits;
+            std::memcpy(&samples[i], &bits, sizeof(bits));
+        }
+    }
+
+    // Textures: one plane per byte of a pixel, delta coded along the plane
+    void EncodePixels(const uint8* data, size_t pixelCount, uint32 stride, std::vector<uint8>& planes) {
+        planes.resize(pixelCount * stride);
+        for (uint32 c = 0; c < stride; c++) {
+            uint8 previous = 0;
+            uint8* plane = planes.data() + c * pixelCount;
+            for (size_t i = 0; i < pixelCount; i++) {
+                uint8 value = data[i * stride + c];
+                plane[i] = static_cast<uint8>(value - previous);
+                previous = value;
+            }
+        }
+    }
+
+    void DecodePixels(const std::vector<uint8>& planes, size_t pixelCount, uint32 stride, uint8* data) {
+        for (uint32 c = 0; c < stride; c++) {
+            uint8 previous = 0;
+            const uint8* plane = planes.data() + c * pixelCount;
+            for (size_t i = 0; i < pixelCount; i++) {
+                previous = static_cast<uint8>(previous + plane[i]);
+                data[i * stride + c] = previous;
+            }
+        }
+    }
+
+    uint64 Checksum(const void* data, size_t size) {
+        Hasher hasher;
+        hasher.AddBytes(data, size);
+        return hasher.Get();
+    }
+
+    std::vector<uint8> SerializeHeader(const EntryHeader& header) {
+        std::vector<uint8> bytes(sizeof(EntryHeader));
+        std::memcpy(bytes.data(), &header, sizeof(EntryHeader));
+        return bytes;
+    }
+
+    // Parse and validate the header; payload follows it
+    bool ParseHeader(const std::vector<uint8>& contents, EntryKind kind, EntryHeader& header) {
+        if (contents.size() < sizeof(EntryHeader)) {
+            return false;
+        }
+        std::memcpy(&header, contents.data(), sizeof(EntryHeader));
+        return header.magic == kMagic && header.version == kVersion &&
+               header.kind == static_cast<uint32>(kind);
+    }
+}
+
+bool DiskCache::SetDirectory(const String& directory) {
+    if (directory.empty()) {
+        m_Directory.clear();
+        return true;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        LOG_ERROR("Failed to create disk cache directory %s: %s", directory.c_str(), error.message().c_str());
+        m_Directory.clear();
+        return false;
+    }
+
+    m_Directory = directory;
+    LOG_INFO("Disk cache enabled: %s", directory.c_str());
+    return true;
+}
+
+String DiskCache::GetEntryPath(uint64 hash) const {
+    // Shard by the top byte so no directory grows unbounded
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return m_Directory + "/" + String(name, 2) + "/" + name + ".tec";
+}
+
+bool DiskCache::Contains(uint64 hash) const {
+    if (!IsEnabled()) {
+        return false;
+    }
+    std::error_code error;
+    return std::filesystem::exists(GetEntryPath(hash), error);
+}
+
+bool DiskCache::WriteEntry(uint64 hash, const std::vector<uint8>& header, const std::vector<uint8>& payload) {
+    std::filesystem::path path = GetEntryPath(hash);
+
+    std::error_code error;
+    if (std::filesystem::exists(path, error)) {
+        return true; // Content-addressed: an existing entry is identical
+    }
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    // Unique temporary name per process and thread; rename publishes atomically
+    static std::atomic<uint64> s_TempCounter{0};
+    uint64 unique = std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+                    static_cast<uint64>(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+                    (s_TempCounter.fetch_add(1) << 48);
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%016llx.tmp", static_cast<unsigned long long>(unique));
+    std::filesystem::path tempPath = path.string() + suffix;
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_WARN("Disk cache: failed to open %s for writing", tempPath.string().c_str());
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+        file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+        if (!file.good()) {
+            file.close();
+            std::filesystem::remove(tempPath, error);
+            LOG_WARN("Disk cache: failed to write %s", tempPath.string().c_str());
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        // Another process may have published the same entry meanwhile
+        std::filesystem::remove(tempPath, error);
+        return std::filesystem::exists(path, error);
+    }
+
+    m_Writes++;
+    m_BytesWritten += header.size() + payload.size();
+    return true;
+}
+
+bool DiskCache::ReadEntry(uint64 hash, std::vector<uint8>& contents) {
+    std::ifstream file(GetEntryPath(hash), std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::streamsize size = file.tellg();
+    if (size <= 0) {
+        return false;
+    }
+    file.seekg(0);
+
+    contents.resize(static_cast<size_t>(size));
+    if (!file.read(reinterpret_cast<char*>(contents.data()), size)) {
+        return false;
+    }
+
+    m_BytesRead += static_cast<uint64>(size);
+    return true;
+}
+
+bool DiskCache::StoreHeightfield(uint64 hash, const Heightfield& heightfield) {
+    if (!IsEnabled()) {
+        return false;
+    }
+    if (Contains(hash)) {
+        return true;
+    }
+
+    // Packed or remapped samples are stored as the float32 values their
+    // readers see
+    const Heightfield* source = &heightfield;
+    Heightfield resolved(0, 0);
+    if (!heightfield.IsResolved()) {
+        resolved = heightfield;
+        resolved.Resolve();
+        source = &resolved;
+    }
+    auto samples = source->GetData();
+
+    EntryHeader header;
+    header.kind = static_cast<uint32>(EntryKind::Heightfield);
+    header.width = heightfield.GetWidth();
+    header.height = heightfield.GetHeight();
+    header.rawSize = samples.size() * sizeof(float32);
+    header.checksum = Checksum(samples.data(), header.rawSize);
+
+    std::vector<uint8> planes;
+    EncodeSamples(samples, planes);
+
+    std::vector<uint8> payload;
+    payload.reserve(planes.size() / 2);
+    PackBits(planes, payload);
+
+    return WriteEntry(hash, SerializeHeader(header), payload);
+}
+
+Unique<Heightfield> DiskCache::LoadHeightfield(uint64 hash) {
+    if (!IsEnabled()) {
+        return nullptr;
+    }
+
+    std::vector<uint8> contents;
+    EntryHeader header;
+    if (!ReadEntry(hash, contents) || !ParseHeader(contents, EntryKind::Heightfield, header) ||
+        header.rawSize != static_cast<uint64>(header.width) * header.height * sizeof(float32)) {
+        m_Misses++;
+        return nullptr;
+    }
+
+    std::vector<uint8> planes;
+    if (!UnpackBits(contents.data() + sizeof(EntryHeader), contents.size() - sizeof(EntryHeader),
+                    planes, header.rawSize)) {
+        LOG_WARN("Disk cache: corrupt entry %016llx", static_cast<unsigned long long>(hash));
+        m_Misses++;
+        return nullptr;
+    }
+
+    auto heightfield = MakeUnique<Heightfield>(header.width, header.height, BufferInit::Uninitialized);
+    auto samples = heightfield->GetDataMutable();
+    DecodeSamples(planes, samples);
+
+    if (Checksum(samples.data(), header.rawSize) != header.checksum) {
+        LOG_WARN("Disk cache: checksum mismatch in entry %016llx", static_cast<unsigned long long>(hash));
+        m_Misses++;
+        return nullptr;
+    }
+
+    m_Hits++;
+    return heightfield;
+}
+
+bool DiskCache::StoreTexture(uint64 hash, const Texture& texture) {
+    if (!IsEnabled()) {
+        return false;
+    }
+    if (Contains(hash)) {
+        return true;
+    }
+
+    EntryHeader header;
+    header.kind = static_cast<uint32>(EntryKind::Texture);
+    header.width = texture.GetWidth();
+    header.height = texture.GetHeight();
+    header.format = static_cast<uint32>(texture.GetFormat());
+    header.rawSize = texture.GetDataSize();
+    header.checksum = Checksum(texture.GetData(), header.rawSize);
+
+    std::vector<uint8> planes;
+    EncodePixels(texture.GetData(), static_cast<size_t>(texture.GetWidth()) * texture.GetHeight(),
+                 texture.GetBytesPerPixel(), planes);
+
+    std::vector<uint8> payload;
+    payload.reserve(planes.size() / 2);
+    PackBits(planes, payload);
+
+    return WriteEntry(hash, SerializeHeader(header), payload);
+}
+
+Unique<Texture> DiskCache::LoadTexture(uint64 hash) {
+    if (!IsEnabled()) {
+        return nullptr;
+    }
+
+    std::vector<uint8> contents;
+    EntryHeader header;
+    if (!ReadEntry(hash, contents) || !ParseHeader(contents, EntryKind::Texture, header) ||
+        header.format > static_cast<uint32>(TextureFormat::RGBA32F)) {
+        m_Misses++;
+        return nullptr;
+    }
+
+    auto texture = MakeUnique<Texture>(header.width, header.height, static_cast<TextureFormat>(header.format),
+                                      BufferInit::Uninitialized);
+    std::vector<uint8> planes;
+    if (header.rawSize != texture->GetDataSize() ||
+        !UnpackBits(contents.data() + sizeof(EntryHeader), contents.size() - sizeof(EntryHeader),
+                    planes, header.rawSize)) {
+        LOG_WARN("Disk cache: corrupt entry %016llx", static_cast<unsigned long long>(hash));
+        m_Misses++;
+        return nullptr;
+    }
+
+    DecodePixels(planes, static_cast<size_t>(header.width) * header.height,
+                 texture->GetBytesPerPixel(), texture->GetData());
+
+    if (Checksum(texture->GetData(), header.rawSize) != header.checksum) {
+        LOG_WARN("Disk cache: checksum mismatch in entry %016llx", static_cast<unsigned long long>(hash));
+        m_Misses++;
+        return nullptr;
+    }
+
+    m_Hits++;
+    return texture;
+}
+
+DiskCacheStats DiskCache::GetStats() const {
+    DiskCacheStats stats;
+    stats.hits = m_Hits;
+    stats.misses = m_Misses;
+    stats.writes = m_Writes;
+    stats.bytesRead = m_BytesRead;
+    stats.bytesWritten = m_BytesWritten;
+    return stats;
+}
+
+void DiskCache::LogStats() const {
+    if (!IsEnabled()) {
+        return;
+    }
+
+    DiskCacheStats stats = GetStats();
+    LOG_INFO("Disk cache: %llu hits, %llu misses, %llu writes, %.1f MB read, %.1f MB written",
+             static_cast<unsigned long long>(stats.hits),
+             static_cast<unsigned long long>(stats.misses),
+             static_cast<unsigned long long>(stats.writes),
+             stats.bytesRead / (1024.0 * 1024.0),
+             stats.bytesWritten / (1024.0 * 1024.0));
+}
+
+} // namespace Terrain
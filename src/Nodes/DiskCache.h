@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Core/Types.h"
+#include "Terrain/Heightfield.h"
+#include "Texture/Texture.h"
+#include <atomic>
+
+namespace Terrain {
+
+struct DiskCacheStats {
+    uint64 hits = 0;
+    uint64 misses = 0;
+    uint64 writes = 0;
+    uint64 bytesRead = 0;     // Compressed bytes
+    uint64 bytesWritten = 0;  // Compressed bytes
+};
+
+// Persistent content-addressed store for node results, keyed by the same
+// content hash as the NodeCache. Disabled until a directory is set.
+//
+// Entries are losslessly compressed (delta + byte planes + run-length) and
+// published by writing a temporary file and renaming it into place, so
+// several processes can share one directory: readers only ever see complete
+// files, and concurrent writers of the same hash produce identical content.
+class DiskCache {
+public:
+    static DiskCache& Get() {
+        static DiskCache instance;
+        return instance;
+    }
+
+    // Enable the cache in the given directory (created if missing).
+    // An empty path disables it.
+    bool SetDirectory(const String& directory);
+    const String& GetDirectory() const { return m_Directory; }
+    bool IsEnabled() const { return !m_Directory.empty(); }
+
+    bool Contains(uint64 hash) const;
+
+    bool StoreHeightfield(uint64 hash, const Heightfield& heightfield);
+    Unique<Heightfield> LoadHeightfield(uint64 hash);
+
+    bool StoreTexture(uint64 hash, const Texture& texture);
+    Unique<Texture> LoadTexture(uint64 hash);
+
+    DiskCacheStats GetStats() const;
+    void LogStats() const;
+
+private:
+    DiskCache() = default;
+    DiskCache(const DiskCache&) = delete;
+    DiskCache& operator=(const DiskCache&) = delete;
+
+    String GetEntryPath(uint64 hash) const;
+    bool WriteEntry(uint64 hash, const std::vector<uint8>& header, const std::vector<uint8>& payload);
+    bool ReadEntry(uint64 hash, std::vector<uint8>& contents);
+
+    String m_Directory;
+
+    std::atomic<uint64> m_Hits{0};
+    std::atomic<uint64> m_Misses{0};
+    std::atomic<uint64> m_Writes{0};
+    std::atomic<uint64> m_BytesRead{0};
+    std::atomic<uint64> m_BytesWritten{0};
+};
+
+} // namespace Terrain
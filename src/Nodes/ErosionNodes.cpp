@@ -60,6 +60,20 @@ bool HydraulicErosionNode::Execute(NodeGraph* graph) {
     return true;
 }
 
+bool HydraulicErosionNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(params.iterations);
+    hasher.Add(params.seed);
+    hasher.Add(params.inertia);
+    hasher.Add(params.sedimentCapacity);
+    hasher.Add(params.minSlope);
+    hasher.Add(params.erodeSpeed);
+    hasher.Add(params.depositSpeed);
+    hasher.Add(params.evaporateSpeed);
+    hasher.Add(params.gravity);
+    hasher.Add(params.maxDropletLifetime);
+    return true;
+}
+
 // ============================================================================
 // Thermal Erosion Node
 // ============================================================================
@@ -99,4 +113,56 @@ bool ThermalErosionNode::Execute(NodeGraph* graph) {
     return true;
 }
 
+bool ThermalErosionNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(params.iterations);
+    hasher.Add(params.talusAngle);
+    hasher.Add(params.strength);
+    hasher.Add(params.tileable);
+    return true;
+}
+
+// ============================================================================
+// Layered Thermal Erosion Node
+// ============================================================================
+
+LayeredThermalErosionNode::LayeredThermalErosionNode(uint32 id)
+    : Node(id, "Layered Thermal Erosion", NodeCategory::Filter) {
+    AddInputPin("Layers", PinType::LayerStack);
+    AddOutputPin("Layers", PinType::LayerStack);
+
+    // Default parameters
+    params.iterations = 10;
+    params.talusAngle = 0.7f; // ~40 degrees
+    params.strength = 0.5f;
+}
+
+bool LayeredThermalErosionNode::Execute(NodeGraph* graph) {
+    if (!m_Dirty) {
+        return true;
+    }
+
+    auto layers = GetInputLayerStack("Layers", graph);
+    if (!layers) {
+        LOG_ERROR("Layered thermal erosion node: no input");
+        return false;
+    }
+
+    auto erosion = MakeUnique<ThermalErosion>();
+    if (!erosion->Erode(*layers, params)) {
+        LOG_ERROR("Failed to apply layered thermal erosion");
+        return false;
+    }
+
+    SetOutputLayerStack("Layers", std::move(layers));
+    return true;
+}
+
+bool LayeredThermalErosionNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(params.iterations);
+    hasher.Add(params.talusAngle);
+    hasher.Add(params.strength);
+    hasher.Add(params.tileable);
+    return true;
+}
+
 } // namespace Terrain
@@ -3,6 +3,7 @@
 #include "Node.h"
 #include "Erosion/HydraulicErosion.h"
 #include "Erosion/ThermalErosion.h"
+#include <algorithm>
 
 namespace Terrain {
 
@@ -11,6 +12,13 @@ class HydraulicErosionNode : public Node {
 public:
     HydraulicErosionNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+
+    // Erosion amplifies small slope differences: inputs must be float32
+    float32 GetInputTolerance() const override { return 0.0f; }
+
+    // Droplets spawn anywhere in the input and travel arbitrarily far
+    bool IsRegionLocal() const override { return false; }
 
     HydraulicErosionParams params;
 };
@@ -20,6 +28,27 @@ class ThermalErosionNode : public Node {
 public:
     ThermalErosionNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+
+    // Each iteration's erode and apply passes both read one texel around
+    uint32 GetStencilRadius() const override { return 2 * static_cast<uint32>(std::max(params.iterations, 0)); }
+
+    // Talus comparisons flip on tiny height differences: inputs must be float32
+    float32 GetInputTolerance() const override { return 0.0f; }
+
+    ThermalErosionParams params;
+};
+
+// Layered Thermal Erosion Node: thermal erosion on a layer stack, held back
+// by its Hardness layer and depositing into its Sediment layer
+class LayeredThermalErosionNode : public Node {
+public:
+    LayeredThermalErosionNode(uint32 id);
+    bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+
+    // Two texels per iteration, as for ThermalErosionNode
+    uint32 GetStencilRadius() const override { return 2 * static_cast<uint32>(std::max(params.iterations, 0)); }
 
     ThermalErosionParams params;
 };
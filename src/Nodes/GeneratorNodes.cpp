@@ -1,17 +1,46 @@
 #include "GeneratorNodes.h"
 #include "NodeGraph.h"
 #include "Core/Logger.h"
-#include <random>
+#include "Core/JobSystem.h"
+#include "Core/CounterRNG.h"
 #include <cmath>
+#include <algorithm>
 
 namespace Terrain {
 
+// ============================================================================
+// Generator Node
+// ============================================================================
+
+GeneratorNode::GeneratorNode(uint32 id, const String& name)
+    : Node(id, name, NodeCategory::Generator) {
+}
+
+void GeneratorNode::SetWorldRegion(const std::optional<WorldRegion>& region) {
+    if (region == m_Region) {
+        return;
+    }
+    m_Region = region;
+    MarkDirty();
+}
+
+void GeneratorNode::HashOutput(Hasher& hasher) const {
+    hasher.Add(GetOutputWidth());
+    hasher.Add(GetOutputHeight());
+    hasher.Add(m_Region.has_value());
+    if (m_Region) {
+        hasher.Add(m_Region->texelX);
+        hasher.Add(m_Region->texelY);
+        hasher.Add(m_Region->texelSize);
+    }
+}
+
 // ============================================================================
 // Perlin Node
 // ============================================================================
 
 PerlinNode::PerlinNode(uint32 id)
-    : Node(id, "Perlin Noise", NodeCategory::Generator) {
+    : GeneratorNode(id, "Perlin Noise") {
     AddOutputPin("Output", PinType::Heightfield);
 
     // Default parameters
@@ -34,7 +63,8 @@ bool PerlinNode::Execute(NodeGraph* graph) {
         return false;
     }
 
-    auto heightfield = generator->GeneratePerlin(width, height, params);
+    auto heightfield = m_Region ? generator->GeneratePerlin(*m_Region, params)
+                                : generator->GeneratePerlin(width, height, params);
     if (!heightfield) {
         LOG_ERROR("Failed to generate Perlin noise");
         return false;
@@ -44,12 +74,23 @@ bool PerlinNode::Execute(NodeGraph* graph) {
     return true;
 }
 
+bool PerlinNode::HashParameters(Hasher& hasher) const {
+    HashOutput(hasher);
+    hasher.Add(params.frequency);
+    hasher.Add(params.amplitude);
+    hasher.Add(params.octaves);
+    hasher.Add(params.lacunarity);
+    hasher.Add(params.persistence);
+    hasher.Add(params.seed);
+    return true;
+}
+
 // ============================================================================
 // Voronoi Node
 // ============================================================================
 
 VoronoiNode::VoronoiNode(uint32 id)
-    : Node(id, "Voronoi", NodeCategory::Generator) {
+    : GeneratorNode(id, "Voronoi") {
     AddOutputPin("Output", PinType::Heightfield);
 }
 
@@ -58,48 +99,48 @@ bool VoronoiNode::Execute(NodeGraph* graph) {
         return true;
     }
 
-    auto heightfield = MakeUnique<Heightfield>(width, height);
-
-    // Generate random cell points
-    std::mt19937 rng(seed);
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-
-    std::vector<glm::vec2> cellPoints;
-    for (int i = 0; i < cellCount; i++) {
-        cellPoints.push_back(glm::vec2(dist(rng), dist(rng)));
+    WorleyParams params;
+    params.cellCount = cellCount;
+    params.jitter = jitter;
+    params.seed = seed;
+    params.output = output;
+
+    auto heightfield = MakeUnique<Heightfield>(GetOutputWidth(), GetOutputHeight(), BufferInit::Uninitialized);
+    if (m_Region) {
+        GenerateWorleyCPU(heightfield->GetViewMutable(), *m_Region, params);
+    } else {
+        GenerateWorleyCPU(heightfield->GetViewMutable(), params);
     }
 
-    // Calculate distance to nearest cell for each point
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            glm::vec2 p(static_cast<float>(x) / width, static_cast<float>(y) / height);
-
-            float minDist = FLT_MAX;
-            for (const auto& cell : cellPoints) {
-                float dist = glm::length(p - cell);
-                minDist = std::min(minDist, dist);
-            }
-
-            float value = minDist * amplitude;
-            if (invert) {
-                value = amplitude - value;
-            }
-
-            heightfield->SetHeight(x, y, value);
-        }
+    // Amplitude and inversion as one pending remap
+    SampleRemap remap;
+    remap.scale = invert ? -amplitude : amplitude;
+    remap.offset = invert ? amplitude : 0.0f;
+    heightfield->Remap(remap);
+    if (!m_Region) {
+        heightfield->Normalize(0.0f, 1.0f);
     }
-
-    heightfield->Normalize(0.0f, 1.0f);
     SetOutputHeightfield("Output", std::move(heightfield));
     return true;
 }
 
+bool VoronoiNode::HashParameters(Hasher& hasher) const {
+    HashOutput(hasher);
+    hasher.Add(cellCount);
+    hasher.Add(jitter);
+    hasher.Add(amplitude);
+    hasher.Add(seed);
+    hasher.Add(invert);
+    hasher.Add(output);
+    return true;
+}
+
 // ============================================================================
 // Ridged Node
 // ============================================================================
 
 RidgedNode::RidgedNode(uint32 id)
-    : Node(id, "Ridged Noise", NodeCategory::Generator) {
+    : GeneratorNode(id, "Ridged Noise") {
     AddOutputPin("Output", PinType::Heightfield);
 }
 
@@ -108,47 +149,56 @@ bool RidgedNode::Execute(NodeGraph* graph) {
         return true;
     }
 
-    // Use Perlin but apply ridged transformation
     auto generator = graph->GetGenerator();
     if (!generator) {
         LOG_ERROR("No terrain generator available");
         return false;
     }
 
-    PerlinParams perlinParams;
-    perlinParams.frequency = frequency;
-    perlinParams.amplitude = amplitude;
-    perlinParams.octaves = octaves;
-    perlinParams.lacunarity = lacunarity;
-    perlinParams.persistence = persistence;
-    perlinParams.seed = seed;
-
-    auto heightfield = generator->GeneratePerlin(width, height, perlinParams);
+    RidgedParams ridgedParams;
+    ridgedParams.frequency = frequency;
+    ridgedParams.amplitude = amplitude;
+    ridgedParams.octaves = octaves;
+    ridgedParams.lacunarity = lacunarity;
+    ridgedParams.persistence = persistence;
+    ridgedParams.ridgeOffset = ridgeOffset;
+    ridgedParams.gain = gain;
+    ridgedParams.sharpness = sharpness;
+    ridgedParams.seed = seed;
+
+    // Final heights in [0, amplitude] straight from the kernel: no transform
+    // or normalization passes
+    auto heightfield = m_Region ? generator->GenerateRidged(*m_Region, ridgedParams)
+                                : generator->GenerateRidged(width, height, ridgedParams);
     if (!heightfield) {
         LOG_ERROR("Failed to generate ridged noise");
         return false;
     }
 
-    // Apply ridged transformation: abs(value) and invert
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float value = heightfield->GetHeight(x, y);
-            value = ridgeOffset - std::abs(value - 0.5f) * 2.0f;
-            heightfield->SetHeight(x, y, value);
-        }
-    }
-
-    heightfield->Normalize(0.0f, 1.0f);
     SetOutputHeightfield("Output", std::move(heightfield));
     return true;
 }
 
+bool RidgedNode::HashParameters(Hasher& hasher) const {
+    HashOutput(hasher);
+    hasher.Add(frequency);
+    hasher.Add(amplitude);
+    hasher.Add(octaves);
+    hasher.Add(lacunarity);
+    hasher.Add(persistence);
+    hasher.Add(ridgeOffset);
+    hasher.Add(gain);
+    hasher.Add(sharpness);
+    hasher.Add(seed);
+    return true;
+}
+
 // ============================================================================
 // Gradient Node
 // ============================================================================
 
 GradientNode::GradientNode(uint32 id)
-    : Node(id, "Gradient", NodeCategory::Generator) {
+    : GeneratorNode(id, "Gradient") {
     AddOutputPin("Output", PinType::Heightfield);
 }
 
@@ -157,29 +207,56 @@ bool GradientNode::Execute(NodeGraph* graph) {
         return true;
     }
 
-    auto heightfield = MakeUnique<Heightfield>(width, height);
+    auto heightfield = MakeUnique<Heightfield>(GetOutputWidth(), GetOutputHeight(), BufferInit::Uninitialized);
 
     glm::vec2 dir = glm::normalize(direction);
 
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            glm::vec2 p(static_cast<float>(x) / width, static_cast<float>(y) / height);
-            float value = glm::dot(p, dir) * amplitude;
-            heightfield->SetHeight(x, y, value);
-        }
+    HeightfieldView<float32> view = heightfield->GetViewMutable();
+    if (m_Region) {
+        // Height along the direction in world units
+        ParallelForRows(view.height, [&](uint32 rowBegin, uint32 rowEnd) {
+            for (uint32 y = rowBegin; y < rowEnd; y++) {
+                std::span<float32> row = view.Row(y);
+                float64 alongY = m_Region->GetWorldY(y) * dir.y;
+                for (uint32 x = 0; x < view.width; x++) {
+                    row[x] = static_cast<float32>((m_Region->GetWorldX(x) * dir.x + alongY) * amplitude);
+                }
+            }
+        });
+
+        SetOutputHeightfield("Output", std::move(heightfield));
+        return true;
     }
 
+    ParallelForRows(height, [&](uint32 rowBegin, uint32 rowEnd) {
+        for (uint32 y = rowBegin; y < rowEnd; y++) {
+            std::span<float32> row = view.Row(y);
+            for (uint32 x = 0; x < width; x++) {
+                glm::vec2 p(static_cast<float>(x) / width, static_cast<float>(y) / height);
+                row[x] = glm::dot(p, dir) * amplitude;
+            }
+        }
+    });
+
     heightfield->Normalize(0.0f, 1.0f);
     SetOutputHeightfield("Output", std::move(heightfield));
     return true;
 }
 
+bool GradientNode::HashParameters(Hasher& hasher) const {
+    HashOutput(hasher);
+    hasher.Add(direction.x);
+    hasher.Add(direction.y);
+    hasher.Add(amplitude);
+    return true;
+}
+
 // ============================================================================
 // Constant Node
 // ============================================================================
 
 ConstantNode::ConstantNode(uint32 id)
-    : Node(id, "Constant", NodeCategory::Generator) {
+    : GeneratorNode(id, "Constant") {
     AddOutputPin("Output", PinType::Heightfield);
 }
 
@@ -188,15 +265,14 @@ bool ConstantNode::Execute(NodeGraph* graph) {
         return true;
     }
 
-    auto heightfield = MakeUnique<Heightfield>(width, height);
-
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            heightfield->SetHeight(x, y, value);
-        }
-    }
+    // One value per tile; consumers that need samples expand it
+    SetOutputHeightfield("Output", Heightfield::CreateUniform(GetOutputWidth(), GetOutputHeight(), value));
+    return true;
+}
 
-    SetOutputHeightfield("Output", std::move(heightfield));
+bool ConstantNode::HashParameters(Hasher& hasher) const {
+    HashOutput(hasher);
+    hasher.Add(value);
     return true;
 }
 
@@ -205,7 +281,7 @@ bool ConstantNode::Execute(NodeGraph* graph) {
 // ============================================================================
 
 WhiteNoiseNode::WhiteNoiseNode(uint32 id)
-    : Node(id, "White Noise", NodeCategory::Generator) {
+    : GeneratorNode(id, "White Noise") {
     AddOutputPin("Output", PinType::Heightfield);
 }
 
@@ -214,19 +290,32 @@ bool WhiteNoiseNode::Execute(NodeGraph* graph) {
         return true;
     }
 
-    auto heightfield = MakeUnique<Heightfield>(width, height);
-
-    std::mt19937 rng(seed);
-    std::uniform_real_distribution<float> dist(0.0f, amplitude);
-
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            heightfield->SetHeight(x, y, dist(rng));
+    auto heightfield = MakeUnique<Heightfield>(GetOutputWidth(), GetOutputHeight(), BufferInit::Uninitialized);
+    HeightfieldView<float32> view = heightfield->GetViewMutable();
+
+    // Each sample drawn from the counter of its texel (in the world, in
+    // world mode), so rows can be filled in any order on any thread
+    CounterRNG rng(seed);
+    int64 originX = m_Region ? m_Region->texelX : 0;
+    int64 originY = m_Region ? m_Region->texelY : 0;
+    ParallelForRows(view.height, [&](uint32 rowBegin, uint32 rowEnd) {
+        for (uint32 y = rowBegin; y < rowEnd; y++) {
+            rng.FillFloats(originX, originY + y, view.Row(y).data(), view.width);
         }
-    }
+    });
 
+    SampleRemap remap;
+    remap.scale = amplitude;
+    heightfield->Remap(remap);
     SetOutputHeightfield("Output", std::move(heightfield));
     return true;
 }
 
+bool WhiteNoiseNode::HashParameters(Hasher& hasher) const {
+    HashOutput(hasher);
+    hasher.Add(amplitude);
+    hasher.Add(seed);
+    return true;
+}
+
 } // namespace Terrain
@@ -2,82 +2,107 @@
 
 #include "Node.h"
 #include "Terrain/TerrainGenerator.h"
+#include "Terrain/WorleyNoise.h"
 
 namespace Terrain {
 
+// Base of the generators. On its own a generator produces a width x height
+// image; given a world region it produces that region of an infinite world
+// instead, every sample a function of its world texel alone, so regions
+// generated separately line up bit for bit. Per-image normalization is
+// skipped in world mode: it would depend on which region was generated.
+class GeneratorNode : public Node {
+public:
+    GeneratorNode(uint32 id, const String& name);
+
+    void SetWorldRegion(const std::optional<WorldRegion>& region) override;
+    const std::optional<WorldRegion>& GetWorldRegion() const { return m_Region; }
+
+    uint32 width = 512;
+    uint32 height = 512;
+
+protected:
+    uint32 GetOutputWidth() const { return m_Region ? m_Region->width : width; }
+    uint32 GetOutputHeight() const { return m_Region ? m_Region->height : height; }
+
+    // Adds the output dimensions and region, for HashParameters
+    void HashOutput(Hasher& hasher) const;
+
+    std::optional<WorldRegion> m_Region;
+};
+
 // Perlin Noise Generator
-class PerlinNode : public Node {
+class PerlinNode : public GeneratorNode {
 public:
     PerlinNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
 
     PerlinParams params;
-    uint32 width = 512;
-    uint32 height = 512;
 };
 
-// Voronoi Generator
-class VoronoiNode : public Node {
+// Voronoi Generator: jittered-grid Worley noise (see WorleyNoise.h) with
+// cellCount cells per image, or per unit square of the world in world mode
+class VoronoiNode : public GeneratorNode {
 public:
     VoronoiNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
 
-    uint32 width = 512;
-    uint32 height = 512;
     int32 cellCount = 20;
+    float32 jitter = 1.0f;
     float32 amplitude = 1.0f;
     uint32 seed = 12345;
     bool invert = false;
+    WorleyOutput output = WorleyOutput::F1;
 };
 
 // Ridged Noise Generator
-class RidgedNode : public Node {
+class RidgedNode : public GeneratorNode {
 public:
     RidgedNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
 
-    uint32 width = 512;
-    uint32 height = 512;
     float32 frequency = 0.01f;
     float32 amplitude = 1.0f;
     int32 octaves = 6;
     float32 lacunarity = 2.0f;
     float32 persistence = 0.5f;
     float32 ridgeOffset = 1.0f;
+    float32 gain = 2.0f;      // How strongly each octave's ridges gate the next one's detail
+    float32 sharpness = 2.0f; // Exponent on each octave's ridges, interpolated between whole values (see RidgedParams)
     uint32 seed = 12345;
 };
 
 // Gradient Generator
-class GradientNode : public Node {
+class GradientNode : public GeneratorNode {
 public:
     GradientNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
 
-    uint32 width = 512;
-    uint32 height = 512;
     glm::vec2 direction = glm::vec2(0.0f, 1.0f); // Vertical gradient
     float32 amplitude = 1.0f;
 };
 
 // Constant Value Generator
-class ConstantNode : public Node {
+class ConstantNode : public GeneratorNode {
 public:
     ConstantNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
 
-    uint32 width = 512;
-    uint32 height = 512;
     float32 value = 0.5f;
 };
 
 // White Noise Generator
-class WhiteNoiseNode : public Node {
+class WhiteNoiseNode : public GeneratorNode {
 public:
     WhiteNoiseNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
 
-    uint32 width = 512;
-    uint32 height = 512;
     float32 amplitude = 1.0f;
     uint32 seed = 12345;
 };
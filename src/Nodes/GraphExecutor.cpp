@@ -0,0 +1,342 @@
+#include "GraphExecutor.h"
+#include "NodeGraph.h"
+#include "NodeCache.h"
+#include "Core/Logger.h"
+#include "Core/JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <queue>
+
+namespace Terrain {
+
+namespace {
+    // Only heightfield outputs are memoized by the executor. Texture nodes
+    // export files as a side effect, so they always run and consult the
+    // DiskCache themselves.
+    bool ProducesHeightfield(const Node* node) {
+        for (const auto& output : node->GetOutputs()) {
+            if (output->type == PinType::Heightfield) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+GraphExecutor::GraphExecutor(NodeGraph* graph)
+    : m_Graph(graph) {
+}
+
+bool GraphExecutor::BuildPlan(Node* target, ExecutionPlan& plan) {
+    plan = ExecutionPlan();
+    if (!target) {
+        return false;
+    }
+
+    // Iterative depth-first post-order over input pins, tracking the nodes on
+    // the current path to detect cycles
+    enum class VisitState : uint8 { InProgress, Done };
+    std::unordered_map<Node*, VisitState> state;
+    std::vector<std::pair<Node*, size_t>> stack;
+
+    stack.push_back({ target, 0 });
+    state[target] = VisitState::InProgress;
+
+    while (!stack.empty()) {
+        auto& [node, nextInput] = stack.back();
+        const auto& inputs = node->GetInputs();
+
+        if (nextInput < inputs.size()) {
+            NodePin* input = inputs[nextInput++].get();
+            if (!input->connectedPin) {
+                continue;
+            }
+
+            Node* source = input->connectedPin->node;
+            auto it = state.find(source);
+            if (it == state.end()) {
+                state[source] = VisitState::InProgress;
+                stack.push_back({ source, 0 });
+            } else if (it->second == VisitState::InProgress) {
+                LOG_ERROR("Node graph contains a cycle through node: %s", source->GetName().c_str());
+                plan = ExecutionPlan();
+                return false;
+            }
+            continue;
+        }
+
+        // All inputs visited: node can be appended in topological order
+        state[node] = VisitState::Done;
+        plan.indices[node] = static_cast<uint32>(plan.nodes.size());
+        plan.nodes.push_back(node);
+        stack.pop_back();
+    }
+
+    uint32 count = static_cast<uint32>(plan.nodes.size());
+    plan.dependencies.resize(count);
+    plan.consumers.resize(count);
+    plan.priority.resize(count, 0.0);
+
+    for (uint32 i = 0; i < count; i++) {
+        for (const auto& input : plan.nodes[i]->GetInputs()) {
+            if (!input->connectedPin) {
+                continue;
+            }
+
+            uint32 source = plan.indices[input->connectedPin->node];
+            // A node may feed several inputs of the same consumer
+            auto& deps = plan.dependencies[i];
+            if (std::find(deps.begin(), deps.end(), source) == deps.end()) {
+                deps.push_back(source);
+                plan.consumers[source].push_back(i);
+            }
+        }
+    }
+
+    // A pointwise node whose only consumer is a pointwise node in this plan
+    // is folded into that consumer's pass instead of being materialized
+    plan.fused.resize(count, false);
+    for (uint32 i = 0; i < count; i++) {
+        Node* node = plan.nodes[i];
+        plan.fused[i] = node != target && node->IsPointwise() && node->GetConsumerCount() == 1 &&
+                        plan.consumers[i].size() == 1 && plan.nodes[plan.consumers[i][0]]->IsPointwise();
+    }
+
+    // Liveness: the materialized outputs each node reads. A fused node reads
+    // nothing itself; its consumer reads the fused chain's source instead.
+    plan.sources.resize(count);
+    plan.readerCount.resize(count, 0);
+    for (uint32 i = 0; i < count; i++) {
+        if (plan.fused[i]) {
+            continue;
+        }
+
+        std::vector<uint32> pending = plan.dependencies[i];
+        while (!pending.empty()) {
+            uint32 source = pending.back();
+            pending.pop_back();
+
+            if (plan.fused[source]) {
+                pending.insert(pending.end(), plan.dependencies[source].begin(), plan.dependencies[source].end());
+            } else {
+                plan.sources[i].push_back(source);
+                plan.readerCount[source]++;
+            }
+        }
+    }
+
+    // Upward rank: own cost plus the most expensive path to the target.
+    // Reverse topological order guarantees consumers are ranked first.
+    for (uint32 i = count; i-- > 0;) {
+        float64 longestConsumer = 0.0;
+        for (uint32 consumer : plan.consumers[i]) {
+            longestConsumer = std::max(longestConsumer, plan.priority[consumer]);
+        }
+        float64 cost = plan.fused[i] ? 0.0 : plan.nodes[i]->GetCostEstimate();
+        plan.priority[i] = cost + longestConsumer;
+    }
+
+    return true;
+}
+
+bool GraphExecutor::DependsOn(Node* node, Node* dependency) {
+    if (!node || !dependency) {
+        return false;
+    }
+
+    std::vector<Node*> stack = { node };
+    std::unordered_map<Node*, bool> visited;
+
+    while (!stack.empty()) {
+        Node* current = stack.back();
+        stack.pop_back();
+
+        if (current == dependency) {
+            return true;
+        }
+        if (visited[current]) {
+            continue;
+        }
+        visited[current] = true;
+
+        for (const auto& input : current->GetInputs()) {
+            if (input->connectedPin) {
+                stack.push_back(input->connectedPin->node);
+            }
+        }
+    }
+    return false;
+}
+
+bool GraphExecutor::Execute(Node* target) {
+    ExecutionPlan plan;
+    if (!BuildPlan(target, plan)) {
+        return false;
+    }
+
+    uint32 count = static_cast<uint32>(plan.nodes.size());
+
+    // Number of unfinished dependencies per node
+    std::vector<std::atomic<uint32>> remaining(count);
+    for (uint32 i = 0; i < count; i++) {
+        remaining[i] = static_cast<uint32>(plan.dependencies[i].size());
+    }
+
+    // Number of readers of each output that have not finished yet
+    bool releaseOutputs = m_MemoryPolicy == MemoryPolicy::ReleaseIntermediates;
+    std::vector<std::atomic<uint32>> unread(count);
+    std::vector<bool> releasable(count);
+    for (uint32 i = 0; i < count; i++) {
+        unread[i] = plan.readerCount[i];
+        releasable[i] = releaseOutputs && plan.nodes[i] != target && !plan.nodes[i]->IsPinned();
+    }
+
+    // Bytes held by plan outputs, for the peak estimate
+    std::vector<uint64> outputBytes(count, 0);
+    std::atomic<uint64> liveBytes{0};
+    std::atomic<uint64> peakBytes{0};
+    auto bytesOf = [](const Node* node) -> uint64 {
+        const Heightfield* output = node->GetCachedOutput();
+        const TerrainLayerStack* layers = node->GetCachedLayers();
+        return (output ? output->GetByteSize() : 0) + (layers ? layers->GetByteSize() : 0);
+    };
+    for (uint32 i = 0; i < count; i++) {
+        outputBytes[i] = bytesOf(plan.nodes[i]);
+        liveBytes += outputBytes[i];
+    }
+    peakBytes = liveBytes.load();
+
+    // Ready nodes, highest critical-path priority first. Each push is paired
+    // with one submitted job that runs whatever is most urgent at that time.
+    auto compare = [&plan](uint32 a, uint32 b) { return plan.priority[a] < plan.priority[b]; };
+    std::priority_queue<uint32, std::vector<uint32>, decltype(compare)> ready(compare);
+    std::mutex readyMutex;
+    std::atomic<bool> failed{false};
+
+    JobSystem& jobs = JobSystem::Get();
+    JobCounter counter;
+
+    std::function<void(uint32)> makeReady;
+    auto runNext = [&]() {
+        uint32 index;
+        {
+            std::lock_guard<std::mutex> lock(readyMutex);
+            index = ready.top();
+            ready.pop();
+        }
+
+        Node* node = plan.nodes[index];
+        if (failed) {
+            return;
+        }
+
+        bool memoize = ProducesHeightfield(node);
+        if (node->IsDirty() && plan.fused[index]) {
+            // Runs as part of its consumer; only its content key is needed here
+            node->SetContentHash(node->ComputeContentHash());
+        } else if (node->IsDirty() && memoize) {
+            // Inputs are complete, so their content hashes are current
+            uint64 hash = node->ComputeContentHash();
+            if (hash != 0) {
+                if (auto cached = NodeCache::Get().Find(hash)) {
+                    node->RestoreCachedOutput(std::move(cached), hash);
+                }
+            }
+        }
+
+        if (node->IsDirty() && !plan.fused[index]) {
+            // A sole reader may take over its input's samples
+            std::vector<const float32*> sourceSamples;
+            for (uint32 source : plan.sources[index]) {
+                Node* sourceNode = plan.nodes[source];
+                if (releasable[source] && plan.readerCount[source] == 1 && sourceNode->GetConsumerCount() == 1) {
+                    sourceNode->SetDonateOutput(true);
+                }
+                const Heightfield* output = sourceNode->GetCachedOutput();
+                sourceSamples.push_back(output && output->IsDense() ? output->GetData().data() : nullptr);
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            bool success = node->Execute(m_Graph);
+            auto end = std::chrono::high_resolution_clock::now();
+            node->SetLastExecutionTime(std::chrono::duration<float64>(end - start).count());
+
+            if (!success) {
+                LOG_ERROR("Failed to execute node: %s", node->GetName().c_str());
+                failed = true;
+                return;
+            }
+
+            uint64 hash = node->ComputeContentHash();
+            node->SetContentHash(hash);
+            if (hash != 0 && memoize && node->GetCachedOutput()) {
+                NodeCache::Get().Insert(hash, *node->GetCachedOutput(), node->GetLastExecutionTime());
+            }
+
+            // Samples adopted in place are not counted twice
+            const Heightfield* output = node->GetCachedOutput();
+            for (size_t i = 0; output && output->IsDense() && i < sourceSamples.size(); i++) {
+                uint32 source = plan.sources[index][i];
+                if (sourceSamples[i] == output->GetData().data() && !plan.nodes[source]->GetCachedOutput()) {
+                    liveBytes -= outputBytes[source];
+                    outputBytes[source] = 0;
+                }
+            }
+        }
+
+        if (!plan.fused[index]) {
+            // Account for a newly executed or restored output
+            uint64 bytes = bytesOf(node);
+            uint64 live = liveBytes += bytes - outputBytes[index];
+            outputBytes[index] = bytes;
+
+            uint64 peak = peakBytes.load();
+            while (live > peak && !peakBytes.compare_exchange_weak(peak, live)) {
+            }
+        }
+
+        // Release inputs this node was the last reader of
+        for (uint32 source : plan.sources[index]) {
+            if (unread[source].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                plan.nodes[source]->SetDonateOutput(false);
+                if (releasable[source]) {
+                    plan.nodes[source]->ReleaseOutput();
+                    liveBytes -= outputBytes[source];
+                    outputBytes[source] = 0;
+                }
+            }
+        }
+
+        for (uint32 consumer : plan.consumers[index]) {
+            if (remaining[consumer].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                makeReady(consumer);
+            }
+        }
+    };
+
+    makeReady = [&](uint32 index) {
+        {
+            std::lock_guard<std::mutex> lock(readyMutex);
+            ready.push(index);
+        }
+        jobs.Submit(counter, runNext);
+    };
+
+    for (uint32 i = 0; i < count; i++) {
+        if (plan.dependencies[i].empty()) {
+            makeReady(i);
+        }
+    }
+
+    jobs.Wait(counter);
+
+    m_PeakBytes = peakBytes;
+    if (releaseOutputs) {
+        LOG_DEBUG("Graph execution peak output memory: %llu MB",
+                  static_cast<unsigned long long>(m_PeakBytes / (1024 * 1024)));
+    }
+    return !failed;
+}
+
+} // namespace Terrain
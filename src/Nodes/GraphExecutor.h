@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Core/Types.h"
+#include "Node.h"
+#include <unordered_map>
+#include <vector>
+
+namespace Terrain {
+
+class NodeGraph;
+
+// What happens to intermediate outputs during execution
+enum class MemoryPolicy {
+    KeepAll,               // Every node keeps its cached output (interactive editing)
+    ReleaseIntermediates   // Outputs are freed after their last reader, unless pinned
+};
+
+// Dependency DAG of the nodes a target node (transitively) depends on
+struct ExecutionPlan {
+    std::vector<Node*> nodes;                       // Topological order (inputs first)
+    std::vector<std::vector<uint32>> dependencies;  // Plan indices of each node's input nodes
+    std::vector<std::vector<uint32>> consumers;     // Plan indices of nodes consuming each node
+    std::vector<float64> priority;                  // Longest remaining path (critical path) cost
+    std::vector<bool> fused;                        // Evaluated inline by its pointwise consumer
+    std::vector<std::vector<uint32>> sources;       // Materialized outputs each node reads (through fused nodes)
+    std::vector<uint32> readerCount;                // Number of nodes reading each node's output
+    std::unordered_map<Node*, uint32> indices;
+};
+
+// Executes node graphs as a DAG: nodes run on the job system as soon as all
+// of their inputs are available, independent branches run concurrently, and
+// among ready nodes the one on the longest remaining path runs first.
+// Dirty nodes are looked up in the NodeCache by content hash before running.
+// With MemoryPolicy::ReleaseIntermediates, outputs are freed as soon as their
+// last reader has run, and a sole reader takes over its input's samples so
+// it can work in place.
+class GraphExecutor {
+public:
+    explicit GraphExecutor(NodeGraph* graph);
+
+    // Build the plan for everything the target depends on.
+    // Returns false (and logs) if the graph contains a cycle.
+    static bool BuildPlan(Node* target, ExecutionPlan& plan);
+
+    // Returns true if `node` depends (transitively) on `dependency`
+    static bool DependsOn(Node* node, Node* dependency);
+
+    // Execute the target and all of its dirty dependencies
+    bool Execute(Node* target);
+
+    void SetMemoryPolicy(MemoryPolicy policy) { m_MemoryPolicy = policy; }
+    MemoryPolicy GetMemoryPolicy() const { return m_MemoryPolicy; }
+
+    // Peak bytes held by node outputs of the plan during the last Execute
+    uint64 GetPeakBytes() const { return m_PeakBytes; }
+
+private:
+    NodeGraph* m_Graph;
+    MemoryPolicy m_MemoryPolicy = MemoryPolicy::KeepAll;
+    uint64 m_PeakBytes = 0;
+};
+
+} // namespace Terrain
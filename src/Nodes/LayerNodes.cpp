@@ -0,0 +1,93 @@
+#include "LayerNodes.h"
+#include "NodeGraph.h"
+#include "Core/Logger.h"
+
+namespace Terrain {
+
+// ============================================================================
+// Layer Stack Node
+// ============================================================================
+
+LayerStackNode::LayerStackNode(uint32 id)
+    : Node(id, "Layer Stack", NodeCategory::Modifier) {
+    for (uint32 i = 0; i < kTerrainLayerCount; i++) {
+        AddInputPin(GetTerrainLayerName(static_cast<TerrainLayer>(i)), PinType::Heightfield);
+    }
+    AddOutputPin("Layers", PinType::LayerStack);
+}
+
+bool LayerStackNode::Execute(NodeGraph* graph) {
+    if (!m_Dirty) {
+        return true;
+    }
+
+    auto height = GetInputHeightfield("Height", graph);
+    if (!height) {
+        LOG_ERROR("Layer stack node: no height input");
+        return false;
+    }
+
+    auto layers = MakeUnique<TerrainLayerStack>(height->GetWidth(), height->GetHeight(),
+                                                std::initializer_list<TerrainLayer>{}, BufferInit::Uninitialized);
+    layers->SetLayer(TerrainLayer::Height, *height);
+    height.reset();
+
+    for (uint32 i = 1; i < kTerrainLayerCount; i++) {
+        TerrainLayer layer = static_cast<TerrainLayer>(i);
+        auto input = GetInputHeightfield(GetTerrainLayerName(layer), graph);
+        if (!input) {
+            continue;
+        }
+        if (input->GetWidth() != layers->GetWidth() || input->GetHeight() != layers->GetHeight()) {
+            LOG_ERROR("Layer stack node: %s input is %ux%u, height is %ux%u", GetTerrainLayerName(layer),
+                      input->GetWidth(), input->GetHeight(), layers->GetWidth(), layers->GetHeight());
+            return false;
+        }
+        layers->SetLayer(layer, *input);
+    }
+
+    SetOutputLayerStack("Layers", std::move(layers));
+    return true;
+}
+
+bool LayerStackNode::HashParameters(Hasher& hasher) const {
+    (void)hasher;
+    return true;
+}
+
+// ============================================================================
+// Extract Layer Node
+// ============================================================================
+
+LayerExtractNode::LayerExtractNode(uint32 id)
+    : Node(id, "Extract Layer", NodeCategory::Modifier) {
+    AddInputPin("Layers", PinType::LayerStack);
+    AddOutputPin("Output", PinType::Heightfield);
+}
+
+bool LayerExtractNode::Execute(NodeGraph* graph) {
+    if (!m_Dirty) {
+        return true;
+    }
+
+    auto layers = GetInputLayerStack("Layers", graph);
+    if (!layers) {
+        LOG_ERROR("Extract layer node: no input");
+        return false;
+    }
+
+    auto output = layers->ExtractLayer(layer);
+    if (!output) {
+        return false;
+    }
+
+    SetOutputHeightfield("Output", std::move(output));
+    return true;
+}
+
+bool LayerExtractNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(static_cast<uint32>(layer));
+    return true;
+}
+
+} // namespace Terrain
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Node.h"
+#include "Terrain/TerrainLayerStack.h"
+
+namespace Terrain {
+
+// Note: Layer nodes move terrain layers in and out of a LayerStack pin.
+// Nodes that read several layers at once (layered erosion) take the stack
+// and sweep its channels together instead of one heightfield per pin.
+
+// Layer Stack Node: gathers heightfields into one stack. Height is
+// required; the other layers are added only if connected.
+class LayerStackNode : public Node {
+public:
+    LayerStackNode(uint32 id);
+    bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+};
+
+// Extract Layer Node: one layer of a stack as a heightfield
+class LayerExtractNode : public Node {
+public:
+    LayerExtractNode(uint32 id);
+    bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+
+    TerrainLayer layer = TerrainLayer::Height;
+};
+
+} // namespace Terrain
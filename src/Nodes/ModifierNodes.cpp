@@ -1,51 +1,139 @@
 #include "ModifierNodes.h"
 #include "NodeGraph.h"
 #include "Core/Logger.h"
+#include "Core/JobSystem.h"
+#include "Terrain/TiledGrid.h"
 #include <cmath>
 #include <algorithm>
 
 namespace Terrain {
 
-// ============================================================================
-// Terrace Node
-// ============================================================================
-
-TerraceNode::TerraceNode(uint32 id)
-    : Node(id, "Terrace", NodeCategory::Modifier) {
-    AddInputPin("Input", PinType::Heightfield);
-    AddOutputPin("Output", PinType::Heightfield);
-}
+namespace {
+    // One box blur iteration over a tile. Samples on the heightfield edge
+    // read neighbors from the halo, filled according to the border mode.
+    void SmoothTile(GridTile<const float32> src, GridTile<float32> dst, float32 strength) {
+        int32 tileWidth = static_cast<int32>(src.width);
+        for (int32 ly = 0; ly < static_cast<int32>(src.height); ly++) {
+            const float32* above = src.Row(ly - 1);
+            const float32* row = src.Row(ly);
+            const float32* below = src.Row(ly + 1);
+            float32* out = dst.Row(ly);
+
+            for (int32 lx = 0; lx < tileWidth; lx++) {
+                // Row by row, left to right, like the original 3x3 loop
+                float sum = 0.0f;
+                sum += above[lx - 1]; sum += above[lx]; sum += above[lx + 1];
+                sum += row[lx - 1];   sum += row[lx];   sum += row[lx + 1];
+                sum += below[lx - 1]; sum += below[lx]; sum += below[lx + 1];
 
-bool TerraceNode::Execute(NodeGraph* graph) {
-    if (!m_Dirty) {
-        return true;
+                float smoothed = sum / 9.0f;
+                float original = row[lx];
+                out[lx] = original * (1.0f - strength) + smoothed * strength;
+            }
+        }
     }
 
-    auto input = GetInputHeightfield("Input", graph);
-    if (!input) {
-        LOG_ERROR("Terrace node: no input");
-        return false;
+    // Sharpen a tile into row-major output. Samples on the heightfield edge
+    // read neighbors from the halo, filled according to the border mode.
+    void SharpenTile(GridTile<const float32> src, HeightfieldView<float32> output, float32 strength) {
+        int32 tileWidth = static_cast<int32>(src.width);
+        for (int32 ly = 0; ly < static_cast<int32>(src.height); ly++) {
+            const float32* above = src.Row(ly - 1);
+            const float32* row = src.Row(ly);
+            const float32* below = src.Row(ly + 1);
+            float32* out = output.Row(src.y + ly).data() + src.x;
+
+            for (int32 lx = 0; lx < tileWidth; lx++) {
+                float center = row[lx];
+                float neighbors = row[lx - 1] + row[lx + 1] + above[lx] + below[lx];
+                out[lx] = center * (1.0f + 4.0f * strength) - neighbors * strength;
+            }
+        }
     }
 
-    uint32 width = input->GetWidth();
-    uint32 height = input->GetHeight();
-    auto output = MakeUnique<Heightfield>(width, height);
+    // CombineInto for two sparse inputs, tile by tile. Where both tiles are
+    // uniform the result is one combined value; other tiles of A are
+    // expanded first.
+    template <typename Combine>
+    void CombineSparse(Heightfield& a, Heightfield& b, Combine combine) {
+        SampleRemap remapB = b.TakeRemap();
+        for (uint32 index = 0; index < a.GetTileCount(); index++) {
+            if (!b.IsUniformTile(index)) {
+                a.ExpandTile(index);
+            }
+        }
 
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float value = input->GetHeight(x, y);
+        // TransformTiles applies A's remap itself
+        a.TransformTiles(
+            [&](uint32 index, float32 value) {
+                return combine(value, remapB.Apply(b.GetTileValue(index)));
+            },
+            [&](uint32 index, HeightfieldView<float32> tile) {
+                if (b.IsUniformTile(index)) {
+                    float32 other = remapB.Apply(b.GetTileValue(index));
+                    for (uint32 y = 0; y < tile.height; y++) {
+                        for (float32& sample : tile.Row(y)) {
+                            sample = combine(sample, other);
+                        }
+                    }
+                    return;
+                }
 
-            // Apply terracing
-            float stepped = std::floor(value * steps) / steps;
+                HeightfieldView<const float32> other = b.GetTileView(index);
+                for (uint32 y = 0; y < tile.height; y++) {
+                    std::span<float32> row = tile.Row(y);
+                    std::span<const float32> otherRow = other.Row(y);
+                    for (uint32 x = 0; x < tile.width; x++) {
+                        row[x] = combine(row[x], remapB.Apply(otherRow[x]));
+                    }
+                }
+            });
+    }
+
+    // Combine B into A's samples in one pass. Both inputs' pending remaps are
+    // applied as the samples are loaded, and A's statistics are gathered as
+    // they are written, so a following Normalize is O(1). Two sparse inputs
+    // give a sparse result; a single sparse one is expanded.
+    template <typename Combine>
+    void CombineInto(Heightfield& a, Heightfield& b, Combine combine) {
+        if (a.IsSparse() && b.IsSparse()) {
+            CombineSparse(a, b, combine);
+            return;
+        }
+        a.Expand();
+        b.Expand();
 
-            // Blend between stepped and original
-            float finalValue = stepped * (1.0f - blend) + value * blend;
+        SampleRemap remapA = a.TakeRemap();
+        SampleRemap remapB = b.TakeRemap();
+        std::span<const float32> source = b.GetData();
 
-            output->SetHeight(x, y, finalValue);
-        }
+        a.Transform([&](float32* data, uint64 begin, uint64 end) {
+            for (uint64 i = begin; i < end; i++) {
+                data[i] = combine(remapA.Apply(data[i]), remapB.Apply(source[i]));
+            }
+        });
     }
+}
 
-    SetOutputHeightfield("Output", std::move(output));
+// ============================================================================
+// Terrace Node
+// ============================================================================
+
+TerraceNode::TerraceNode(uint32 id)
+    : PointwiseNode(id, "Terrace", NodeCategory::Modifier) {
+}
+
+void TerraceNode::AppendOps(std::vector<PointwiseOp>& ops) const {
+    PointwiseOp op;
+    op.type = PointwiseOpType::Terrace;
+    op.steps = steps;
+    op.blend = blend;
+    ops.push_back(op);
+}
+
+bool TerraceNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(steps);
+    hasher.Add(blend);
     return true;
 }
 
@@ -54,35 +142,20 @@ bool TerraceNode::Execute(NodeGraph* graph) {
 // ============================================================================
 
 ClampNode::ClampNode(uint32 id)
-    : Node(id, "Clamp", NodeCategory::Modifier) {
-    AddInputPin("Input", PinType::Heightfield);
-    AddOutputPin("Output", PinType::Heightfield);
+    : PointwiseNode(id, "Clamp", NodeCategory::Modifier) {
 }
 
-bool ClampNode::Execute(NodeGraph* graph) {
-    if (!m_Dirty) {
-        return true;
-    }
-
-    auto input = GetInputHeightfield("Input", graph);
-    if (!input) {
-        LOG_ERROR("Clamp node: no input");
-        return false;
-    }
-
-    uint32 width = input->GetWidth();
-    uint32 height = input->GetHeight();
-    auto output = MakeUnique<Heightfield>(width, height);
-
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float value = input->GetHeight(x, y);
-            value = std::clamp(value, minValue, maxValue);
-            output->SetHeight(x, y, value);
-        }
-    }
+void ClampNode::AppendOps(std::vector<PointwiseOp>& ops) const {
+    PointwiseOp op;
+    op.type = PointwiseOpType::Clamp;
+    op.minValue = minValue;
+    op.maxValue = maxValue;
+    ops.push_back(op);
+}
 
-    SetOutputHeightfield("Output", std::move(output));
+bool ClampNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(minValue);
+    hasher.Add(maxValue);
     return true;
 }
 
@@ -91,37 +164,18 @@ bool ClampNode::Execute(NodeGraph* graph) {
 // ============================================================================
 
 InvertNode::InvertNode(uint32 id)
-    : Node(id, "Invert", NodeCategory::Modifier) {
-    AddInputPin("Input", PinType::Heightfield);
-    AddOutputPin("Output", PinType::Heightfield);
+    : PointwiseNode(id, "Invert", NodeCategory::Modifier) {
 }
 
-bool InvertNode::Execute(NodeGraph* graph) {
-    if (!m_Dirty) {
-        return true;
-    }
-
-    auto input = GetInputHeightfield("Input", graph);
-    if (!input) {
-        LOG_ERROR("Invert node: no input");
-        return false;
-    }
-
-    uint32 width = input->GetWidth();
-    uint32 height = input->GetHeight();
-    auto output = MakeUnique<Heightfield>(width, height);
-
-    float min = input->GetMin();
-    float max = input->GetMax();
-
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float value = input->GetHeight(x, y);
-            output->SetHeight(x, y, max - value + min);
-        }
-    }
+void InvertNode::AppendOps(std::vector<PointwiseOp>& ops) const {
+    // Mirrors values within the input's own range
+    PointwiseOp op;
+    op.type = PointwiseOpType::Invert;
+    ops.push_back(op);
+}
 
-    SetOutputHeightfield("Output", std::move(output));
+bool InvertNode::HashParameters(Hasher& hasher) const {
+    (void)hasher;
     return true;
 }
 
@@ -130,34 +184,18 @@ bool InvertNode::Execute(NodeGraph* graph) {
 // ============================================================================
 
 ScaleNode::ScaleNode(uint32 id)
-    : Node(id, "Scale", NodeCategory::Modifier) {
-    AddInputPin("Input", PinType::Heightfield);
-    AddOutputPin("Output", PinType::Heightfield);
+    : PointwiseNode(id, "Scale", NodeCategory::Modifier) {
 }
 
-bool ScaleNode::Execute(NodeGraph* graph) {
-    if (!m_Dirty) {
-        return true;
-    }
-
-    auto input = GetInputHeightfield("Input", graph);
-    if (!input) {
-        LOG_ERROR("Scale node: no input");
-        return false;
-    }
-
-    uint32 width = input->GetWidth();
-    uint32 height = input->GetHeight();
-    auto output = MakeUnique<Heightfield>(width, height);
-
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float value = input->GetHeight(x, y);
-            output->SetHeight(x, y, value * scale);
-        }
-    }
+void ScaleNode::AppendOps(std::vector<PointwiseOp>& ops) const {
+    PointwiseOp op;
+    op.type = PointwiseOpType::Scale;
+    op.scale = scale;
+    ops.push_back(op);
+}
 
-    SetOutputHeightfield("Output", std::move(output));
+bool ScaleNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(scale);
     return true;
 }
 
@@ -166,36 +204,25 @@ bool ScaleNode::Execute(NodeGraph* graph) {
 // ============================================================================
 
 CurveNode::CurveNode(uint32 id)
-    : Node(id, "Curve", NodeCategory::Modifier) {
-    AddInputPin("Input", PinType::Heightfield);
-    AddOutputPin("Output", PinType::Heightfield);
+    : PointwiseNode(id, "Curve", NodeCategory::Modifier) {
 }
 
-bool CurveNode::Execute(NodeGraph* graph) {
-    if (!m_Dirty) {
-        return true;
-    }
-
-    auto input = GetInputHeightfield("Input", graph);
-    if (!input) {
-        LOG_ERROR("Curve node: no input");
-        return false;
-    }
-
-    uint32 width = input->GetWidth();
-    uint32 height = input->GetHeight();
-    auto output = MakeUnique<Heightfield>(width, height);
-
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float value = input->GetHeight(x, y);
-            value = std::pow(value, power);
-            output->SetHeight(x, y, value);
-        }
-    }
+void CurveNode::AppendOps(std::vector<PointwiseOp>& ops) const {
+    // Power curve, then remap the result to [0, 1]
+    PointwiseOp curve;
+    curve.type = PointwiseOpType::Power;
+    curve.power = power;
+    ops.push_back(curve);
+
+    PointwiseOp normalize;
+    normalize.type = PointwiseOpType::Normalize;
+    normalize.minValue = 0.0f;
+    normalize.maxValue = 1.0f;
+    ops.push_back(normalize);
+}
 
-    output->Normalize(0.0f, 1.0f);
-    SetOutputHeightfield("Output", std::move(output));
+bool CurveNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(power);
     return true;
 }
 
@@ -222,28 +249,33 @@ bool SmoothNode::Execute(NodeGraph* graph) {
 
     uint32 width = input->GetWidth();
     uint32 height = input->GetHeight();
-    auto output = MakeUnique<Heightfield>(*input); // Copy
 
-    // Box blur
-    for (int iter = 0; iter < iterations; iter++) {
-        auto temp = MakeUnique<Heightfield>(*output);
+    if (iterations <= 0) {
+        SetOutputHeightfield("Output", std::move(input));
+        return true;
+    }
 
-        for (uint32 y = 1; y < height - 1; y++) {
-            for (uint32 x = 1; x < width - 1; x++) {
-                float sum = 0.0f;
-                for (int dy = -1; dy <= 1; dy++) {
-                    for (int dx = -1; dx <= 1; dx++) {
-                        sum += temp->GetHeight(x + dx, y + dy);
-                    }
-                }
-                float smoothed = sum / 9.0f;
-                float original = temp->GetHeight(x, y);
-                output->SetHeight(x, y, original * (1.0f - strength) + smoothed * strength);
-            }
-        }
+    // Box blur over tiles, ping-ponging between two tiled grids
+    TiledHeightfield front = ToTiled(*input, border);
+    TiledHeightfield back(width, height, BufferInit::Uninitialized);
+    input.reset();
+
+    for (int iter = 0; iter < iterations; iter++) {
+        back.ForEachTile([&](uint32 index) {
+            SmoothTile(front.GetTile(index), back.GetTile(index), strength);
+        });
+        back.UpdateHalos(border);
+        std::swap(front, back);
     }
 
-    SetOutputHeightfield("Output", std::move(output));
+    SetOutputHeightfield("Output", ToRowMajor(front));
+    return true;
+}
+
+bool SmoothNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(iterations);
+    hasher.Add(strength);
+    hasher.Add(border);
     return true;
 }
 
@@ -270,35 +302,25 @@ bool SharpenNode::Execute(NodeGraph* graph) {
 
     uint32 width = input->GetWidth();
     uint32 height = input->GetHeight();
-    auto output = MakeUnique<Heightfield>(width, height);
+    TiledHeightfield tiled = ToTiled(*input, border);
+    auto output = MakeUnique<Heightfield>(width, height, BufferInit::Uninitialized);
+    HeightfieldView<float32> view = output->GetViewMutable();
 
     // Sharpen kernel
-    for (uint32 y = 1; y < height - 1; y++) {
-        for (uint32 x = 1; x < width - 1; x++) {
-            float center = input->GetHeight(x, y);
-            float neighbors =
-                input->GetHeight(x - 1, y) + input->GetHeight(x + 1, y) +
-                input->GetHeight(x, y - 1) + input->GetHeight(x, y + 1);
-
-            float sharpened = center * (1.0f + 4.0f * strength) - neighbors * strength;
-            output->SetHeight(x, y, sharpened);
-        }
-    }
-
-    // Copy borders
-    for (uint32 x = 0; x < width; x++) {
-        output->SetHeight(x, 0, input->GetHeight(x, 0));
-        output->SetHeight(x, height - 1, input->GetHeight(x, height - 1));
-    }
-    for (uint32 y = 0; y < height; y++) {
-        output->SetHeight(0, y, input->GetHeight(0, y));
-        output->SetHeight(width - 1, y, input->GetHeight(width - 1, y));
-    }
+    tiled.ForEachTile([&](uint32 index) {
+        SharpenTile(tiled.GetTile(index), view, strength);
+    });
 
     SetOutputHeightfield("Output", std::move(output));
     return true;
 }
 
+bool SharpenNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(strength);
+    hasher.Add(border);
+    return true;
+}
+
 // ============================================================================
 // Add Node
 // ============================================================================
@@ -331,18 +353,22 @@ bool AddNode::Execute(NodeGraph* graph) {
         return false;
     }
 
-    auto output = MakeUnique<Heightfield>(width, height);
+    // The result overwrites A's samples, which are only copied if shared
+    CombineInto(*inputA, *inputB, [&](float32 a, float32 b) {
+        return a + b;
+    });
 
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float a = inputA->GetHeight(x, y);
-            float b = inputB->GetHeight(x, y);
-            output->SetHeight(x, y, a + b);
-        }
+    // Rescaling by the region's own range would differ between world
+    // tiles, so world regions keep the raw values (as generators do)
+    if (!graph->GetWorldRegion()) {
+        inputA->Normalize(0.0f, 1.0f);
     }
+    SetOutputHeightfield("Output", std::move(inputA));
+    return true;
+}
 
-    output->Normalize(0.0f, 1.0f);
-    SetOutputHeightfield("Output", std::move(output));
+bool AddNode::HashParameters(Hasher& hasher) const {
+    (void)hasher;
     return true;
 }
 
@@ -378,18 +404,21 @@ bool MultiplyNode::Execute(NodeGraph* graph) {
         return false;
     }
 
-    auto output = MakeUnique<Heightfield>(width, height);
+    // The result overwrites A's samples, which are only copied if shared
+    CombineInto(*inputA, *inputB, [&](float32 a, float32 b) {
+        return a * b;
+    });
 
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float a = inputA->GetHeight(x, y);
-            float b = inputB->GetHeight(x, y);
-            output->SetHeight(x, y, a * b);
-        }
+    // Not normalized in world regions (see AddNode::Execute)
+    if (!graph->GetWorldRegion()) {
+        inputA->Normalize(0.0f, 1.0f);
     }
+    SetOutputHeightfield("Output", std::move(inputA));
+    return true;
+}
 
-    output->Normalize(0.0f, 1.0f);
-    SetOutputHeightfield("Output", std::move(output));
+bool MultiplyNode::HashParameters(Hasher& hasher) const {
+    (void)hasher;
     return true;
 }
 
@@ -425,17 +454,17 @@ bool BlendNode::Execute(NodeGraph* graph) {
         return false;
     }
 
-    auto output = MakeUnique<Heightfield>(width, height);
+    // The result overwrites A's samples, which are only copied if shared
+    CombineInto(*inputA, *inputB, [&](float32 a, float32 b) {
+        return a * (1.0f - blend) + b * blend;
+    });
 
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float a = inputA->GetHeight(x, y);
-            float b = inputB->GetHeight(x, y);
-            output->SetHeight(x, y, a * (1.0f - blend) + b * blend);
-        }
-    }
+    SetOutputHeightfield("Output", std::move(inputA));
+    return true;
+}
 
-    SetOutputHeightfield("Output", std::move(output));
+bool BlendNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(blend);
     return true;
 }
 
@@ -471,17 +500,17 @@ bool MaxNode::Execute(NodeGraph* graph) {
         return false;
     }
 
-    auto output = MakeUnique<Heightfield>(width, height);
+    // The result overwrites A's samples, which are only copied if shared
+    CombineInto(*inputA, *inputB, [&](float32 a, float32 b) {
+        return std::max(a, b);
+    });
 
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float a = inputA->GetHeight(x, y);
-            float b = inputB->GetHeight(x, y);
-            output->SetHeight(x, y, std::max(a, b));
-        }
-    }
+    SetOutputHeightfield("Output", std::move(inputA));
+    return true;
+}
 
-    SetOutputHeightfield("Output", std::move(output));
+bool MaxNode::HashParameters(Hasher& hasher) const {
+    (void)hasher;
     return true;
 }
 
@@ -517,17 +546,17 @@ bool MinNode::Execute(NodeGraph* graph) {
         return false;
     }
 
-    auto output = MakeUnique<Heightfield>(width, height);
+    // The result overwrites A's samples, which are only copied if shared
+    CombineInto(*inputA, *inputB, [&](float32 a, float32 b) {
+        return std::min(a, b);
+    });
 
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float a = inputA->GetHeight(x, y);
-            float b = inputB->GetHeight(x, y);
-            output->SetHeight(x, y, std::min(a, b));
-        }
-    }
+    SetOutputHeightfield("Output", std::move(inputA));
+    return true;
+}
 
-    SetOutputHeightfield("Output", std::move(output));
+bool MinNode::HashParameters(Hasher& hasher) const {
+    (void)hasher;
     return true;
 }
 
@@ -557,4 +586,9 @@ bool OutputNode::Execute(NodeGraph* graph) {
     return true;
 }
 
+bool OutputNode::HashParameters(Hasher& hasher) const {
+    (void)hasher;
+    return true;
+}
+
 } // namespace Terrain
@@ -1,50 +1,57 @@
 #pragma once
 
 #include "Node.h"
+#include "PointwiseNode.h"
+#include <algorithm>
 
 namespace Terrain {
 
 // Terrace (step function)
-class TerraceNode : public Node {
+class TerraceNode : public PointwiseNode {
 public:
     TerraceNode(uint32 id);
-    bool Execute(NodeGraph* graph) override;
+    void AppendOps(std::vector<PointwiseOp>& ops) const override;
+    bool HashParameters(Hasher& hasher) const override;
 
     int32 steps = 5;
     float32 blend = 0.1f;
 };
 
 // Clamp values
-class ClampNode : public Node {
+class ClampNode : public PointwiseNode {
 public:
     ClampNode(uint32 id);
-    bool Execute(NodeGraph* graph) override;
+    void AppendOps(std::vector<PointwiseOp>& ops) const override;
+    bool HashParameters(Hasher& hasher) const override;
 
     float32 minValue = 0.0f;
     float32 maxValue = 1.0f;
 };
 
 // Invert heightfield
-class InvertNode : public Node {
+class InvertNode : public PointwiseNode {
 public:
     InvertNode(uint32 id);
-    bool Execute(NodeGraph* graph) override;
+    void AppendOps(std::vector<PointwiseOp>& ops) const override;
+    bool HashParameters(Hasher& hasher) const override;
 };
 
 // Scale heightfield
-class ScaleNode : public Node {
+class ScaleNode : public PointwiseNode {
 public:
     ScaleNode(uint32 id);
-    bool Execute(NodeGraph* graph) override;
+    void AppendOps(std::vector<PointwiseOp>& ops) const override;
+    bool HashParameters(Hasher& hasher) const override;
 
     float32 scale = 2.0f;
 };
 
 // Curve adjustment
-class CurveNode : public Node {
+class CurveNode : public PointwiseNode {
 public:
     CurveNode(uint32 id);
-    bool Execute(NodeGraph* graph) override;
+    void AppendOps(std::vector<PointwiseOp>& ops) const override;
+    bool HashParameters(Hasher& hasher) const override;
 
     float32 power = 2.0f; // Power curve
 };
@@ -54,9 +61,12 @@ class SmoothNode : public Node {
 public:
     SmoothNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+    uint32 GetStencilRadius() const override { return static_cast<uint32>(std::max(iterations, 0)); }
 
     int32 iterations = 1;
     float32 strength = 0.5f;
+    BorderMode border = BorderMode::Clamp; // What lies beyond the edges (Wrap keeps tiling seamless)
 };
 
 // Sharpen filter
@@ -64,8 +74,11 @@ class SharpenNode : public Node {
 public:
     SharpenNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+    uint32 GetStencilRadius() const override { return 1; }
 
     float32 strength = 1.0f;
+    BorderMode border = BorderMode::Clamp;
 };
 
 // Combiner: Add
@@ -73,6 +86,9 @@ class AddNode : public Node {
 public:
     AddNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+    bool FoldsPendingRemap() const override { return true; }
+    bool HandlesSparseInput() const override { return true; }
 };
 
 // Combiner: Multiply
@@ -80,6 +96,9 @@ class MultiplyNode : public Node {
 public:
     MultiplyNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+    bool FoldsPendingRemap() const override { return true; }
+    bool HandlesSparseInput() const override { return true; }
 };
 
 // Combiner: Blend
@@ -87,6 +106,9 @@ class BlendNode : public Node {
 public:
     BlendNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+    bool FoldsPendingRemap() const override { return true; }
+    bool HandlesSparseInput() const override { return true; }
 
     float32 blend = 0.5f;
 };
@@ -96,6 +118,9 @@ class MaxNode : public Node {
 public:
     MaxNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+    bool FoldsPendingRemap() const override { return true; }
+    bool HandlesSparseInput() const override { return true; }
 };
 
 // Combiner: Min
@@ -103,6 +128,9 @@ class MinNode : public Node {
 public:
     MinNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+    bool FoldsPendingRemap() const override { return true; }
+    bool HandlesSparseInput() const override { return true; }
 };
 
 // Output node (final result)
@@ -110,6 +138,7 @@ class OutputNode : public Node {
 public:
     OutputNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
 };
 
 } // namespace Terrain
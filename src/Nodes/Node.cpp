@@ -1,6 +1,8 @@
 #include "Node.h"
 #include "NodeGraph.h"
 #include "Core/Logger.h"
+#include <algorithm>
+#include <unordered_set>
 
 namespace Terrain {
 
@@ -12,9 +14,123 @@ Node::Node(uint32 id, const String& name, NodeCategory category)
 
 void Node::Reset() {
     m_CachedOutput.reset();
+    m_CachedLayers.reset();
+    m_ContentHash = 0;
+    MarkDirty();
+}
+
+bool Node::HashParameters(Hasher& hasher) const {
+    (void)hasher;
+    return false;
+}
+
+uint64 Node::ComputeContentHash() const {
+    Hasher hasher;
+    hasher.Add(kResultsVersion);
+    hasher.Add(m_Name);
+
+    if (!HashParameters(hasher)) {
+        return 0;
+    }
+
+    // Packed outputs differ from float32 ones, and whether packing happens
+    // depends on the consumers' tolerance
+    if (m_OutputPrecision != SamplePrecision::Float32) {
+        hasher.Add(static_cast<uint32>(m_OutputPrecision));
+        hasher.Add(GetConsumerTolerance());
+    }
+
+    for (const auto& input : m_Inputs) {
+        if (input->connectedPin) {
+            // Upstream output of unknown content makes this one unknown too
+            uint64 sourceHash = input->connectedPin->node->m_ContentHash;
+            if (sourceHash == 0) {
+                return 0;
+            }
+            hasher.Add(sourceHash);
+        } else {
+            // Unconnected inputs contribute their constant values
+            hasher.Add(input->floatValue);
+            hasher.Add(input->intValue);
+            hasher.Add(input->vec2Value.x);
+            hasher.Add(input->vec2Value.y);
+        }
+    }
+
+    return hasher.Get();
+}
+
+void Node::RestoreCachedOutput(Unique<Heightfield> heightfield, uint64 hash) {
+    m_CachedOutput = std::move(heightfield);
+    m_ContentHash = hash;
+    m_Dirty = false;
+}
+
+void Node::ReleaseOutput() {
+    m_CachedOutput.reset();
+    m_CachedLayers.reset();
+    m_DonateOutput = false;
     m_Dirty = true;
 }
 
+void Node::MarkDirty() {
+    std::vector<Node*> stack = { this };
+    std::unordered_set<Node*> visited;
+
+    while (!stack.empty()) {
+        Node* node = stack.back();
+        stack.pop_back();
+
+        if (!visited.insert(node).second) {
+            continue;
+        }
+        node->m_Dirty = true;
+        node->m_ContentHash = 0;
+
+        for (const auto& output : node->m_Outputs) {
+            for (NodePin* consumer : output->connections) {
+                stack.push_back(consumer->node);
+            }
+        }
+    }
+}
+
+void Node::SetOutputPrecision(SamplePrecision precision) {
+    if (precision != m_OutputPrecision) {
+        m_OutputPrecision = precision;
+        MarkDirty();
+    }
+}
+
+float32 Node::GetConsumerTolerance() const {
+    float32 tolerance = std::numeric_limits<float32>::infinity();
+    for (const auto& output : m_Outputs) {
+        for (NodePin* consumer : output->connections) {
+            tolerance = std::min(tolerance, consumer->node->GetInputTolerance());
+        }
+    }
+    return tolerance;
+}
+
+bool Node::ConsumersHandleSparse() const {
+    for (const auto& output : m_Outputs) {
+        for (NodePin* consumer : output->connections) {
+            if (!consumer->node->HandlesSparseInput()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+uint32 Node::GetConsumerCount() const {
+    uint32 count = 0;
+    for (const auto& output : m_Outputs) {
+        count += static_cast<uint32>(output->connections.size());
+    }
+    return count;
+}
+
 NodePin* Node::AddInputPin(const String& name, PinType type) {
     auto pin = MakeUnique<NodePin>();
     pin->id = s_NextPinID++;
@@ -86,14 +202,75 @@ Unique<Heightfield> Node::GetInputHeightfield(const String& pinName, NodeGraph*
         return nullptr;
     }
 
-    // Return a copy of the cached output
     if (sourceNode->m_CachedOutput) {
-        return MakeUnique<Heightfield>(*sourceNode->m_CachedOutput);
+        if (sourceNode->m_DonateOutput) {
+            // This is the output's last reader: take it, so the samples are
+            // unshared and can be modified in place
+            sourceNode->m_DonateOutput = false;
+            sourceNode->m_Dirty = true;
+            Unique<Heightfield> output = std::move(sourceNode->m_CachedOutput);
+            PrepareInput(*output);
+            return output;
+        }
+
+        // Share the cached output's samples; consumers that write to the
+        // returned heightfield get a private copy on first mutation.
+        // Packed, sparse or remapped outputs are expanded into a private
+        // float32 copy instead, unless this node reads them as they are.
+        auto output = MakeUnique<Heightfield>(*sourceNode->m_CachedOutput);
+        PrepareInput(*output);
+        return output;
     }
 
     return nullptr;
 }
 
+Unique<TerrainLayerStack> Node::GetInputLayerStack(const String& pinName, NodeGraph* graph) {
+    NodePin* pin = GetInputPin(pinName);
+    if (!pin || !pin->connectedPin) {
+        return nullptr;
+    }
+
+    Node* sourceNode = pin->connectedPin->node;
+    if (!sourceNode->Execute(graph)) {
+        LOG_ERROR("Failed to execute node: %s", sourceNode->GetName().c_str());
+        return nullptr;
+    }
+
+    if (!sourceNode->m_CachedLayers) {
+        return nullptr;
+    }
+    if (sourceNode->m_DonateOutput) {
+        // Last reader: take the stack so its channels can be written in place
+        sourceNode->m_DonateOutput = false;
+        sourceNode->m_Dirty = true;
+        return std::move(sourceNode->m_CachedLayers);
+    }
+    return MakeUnique<TerrainLayerStack>(*sourceNode->m_CachedLayers);
+}
+
+void Node::PrepareInput(Heightfield& input) const {
+    if (!HandlesSparseInput()) {
+        input.Expand();
+    }
+    if (FoldsPendingRemap()) {
+        input.Unpack();
+    } else {
+        input.Resolve();
+    }
+}
+
+void Node::SetOutputLayerStack(const String& pinName, Unique<TerrainLayerStack> layers) {
+    NodePin* pin = GetOutputPin(pinName);
+    if (!pin) {
+        LOG_ERROR("Output pin not found: %s", pinName.c_str());
+        return;
+    }
+
+    m_CachedLayers = std::move(layers);
+    m_Dirty = false;
+}
+
 float32 Node::GetInputFloat(const String& pinName, float32 defaultValue) {
     NodePin* pin = GetInputPin(pinName);
     if (!pin) {
@@ -145,6 +322,18 @@ void Node::SetOutputHeightfield(const String& pinName, Unique<Heightfield> heigh
 
     m_CachedOutput = std::move(heightfield);
     m_Dirty = false;
+
+    if (m_CachedOutput && m_OutputPrecision != SamplePrecision::Float32) {
+        float32 tolerance = GetConsumerTolerance();
+        if (!m_CachedOutput->Pack(m_OutputPrecision, tolerance)) {
+            LOG_DEBUG("%s: output kept at float32, 16-bit error exceeds consumer tolerance %g",
+                      m_Name.c_str(), tolerance);
+        }
+    } else if (m_CachedOutput && ConsumersHandleSparse() && m_CachedOutput->Compact()) {
+        // Mostly uniform, and no consumer would just expand it again
+        LOG_DEBUG("%s: output stored sparse, %u of %u tiles uniform", m_Name.c_str(),
+                  m_CachedOutput->GetUniformTileCount(), m_CachedOutput->GetTileCount());
+    }
 }
 
 } // namespace Terrain
@@ -1,10 +1,14 @@
 #pragma once
 
 #include "Core/Types.h"
+#include "Core/Hash.h"
 #include "Terrain/Heightfield.h"
+#include "Terrain/TerrainLayerStack.h"
+#include "Terrain/WorldRegion.h"
 #include <vector>
 #include <string>
 #include <memory>
+#include <limits>
 
 namespace Terrain {
 
@@ -18,7 +22,8 @@ enum class PinType {
     Float,
     Int,
     Vec2,
-    Vec3
+    Vec3,
+    LayerStack  // TerrainLayerStack: height and its companion layers together
 };
 
 // Node pin (input or output)
@@ -74,12 +79,96 @@ public:
     NodeCategory GetCategory() const { return m_Category; }
     const std::vector<Unique<NodePin>>& GetInputs() const { return m_Inputs; }
     const std::vector<Unique<NodePin>>& GetOutputs() const { return m_Outputs; }
+    uint32 GetConsumerCount() const;
+
+    // Pointwise nodes can be fused with their pointwise consumer (see PointwiseNode)
+    virtual bool IsPointwise() const { return false; }
 
     // Cache management
+    // MarkDirty invalidates this node and every node that (transitively)
+    // consumes its output; upstream caches stay valid.
     bool IsDirty() const { return m_Dirty; }
-    void MarkDirty() { m_Dirty = true; }
+    void MarkDirty();
     void MarkClean() { m_Dirty = false; }
 
+    // Scheduling: measured duration of the last execution, used to estimate
+    // critical paths (nodes that never ran count as one unit)
+    float64 GetLastExecutionTime() const { return m_LastExecutionTime; }
+    void SetLastExecutionTime(float64 seconds) { m_LastExecutionTime = seconds; }
+    float64 GetCostEstimate() const { return m_LastExecutionTime > 0.0 ? m_LastExecutionTime : 1.0; }
+
+    // Content hashing for the node output cache.
+    // Nodes whose output is fully determined by their parameters and inputs
+    // override HashParameters; the default marks the node as uncacheable.
+    virtual bool HashParameters(Hasher& hasher) const;
+
+    // Version of the node algorithms, part of every content hash. Hashes
+    // outlive the process in the DiskCache, so bump this whenever a change
+    // alters the output for unchanged parameters and inputs.
+    static constexpr uint32 kResultsVersion = 4; // 4: Add and Multiply keep raw world-region values
+
+    // Hash of the results version, node type, parameters, constant inputs and
+    // the content hashes of connected inputs. Returns 0 if the output cannot
+    // be cached.
+    uint64 ComputeContentHash() const;
+    uint64 GetContentHash() const { return m_ContentHash; }
+    void SetContentHash(uint64 hash) { m_ContentHash = hash; }
+
+    const Heightfield* GetCachedOutput() const { return m_CachedOutput.get(); }
+    const TerrainLayerStack* GetCachedLayers() const { return m_CachedLayers.get(); }
+    void RestoreCachedOutput(Unique<Heightfield> heightfield, uint64 hash);
+
+    // Memory planning: pinned nodes always keep their cached output, others
+    // may release it once every consumer in an execution has run
+    bool IsPinned() const { return m_Pinned; }
+    void SetPinned(bool pinned) { m_Pinned = pinned; }
+
+    // Drop the cached output (heightfield or layer stack) to free memory. The node becomes dirty but keeps
+    // its content hash, so re-executing it can be served from the NodeCache.
+    void ReleaseOutput();
+
+    // Storage precision of the cached output. 16-bit outputs are unpacked to
+    // float32 for each reader, and stay float32 if the precision's error
+    // bound exceeds what a consumer tolerates.
+    SamplePrecision GetOutputPrecision() const { return m_OutputPrecision; }
+    void SetOutputPrecision(SamplePrecision precision);
+
+    // Largest absolute error this node accepts in its heightfield inputs.
+    // Nodes that amplify small height differences return 0 to insist on
+    // float32 inputs.
+    virtual float32 GetInputTolerance() const { return std::numeric_limits<float32>::infinity(); }
+
+    // Smallest input tolerance among the consumers of this node's output
+    float32 GetConsumerTolerance() const;
+
+    // Nodes that apply their inputs' pending remaps (see Heightfield::Remap)
+    // while loading them; other nodes get resolved inputs
+    virtual bool FoldsPendingRemap() const { return false; }
+
+    // Nodes with fast paths for uniform tiles take sparse inputs as they are
+    // (see Heightfield::Compact); other nodes get them expanded. Outputs are
+    // only compacted if every consumer takes them sparse.
+    virtual bool HandlesSparseInput() const { return false; }
+    bool ConsumersHandleSparse() const;
+
+    // World-space generation (see NodeGraph::SetWorldRegion). Generators
+    // override SetWorldRegion to produce that region of the world instead
+    // of their own image; nullopt returns them to their image.
+    virtual void SetWorldRegion(const std::optional<WorldRegion>& region) { (void)region; }
+
+    // How far (in texels) edge effects reach into this node's output: an
+    // output sample depends on input samples up to this distance away
+    virtual uint32 GetStencilRadius() const { return 0; }
+
+    // False if an output sample can depend on input samples at any distance
+    // (whole-image statistics, randomly placed droplets). World regions are
+    // only seamless when every node is region local.
+    virtual bool IsRegionLocal() const { return true; }
+
+    // Hand the output to the next GetInputHeightfield instead of sharing it,
+    // so a sole consumer can modify the samples in place
+    void SetDonateOutput(bool donate) { m_DonateOutput = donate; }
+
     // UI position
     glm::vec2 GetPosition() const { return m_Position; }
     void SetPosition(const glm::vec2& pos) { m_Position = pos; }
@@ -91,8 +180,16 @@ protected:
     int32 GetInputInt(const String& pinName, int32 defaultValue = 0);
     glm::vec2 GetInputVec2(const String& pinName, const glm::vec2& defaultValue = glm::vec2(0.0f));
 
+    // Layer stack inputs share the source's channels, each copy-on-write
+    Unique<TerrainLayerStack> GetInputLayerStack(const String& pinName, NodeGraph* graph);
+
     // Helper for setting output
     void SetOutputHeightfield(const String& pinName, Unique<Heightfield> heightfield);
+    void SetOutputLayerStack(const String& pinName, Unique<TerrainLayerStack> layers);
+
+    // Unpack an input heightfield, expand it unless this node handles sparse
+    // inputs, and resolve it unless this node folds remaps
+    void PrepareInput(Heightfield& input) const;
 
     uint32 m_ID;
     String m_Name;
@@ -102,10 +199,16 @@ protected:
     std::vector<Unique<NodePin>> m_Outputs;
 
     bool m_Dirty = true;
+    bool m_Pinned = false;
+    bool m_DonateOutput = false;
+    SamplePrecision m_OutputPrecision = SamplePrecision::Float32;
+    float64 m_LastExecutionTime = 0.0;
+    uint64 m_ContentHash = 0; // Hash of the current cached output (0 = unknown)
     glm::vec2 m_Position = glm::vec2(0.0f);
 
     // Cached output
     Unique<Heightfield> m_CachedOutput;
+    Unique<TerrainLayerStack> m_CachedLayers; // For nodes with a LayerStack output
 
 private:
     static uint32 s_NextPinID;
@@ -0,0 +1,211 @@
+#include "NodeCache.h"
+#include "DiskCache.h"
+#include "Core/Logger.h"
+
+namespace Terrain {
+
+NodeCache::~NodeCache() {
+    // Queued writes are finished first
+    {
+        std::lock_guard<std::mutex> lock(m_WriteMutex);
+        m_StopWriter = true;
+    }
+    m_WriteCondition.notify_all();
+    if (m_Writer.joinable()) {
+        m_Writer.join();
+    }
+}
+
+Unique<Heightfield> NodeCache::Find(uint64 hash) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        auto it = m_Lookup.find(hash);
+        if (it != m_Lookup.end()) {
+            // Move to front (most recently used)
+            m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+            m_Hits++;
+            return MakeUnique<Heightfield>(*it->second->heightfield);
+        }
+    }
+
+    // Disk lookups happen outside the lock so other workers are not stalled
+    auto heightfield = DiskCache::Get().LoadHeightfield(hash);
+
+    std::vector<Entry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!heightfield) {
+            m_Misses++;
+            return nullptr;
+        }
+
+        m_DiskHits++;
+        InsertLocked(hash, *heightfield, evicted);
+    }
+    SpillToDisk(evicted);
+
+    return heightfield;
+}
+
+void NodeCache::Insert(uint64 hash, const Heightfield& heightfield, float64 computeSeconds) {
+    std::vector<Entry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        InsertLocked(hash, heightfield, evicted);
+    }
+    SpillToDisk(evicted);
+
+    // Persist expensive results right away so other processes and later
+    // sessions can reuse them; cheap ones only reach disk when evicted
+    if (computeSeconds >= m_WriteThroughSeconds && DiskCache::Get().IsEnabled()) {
+        QueueWrite(hash, heightfield);
+    }
+}
+
+void NodeCache::QueueWrite(uint64 hash, const Heightfield& heightfield) {
+    // Resolving, compressing and writing a large output takes about as long
+    // as many nodes do, so it happens on a thread of its own rather than on
+    // a worker (where the graph's completion could wait on it). The queued
+    // copy shares the samples.
+    Entry entry;
+    entry.hash = hash;
+    entry.heightfield = MakeUnique<Heightfield>(heightfield);
+    {
+        std::lock_guard<std::mutex> lock(m_WriteMutex);
+        if (!m_Writer.joinable()) {
+            m_Writer = std::thread([this] { WriterLoop(); });
+        }
+        m_WriteQueue.push_back(std::move(entry));
+    }
+    m_WriteCondition.notify_all();
+}
+
+void NodeCache::WriterLoop() {
+    std::unique_lock<std::mutex> lock(m_WriteMutex);
+    for (;;) {
+        m_WriteCondition.wait(lock, [&] { return m_StopWriter || !m_WriteQueue.empty(); });
+        if (m_WriteQueue.empty()) {
+            return;
+        }
+
+        Entry entry = std::move(m_WriteQueue.front());
+        m_WriteQueue.pop_front();
+        m_Writing = true;
+        lock.unlock();
+
+        DiskCache::Get().StoreHeightfield(entry.hash, *entry.heightfield);
+        entry.heightfield.reset();
+
+        lock.lock();
+        m_Writing = false;
+        m_WriteCondition.notify_all();
+    }
+}
+
+void NodeCache::WaitForWrites() {
+    std::unique_lock<std::mutex> lock(m_WriteMutex);
+    m_WriteCondition.wait(lock, [&] { return m_WriteQueue.empty() && !m_Writing; });
+}
+
+void NodeCache::InsertLocked(uint64 hash, const Heightfield& heightfield, std::vector<Entry>& evicted) {
+    auto it = m_Lookup.find(hash);
+    if (it != m_Lookup.end()) {
+        // Same content: just refresh recency
+        m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+        return;
+    }
+
+    uint64 bytes = heightfield.GetByteSize();
+    if (bytes > m_ByteBudget) {
+        return;
+    }
+
+    Entry entry;
+    entry.hash = hash;
+    entry.heightfield = MakeUnique<Heightfield>(heightfield);
+    entry.bytes = bytes;
+
+    m_Entries.push_front(std::move(entry));
+    m_Lookup[hash] = m_Entries.begin();
+    m_BytesUsed += bytes;
+
+    EvictToBudget(evicted);
+}
+
+void NodeCache::SetByteBudget(uint64 bytes) {
+    std::vector<Entry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_ByteBudget = bytes;
+        EvictToBudget(evicted);
+    }
+    SpillToDisk(evicted);
+}
+
+void NodeCache::EvictToBudget(std::vector<Entry>& evicted) {
+    while (m_BytesUsed > m_ByteBudget && !m_Entries.empty()) {
+        Entry& victim = m_Entries.back();
+        m_BytesUsed -= victim.bytes;
+        m_Lookup.erase(victim.hash);
+        evicted.push_back(std::move(victim));
+        m_Entries.pop_back();
+        m_Evictions++;
+    }
+}
+
+void NodeCache::SpillToDisk(std::vector<Entry>& evicted) {
+    DiskCache& disk = DiskCache::Get();
+    if (!disk.IsEnabled()) {
+        return;
+    }
+
+    for (const Entry& entry : evicted) {
+        disk.StoreHeightfield(entry.hash, *entry.heightfield);
+    }
+}
+
+NodeCacheStats NodeCache::GetStats() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    NodeCacheStats stats;
+    stats.hits = m_Hits;
+    stats.diskHits = m_DiskHits;
+    stats.misses = m_Misses;
+    stats.evictions = m_Evictions;
+    stats.entryCount = m_Entries.size();
+    stats.bytesUsed = m_BytesUsed;
+    stats.byteBudget = m_ByteBudget;
+    return stats;
+}
+
+void NodeCache::ResetStats() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Hits = 0;
+    m_DiskHits = 0;
+    m_Misses = 0;
+    m_Evictions = 0;
+}
+
+void NodeCache::LogStats() {
+    NodeCacheStats stats = GetStats();
+    LOG_INFO("Node cache: %llu hits, %llu disk hits, %llu misses, %llu evictions, %llu entries, %llu / %llu MB",
+             static_cast<unsigned long long>(stats.hits),
+             static_cast<unsigned long long>(stats.diskHits),
+             static_cast<unsigned long long>(stats.misses),
+             static_cast<unsigned long long>(stats.evictions),
+             static_cast<unsigned long long>(stats.entryCount),
+             static_cast<unsigned long long>(stats.bytesUsed / (1024 * 1024)),
+             static_cast<unsigned long long>(stats.byteBudget / (1024 * 1024)));
+
+    DiskCache::Get().LogStats();
+}
+
+void NodeCache::Clear() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.clear();
+    m_Lookup.clear();
+    m_BytesUsed = 0;
+}
+
+} // namespace Terrain
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Core/Types.h"
+#include "Terrain/Heightfield.h"
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace Terrain {
+
+struct NodeCacheStats {
+    uint64 hits = 0;
+    uint64 diskHits = 0;    // Memory misses served by the DiskCache
+    uint64 misses = 0;
+    uint64 evictions = 0;
+    uint64 entryCount = 0;
+    uint64 bytesUsed = 0;
+    uint64 byteBudget = 0;
+};
+
+// Global memoization cache for node outputs.
+// Entries are keyed by a node's content hash (node type, parameters and the
+// hashes of its inputs), so returning to a previous parameter value or
+// undoing an edit finds the earlier result instead of recomputing it.
+// Heightfields are stored copy-on-write, so a hit shares the cached samples.
+// Least recently used entries are evicted once the byte budget is exceeded;
+// when the DiskCache is enabled they are spilled to disk rather than dropped,
+// and memory misses are looked up on disk before reporting a miss.
+class NodeCache {
+public:
+    static NodeCache& Get() {
+        static NodeCache instance;
+        return instance;
+    }
+
+    // Returns the cached output for the hash, or nullptr on a miss
+    Unique<Heightfield> Find(uint64 hash);
+
+    // Store an output (shares its samples). Outputs that took at least the
+    // write-through threshold to compute are also queued for the DiskCache
+    // right away; a background thread writes them, off the graph's critical
+    // path.
+    void Insert(uint64 hash, const Heightfield& heightfield, float64 computeSeconds = 0.0);
+
+    // Block until every queued write-through is on disk
+    void WaitForWrites();
+
+    void SetByteBudget(uint64 bytes);
+    uint64 GetByteBudget() const { return m_ByteBudget; }
+
+    void SetWriteThroughSeconds(float64 seconds) { m_WriteThroughSeconds = seconds; }
+    float64 GetWriteThroughSeconds() const { return m_WriteThroughSeconds; }
+
+    NodeCacheStats GetStats();
+    void ResetStats();
+    void LogStats();
+    void Clear();
+
+private:
+    NodeCache() = default;
+    ~NodeCache();
+    NodeCache(const NodeCache&) = delete;
+    NodeCache& operator=(const NodeCache&) = delete;
+
+    struct Entry {
+        uint64 hash = 0;
+        Unique<Heightfield> heightfield;
+        uint64 bytes = 0;
+    };
+
+    // Evict least recently used entries until the budget is met (locked).
+    // Evicted entries are returned so they can be spilled after unlocking.
+    void EvictToBudget(std::vector<Entry>& evicted);
+    void SpillToDisk(std::vector<Entry>& evicted);
+    void InsertLocked(uint64 hash, const Heightfield& heightfield, std::vector<Entry>& evicted);
+
+    // Write-through queue, drained by m_Writer (started on first use)
+    void QueueWrite(uint64 hash, const Heightfield& heightfield);
+    void WriterLoop();
+
+    std::list<Entry> m_Entries; // Most recently used first
+    std::unordered_map<uint64, std::list<Entry>::iterator> m_Lookup;
+
+    uint64 m_ByteBudget = 2ull * 1024 * 1024 * 1024; // 2 GB
+    uint64 m_BytesUsed = 0;
+    float64 m_WriteThroughSeconds = 0.1;
+    uint64 m_Hits = 0;
+    uint64 m_DiskHits = 0;
+    uint64 m_Misses = 0;
+    uint64 m_Evictions = 0;
+
+    std::mutex m_Mutex;
+
+    std::mutex m_WriteMutex;
+    std::condition_variable m_WriteCondition;
+    std::deque<Entry> m_WriteQueue;
+    std::thread m_Writer;
+    bool m_Writing = false;
+    bool m_StopWriter = false;
+};
+
+} // namespace Terrain
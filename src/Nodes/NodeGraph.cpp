@@ -1,9 +1,14 @@
 #include "NodeGraph.h"
 #include "Core/Logger.h"
+#include "Terrain/PagedHeightfield.h"
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
 
 namespace Terrain {
 
 NodeGraph::NodeGraph() {
+    m_Executor = MakeUnique<GraphExecutor>(this);
     m_Generator = MakeUnique<TerrainGenerator>();
     if (!m_Generator->Initialize()) {
         LOG_ERROR("Failed to initialize terrain generator for node graph");
@@ -35,17 +40,20 @@ void NodeGraph::DeleteNode(uint32 nodeId) {
     }
 
     for (auto& output : node->GetOutputs()) {
-        // Disconnect all inputs connected to this output
+        // Disconnect all inputs connected to this output; their nodes and
+        // everything downstream of them lose this input
         for (NodePin* connectedInput : output->connections) {
             connectedInput->connectedPin = nullptr;
+            connectedInput->node->MarkDirty();
         }
     }
 
+    if (m_OutputNode == node) {
+        m_OutputNode = nullptr;
+    }
+
     // Remove the node
     m_Nodes.erase(it);
-
-    // Mark all nodes dirty since graph structure changed
-    MarkAllDirty();
 }
 
 Node* NodeGraph::GetNode(uint32 nodeId) {
@@ -83,6 +91,12 @@ bool NodeGraph::CreateConnection(uint32 outputPinId, uint32 inputPinId) {
         return false;
     }
 
+    // Reject connections that would make the graph cyclic
+    if (GraphExecutor::DependsOn(outputPin->node, inputPin->node)) {
+        LOG_ERROR("Cannot connect pins: connection would create a cycle");
+        return false;
+    }
+
     // Remove existing connection from input
     if (inputPin->connectedPin) {
         auto& oldConnections = inputPin->connectedPin->connections;
@@ -96,9 +110,15 @@ bool NodeGraph::CreateConnection(uint32 outputPinId, uint32 inputPinId) {
     inputPin->connectedPin = outputPin;
     outputPin->connections.push_back(inputPin);
 
-    // Mark downstream nodes dirty
+    // Mark the consuming node and everything downstream dirty
     inputPin->node->MarkDirty();
 
+    // A packed output may be coarser than the new consumer accepts
+    const Heightfield* output = outputPin->node->GetCachedOutput();
+    if (output && output->GetPackingError() > inputPin->node->GetInputTolerance()) {
+        outputPin->node->MarkDirty();
+    }
+
     return true;
 }
 
@@ -116,7 +136,7 @@ void NodeGraph::DeleteConnection(uint32 inputPinId) {
             // Clear input's connection
             pin->connectedPin = nullptr;
 
-            // Mark node dirty
+            // Mark node and everything downstream dirty
             node->MarkDirty();
             return;
         }
@@ -185,7 +205,7 @@ bool NodeGraph::ExecuteNode(Node* node) {
         return true;
     }
 
-    return node->Execute(this);
+    return m_Executor->Execute(node);
 }
 
 bool NodeGraph::ExecuteGraph() {
@@ -194,9 +214,128 @@ bool NodeGraph::ExecuteGraph() {
         return false;
     }
 
+    // Stencil parameters may have changed since the region was set
+    if (m_WorldRegion) {
+        if (const Node* node = FindNonLocalNode()) {
+            LOG_ERROR("Cannot generate world regions: the %s node depends on the whole image, so tiles would not "
+                      "match at their seams",
+                      node->GetName().c_str());
+            return false;
+        }
+        m_WorldHalo = GetWorldHalo();
+        WorldRegion grown = m_WorldRegion->Grown(m_WorldHalo);
+        for (auto& [id, node] : m_Nodes) {
+            node->SetWorldRegion(grown);
+        }
+    }
+
     return ExecuteNode(m_OutputNode);
 }
 
+void NodeGraph::SetWorldRegion(const std::optional<WorldRegion>& region) {
+    if (region && !m_WorldRegion) {
+        if (const Node* node = FindNonLocalNode()) {
+            LOG_WARN("The %s node depends on the whole image; world regions will not generate until it is removed",
+                     node->GetName().c_str());
+        }
+    }
+    m_WorldRegion = region;
+    if (!region) {
+        m_WorldHalo = 0;
+        for (auto& [id, node] : m_Nodes) {
+            node->SetWorldRegion(std::nullopt);
+        }
+    }
+}
+
+uint32 NodeGraph::GetWorldHalo() const {
+    if (!m_OutputNode) {
+        return 0;
+    }
+
+    // Longest path upstream of the output, each node visited once
+    std::unordered_map<const Node*, uint32> reach;
+    std::function<uint32(const Node*)> visit = [&](const Node* node) -> uint32 {
+        auto it = reach.find(node);
+        if (it != reach.end()) {
+            return it->second;
+        }
+        uint32 inputReach = 0;
+        for (const auto& input : node->GetInputs()) {
+            if (input->connectedPin) {
+                inputReach = std::max(inputReach, visit(input->connectedPin->node));
+            }
+        }
+        uint32 nodeReach = inputReach + node->GetStencilRadius();
+        reach[node] = nodeReach;
+        return nodeReach;
+    };
+    return visit(m_OutputNode);
+}
+
+const Node* NodeGraph::FindNonLocalNode() const {
+    if (!m_OutputNode) {
+        return nullptr;
+    }
+
+    std::unordered_set<const Node*> visited;
+    std::function<const Node*(const Node*)> visit = [&](const Node* node) -> const Node* {
+        if (!visited.insert(node).second) {
+            return nullptr;
+        }
+        if (!node->IsRegionLocal()) {
+            return node;
+        }
+        for (const auto& input : node->GetInputs()) {
+            if (input->connectedPin) {
+                if (const Node* found = visit(input->connectedPin->node)) {
+                    return found;
+                }
+            }
+        }
+        return nullptr;
+    };
+    return visit(m_OutputNode);
+}
+
+bool NodeGraph::ExecuteWorld(const WorldRegion& region, uint32 tileSize, PagedHeightfield& output) {
+    if (!m_OutputNode) {
+        LOG_WARN("No output node set");
+        return false;
+    }
+    if (const Node* node = FindNonLocalNode()) {
+        LOG_ERROR("Cannot generate a world region: the %s node depends on the whole image, so tiles would not "
+                  "match at their seams",
+                  node->GetName().c_str());
+        return false;
+    }
+    if (output.GetWidth() != region.width || output.GetHeight() != region.height || tileSize == 0) {
+        LOG_ERROR("Cannot generate a %ux%u world region into a %ux%u paged heightfield in %u-texel tiles",
+                  region.width, region.height, output.GetWidth(), output.GetHeight(), tileSize);
+        return false;
+    }
+
+    LOG_INFO("Generating %ux%u world region in %u-texel tiles...", region.width, region.height, tileSize);
+    std::optional<WorldRegion> previous = m_WorldRegion;
+    bool success = true;
+    for (uint32 y = 0; y < region.height && success; y += tileSize) {
+        for (uint32 x = 0; x < region.width; x += tileSize) {
+            SetWorldRegion(WorldRegion(region.texelX + x, region.texelY + y, std::min(tileSize, region.width - x),
+                                       std::min(tileSize, region.height - y), region.texelSize));
+            Unique<Heightfield> tile = ExecuteGraph() ? GetResult() : nullptr;
+            if (!tile) {
+                LOG_ERROR("Failed to generate the world tile at (%u, %u)", x, y);
+                success = false;
+                break;
+            }
+            output.WriteHeightfield(x, y, *tile);
+        }
+    }
+
+    SetWorldRegion(previous);
+    return success;
+}
+
 void NodeGraph::MarkAllDirty() {
     for (auto& [id, node] : m_Nodes) {
         node->MarkDirty();
@@ -204,12 +343,19 @@ void NodeGraph::MarkAllDirty() {
 }
 
 Unique<Heightfield> NodeGraph::GetResult() {
-    if (!m_OutputNode || !m_OutputNode->m_CachedOutput) {
+    if (!m_OutputNode || !m_OutputNode->GetCachedOutput()) {
         return nullptr;
     }
 
-    // Return a copy
-    return MakeUnique<Heightfield>(*m_OutputNode->m_CachedOutput);
+    const Heightfield& output = *m_OutputNode->GetCachedOutput();
+    if (m_WorldRegion && m_WorldHalo > 0) {
+        return output.Crop(m_WorldHalo, m_WorldHalo, m_WorldRegion->width, m_WorldRegion->height);
+    }
+
+    // Shares the cached samples (copy-on-write)
+    auto result = MakeUnique<Heightfield>(output);
+    result->Resolve();
+    return result;
 }
 
 void NodeGraph::Clear() {
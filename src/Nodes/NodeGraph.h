@@ -2,12 +2,15 @@
 
 #include "Core/Types.h"
 #include "Node.h"
+#include "GraphExecutor.h"
 #include "Terrain/TerrainGenerator.h"
 #include <vector>
 #include <unordered_map>
 
 namespace Terrain {
 
+class PagedHeightfield;
+
 // Node graph manages all nodes and connections
 class NodeGraph {
 public:
@@ -47,11 +50,15 @@ public:
     bool IsConnected(uint32 pinId) const;
     bool ConnectPins(Pin* outputPin, Pin* inputPin);
 
-    // Execution
+    // Execution (dependencies are scheduled as a DAG on the job system)
     bool ExecuteNode(Node* node);
     bool ExecuteGraph();
     void MarkAllDirty();
 
+    // Memory planning (pin nodes with Node::SetPinned to keep their outputs)
+    void SetMemoryPolicy(MemoryPolicy policy) { m_Executor->SetMemoryPolicy(policy); }
+    MemoryPolicy GetMemoryPolicy() const { return m_Executor->GetMemoryPolicy(); }
+
     // Output node
     void SetOutputNode(Node* node) { m_OutputNode = node; }
     Node* GetOutputNode() const { return m_OutputNode; }
@@ -59,6 +66,30 @@ public:
     // Get result
     Unique<Heightfield> GetResult();
 
+    // World-space generation: generators produce this region of an
+    // infinite world, grown by the halo the graph's stencil nodes need, and
+    // GetResult crops the halo off again. Results for neighboring regions
+    // then match bit for bit at their seams, provided every node between
+    // the generators and the output is region local (Node::IsRegionLocal);
+    // ExecuteGraph refuses graphs where one is not. Tiles can be generated
+    // in parallel with one graph per worker. nullopt returns the generators
+    // to their images.
+    void SetWorldRegion(const std::optional<WorldRegion>& region);
+    const std::optional<WorldRegion>& GetWorldRegion() const { return m_WorldRegion; }
+
+    // Texels of halo the output needs: the largest sum of stencil radii
+    // along any path from a generator to the output node
+    uint32 GetWorldHalo() const;
+
+    // First node upstream of the output that is not region local, or null
+    const Node* FindNonLocalNode() const;
+
+    // Generate a world region of any size into output (region-sized), one
+    // tileSize x tileSize region at a time. Only one tile's node outputs are
+    // in memory at once, plus output's resident tiles, so the region can be
+    // larger than RAM. The previous world region is restored afterwards.
+    bool ExecuteWorld(const WorldRegion& region, uint32 tileSize, PagedHeightfield& output);
+
     // Terrain generator (for nodes that need it)
     TerrainGenerator* GetGenerator() { return m_Generator.get(); }
 
@@ -70,7 +101,10 @@ private:
     uint32 m_NextNodeID = 1;
 
     Node* m_OutputNode = nullptr;
+    std::optional<WorldRegion> m_WorldRegion;
+    uint32 m_WorldHalo = 0; // Halo the generators were last given
     Unique<TerrainGenerator> m_Generator;
+    Unique<GraphExecutor> m_Executor;
 };
 
 } // namespace Terrain
@@ -0,0 +1,363 @@
+#include "PointwiseNode.h"
+#include "NodeGraph.h"
+#include "Core/Logger.h"
+#include "Core/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Terrain {
+
+namespace {
+    // Samples per block: ops run back to back over a block while it is in L1
+    constexpr uint32 kBlockSize = 1024;
+
+    // Samples per reduction chunk (fixed, so the combine order is too)
+    constexpr uint32 kReduceChunkSize = 64 * 1024;
+
+    void ApplyOp(const PointwiseOp& op, float32* values, uint32 count) {
+        switch (op.type) {
+            case PointwiseOpType::Scale: {
+                float32 scale = op.scale;
+                for (uint32 i = 0; i < count; i++) {
+                    values[i] = values[i] * scale;
+                }
+                break;
+            }
+            case PointwiseOpType::Clamp: {
+                float32 minValue = op.minValue;
+                float32 maxValue = op.maxValue;
+                for (uint32 i = 0; i < count; i++) {
+                    values[i] = std::clamp(values[i], minValue, maxValue);
+                }
+                break;
+            }
+            case PointwiseOpType::Power: {
+                float32 power = op.power;
+                for (uint32 i = 0; i < count; i++) {
+                    values[i] = std::pow(values[i], power);
+                }
+                break;
+            }
+            case PointwiseOpType::Normalize: {
+                // Same arithmetic as Heightfield::Normalize
+                float32 currentMin = op.inputMin;
+                float32 currentMax = op.inputMax;
+                if (currentMax - currentMin < 0.0001f) {
+                    std::fill(values, values + count, (op.minValue + op.maxValue) * 0.5f);
+                    break;
+                }
+                for (uint32 i = 0; i < count; i++) {
+                    values[i] = op.minValue + (values[i] - currentMin) / (currentMax - currentMin) * (op.maxValue - op.minValue);
+                }
+                break;
+            }
+            case PointwiseOpType::Terrace: {
+                float32 steps = static_cast<float32>(op.steps);
+                float32 blend = op.blend;
+                for (uint32 i = 0; i < count; i++) {
+                    float value = values[i];
+                    float stepped = std::floor(value * steps) / steps;
+                    values[i] = stepped * (1.0f - blend) + value * blend;
+                }
+                break;
+            }
+            case PointwiseOpType::Invert: {
+                float32 min = op.inputMin;
+                float32 max = op.inputMax;
+                for (uint32 i = 0; i < count; i++) {
+                    values[i] = max - values[i] + min;
+                }
+                break;
+            }
+            case PointwiseOpType::Remap: {
+                SampleRemap remap = op.remap;
+                for (uint32 i = 0; i < count; i++) {
+                    values[i] = remap.Apply(values[i]);
+                }
+                break;
+            }
+        }
+    }
+
+    // Apply an affine op as a pending remap of the heightfield. Same
+    // arithmetic as the sample loops in ApplyOp.
+    void FoldOp(const PointwiseOp& op, Heightfield& heightfield) {
+        SampleRemap remap;
+        switch (op.type) {
+            case PointwiseOpType::Scale:
+                remap.scale = op.scale;
+                break;
+            case PointwiseOpType::Normalize:
+                heightfield.Normalize(op.minValue, op.maxValue);
+                return;
+            case PointwiseOpType::Invert: {
+                HeightfieldStats stats = heightfield.GetStats();
+                remap.origin = stats.max;
+                remap.scale = -1.0f;
+                remap.offset = stats.min;
+                break;
+            }
+            case PointwiseOpType::Remap:
+                remap = op.remap;
+                break;
+            default:
+                return;
+        }
+        heightfield.Remap(remap);
+    }
+
+    void ApplyOps(const PointwiseOp* ops, size_t opCount, float32* values, uint32 count) {
+        for (size_t i = 0; i < opCount; i++) {
+            ApplyOp(ops[i], values, count);
+        }
+    }
+
+    // Running min/max of values after the first opCount ops, without storing
+    // them. Comparisons match std::min_element/max_element over the
+    // materialized buffer (first of equal values wins).
+    struct RangeReduction {
+        float32 min = 0.0f;
+        float32 max = 0.0f;
+        bool empty = true;
+
+        void Add(std::span<const float32> values, const PointwiseOp* ops, size_t opCount) {
+            float32 block[kBlockSize];
+            for (size_t b = 0; b < values.size(); b += kBlockSize) {
+                uint32 count = static_cast<uint32>(std::min<size_t>(kBlockSize, values.size() - b));
+                std::copy(values.begin() + b, values.begin() + b + count, block);
+                ApplyOps(ops, opCount, block, count);
+
+                uint32 first = 0;
+                if (empty) {
+                    min = block[0];
+                    max = block[0];
+                    first = 1;
+                    empty = false;
+                }
+                for (uint32 i = first; i < count; i++) {
+                    if (block[i] < min) min = block[i];
+                    if (max < block[i]) max = block[i];
+                }
+            }
+        }
+
+        void Merge(const RangeReduction& other) {
+            if (other.empty) {
+                return;
+            }
+            if (empty) {
+                *this = other;
+                return;
+            }
+            if (other.min < min) min = other.min;
+            if (max < other.max) max = other.max;
+        }
+    };
+
+    // Min/max of the source after the first opCount ops
+    void ReduceRange(std::span<const float32> source, const PointwiseOp* ops, size_t opCount,
+                     float32& outMin, float32& outMax) {
+        uint64 total = source.size();
+        uint32 chunkCount = static_cast<uint32>((total + kReduceChunkSize - 1) / kReduceChunkSize);
+        std::vector<RangeReduction> chunks(chunkCount);
+
+        ParallelFor(0, chunkCount, 1, [&](uint32 chunkBegin, uint32 chunkEnd) {
+            for (uint32 chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+                uint64 begin = static_cast<uint64>(chunk) * kReduceChunkSize;
+                uint64 end = std::min<uint64>(begin + kReduceChunkSize, total);
+                chunks[chunk].Add(source.subspan(begin, end - begin), ops, opCount);
+            }
+        });
+
+        RangeReduction range;
+        for (const RangeReduction& chunk : chunks) {
+            range.Merge(chunk);
+        }
+        outMin = range.min;
+        outMax = range.max;
+    }
+
+    // The same over sparse samples: a uniform tile is reduced as its one value
+    void ReduceRange(const Heightfield& source, const PointwiseOp* ops, size_t opCount,
+                     float32& outMin, float32& outMax) {
+        std::vector<RangeReduction> tiles(source.GetTileCount());
+
+        ParallelFor(0, source.GetTileCount(), 0, [&](uint32 tileBegin, uint32 tileEnd) {
+            for (uint32 index = tileBegin; index < tileEnd; index++) {
+                if (source.IsUniformTile(index)) {
+                    float32 value = source.GetTileValue(index);
+                    tiles[index].Add({ &value, 1 }, ops, opCount);
+                    continue;
+                }
+                HeightfieldView<const float32> view = source.GetTileView(index);
+                for (uint32 y = 0; y < view.height; y++) {
+                    tiles[index].Add(view.Row(y), ops, opCount);
+                }
+            }
+        });
+
+        RangeReduction range;
+        for (const RangeReduction& tile : tiles) {
+            range.Merge(tile);
+        }
+        outMin = range.min;
+        outMax = range.max;
+    }
+}
+
+PointwiseNode::PointwiseNode(uint32 id, const String& name, NodeCategory category)
+    : Node(id, name, category) {
+    AddInputPin("Input", PinType::Heightfield);
+    AddOutputPin("Output", PinType::Heightfield);
+}
+
+bool PointwiseNode::Execute(NodeGraph* graph) {
+    if (!m_Dirty) {
+        return true;
+    }
+
+    // Walk upstream through dirty pointwise nodes that feed nothing else
+    std::vector<PointwiseNode*> chain = { this };
+    while (true) {
+        NodePin* input = chain.back()->GetInputPin("Input");
+        if (!input || !input->connectedPin) {
+            break;
+        }
+
+        Node* source = input->connectedPin->node;
+        if (!source->IsPointwise() || !source->IsDirty() || source->GetConsumerCount() != 1) {
+            break;
+        }
+        chain.push_back(static_cast<PointwiseNode*>(source));
+    }
+
+    PointwiseNode* head = chain.back();
+    auto input = head->GetInputHeightfield("Input", graph);
+    if (!input) {
+        LOG_ERROR("%s node: no input", head->GetName().c_str());
+        return false;
+    }
+
+    std::vector<PointwiseOp> ops;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        (*it)->AppendOps(ops);
+    }
+
+    if (chain.size() > 1) {
+        LOG_DEBUG("Fused %zu pointwise nodes ending at %s", chain.size(), GetName().c_str());
+    }
+
+    SetOutputHeightfield("Output", Apply(std::move(input), ops));
+    return true;
+}
+
+bool PointwiseNode::IsRegionLocal() const {
+    std::vector<PointwiseOp> ops;
+    AppendOps(ops);
+    return std::none_of(ops.begin(), ops.end(), [](const PointwiseOp& op) { return op.NeedsInputRange(); });
+}
+
+Unique<Heightfield> PointwiseNode::Apply(Unique<Heightfield> input, std::vector<PointwiseOp>& ops) {
+    // Affine ops at either end only update the pending remap
+    size_t first = 0;
+    size_t last = ops.size();
+    while (first < last && ops[first].IsAffine()) {
+        FoldOp(ops[first++], *input);
+    }
+    while (last > first && ops[last - 1].IsAffine()) {
+        last--;
+    }
+    if (first == last) {
+        return input;
+    }
+
+    // The rest run in one pass, starting with whatever remap is pending
+    std::vector<PointwiseOp> pass;
+    SampleRemap pending = input->TakeRemap();
+    if (!pending.IsIdentity()) {
+        PointwiseOp remap;
+        remap.type = PointwiseOpType::Remap;
+        remap.remap = pending;
+        pass.push_back(remap);
+    }
+    pass.insert(pass.end(), ops.begin() + first, ops.begin() + last);
+
+    if (input->IsSparse()) {
+        return ApplySparse(std::move(input), pass, ops, last);
+    }
+
+    std::span<const float32> source = input->GetData();
+    uint64 total = source.size();
+
+    // Resolve input ranges in order; each depends on the ops before it
+    if (total > 0) {
+        for (size_t i = 0; i < pass.size(); i++) {
+            if (pass[i].NeedsInputRange() && i == 0) {
+                // The input's own range, usually cached by whoever produced it
+                pass[i].inputMin = input->GetMin();
+                pass[i].inputMax = input->GetMax();
+            } else if (pass[i].NeedsInputRange()) {
+                ReduceRange(source, pass.data(), i, pass[i].inputMin, pass[i].inputMax);
+            }
+        }
+    }
+
+    // Sole owner of the samples: transform them in place. Either way the
+    // output's statistics come out of the same pass, ready for the trailing
+    // affine ops.
+    Unique<Heightfield> output;
+    if (input->IsShared()) {
+        output = MakeUnique<Heightfield>(input->GetWidth(), input->GetHeight(), BufferInit::Uninitialized);
+    } else {
+        output = std::move(input);
+    }
+
+    output->Transform([&](float32* data, uint64 begin, uint64 end) {
+        for (uint64 b = begin; b < end; b += kBlockSize) {
+            uint32 count = static_cast<uint32>(std::min<uint64>(kBlockSize, end - b));
+            if (data != source.data()) {
+                std::copy(source.begin() + b, source.begin() + b + count, data + b);
+            }
+            ApplyOps(pass.data(), pass.size(), data + b, count);
+        }
+    });
+
+    for (size_t i = last; i < ops.size(); i++) {
+        FoldOp(ops[i], *output);
+    }
+    return output;
+}
+
+Unique<Heightfield> PointwiseNode::ApplySparse(Unique<Heightfield> input, std::vector<PointwiseOp>& pass,
+                                               const std::vector<PointwiseOp>& ops, size_t last) {
+    if (input->GetPixelCount() > 0) {
+        for (size_t i = 0; i < pass.size(); i++) {
+            if (pass[i].NeedsInputRange() && i == 0) {
+                pass[i].inputMin = input->GetMin();
+                pass[i].inputMax = input->GetMax();
+            } else if (pass[i].NeedsInputRange()) {
+                ReduceRange(*input, pass.data(), i, pass[i].inputMin, pass[i].inputMax);
+            }
+        }
+    }
+
+    // Uniform tiles take one evaluation of the ops and stay uniform. The
+    // tiles are rewritten in place, or in a copy if they are shared.
+    input->TransformTiles(
+        [&](uint32, float32 value) {
+            ApplyOps(pass.data(), pass.size(), &value, 1);
+            return value;
+        },
+        [&](uint32, HeightfieldView<float32> tile) {
+            for (uint32 y = 0; y < tile.height; y++) {
+                ApplyOps(pass.data(), pass.size(), tile.Row(y).data(), tile.width);
+            }
+        });
+
+    for (size_t i = last; i < ops.size(); i++) {
+        FoldOp(ops[i], *input);
+    }
+    return input;
+}
+
+} // namespace Terrain
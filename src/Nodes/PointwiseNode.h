@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Node.h"
+#include <vector>
+
+namespace Terrain {
+
+enum class PointwiseOpType : uint8 {
+    Scale,      // value * scale
+    Clamp,      // clamp(value, minValue, maxValue)
+    Power,      // pow(value, power)
+    Normalize,  // Remap the input range to [minValue, maxValue]
+    Terrace,    // Blend of floor(value * steps) / steps and value
+    Invert,     // inputMax - value + inputMin
+    Remap       // The input's pending SampleRemap
+};
+
+// One per-sample operation of a fused pointwise chain
+struct PointwiseOp {
+    PointwiseOpType type = PointwiseOpType::Scale;
+    float32 scale = 1.0f;
+    float32 minValue = 0.0f;
+    float32 maxValue = 1.0f;
+    float32 power = 1.0f;
+    float32 blend = 0.0f;
+    int32 steps = 1;
+
+    // Range of the op's input over the whole heightfield (Normalize, Invert),
+    // resolved by a reduction pass before the op is applied
+    float32 inputMin = 0.0f;
+    float32 inputMax = 0.0f;
+
+    SampleRemap remap;
+
+    bool NeedsInputRange() const {
+        return type == PointwiseOpType::Normalize || type == PointwiseOpType::Invert;
+    }
+
+    // Affine ops can be folded into a heightfield's pending remap
+    bool IsAffine() const {
+        return type == PointwiseOpType::Scale || type == PointwiseOpType::Normalize ||
+               type == PointwiseOpType::Invert || type == PointwiseOpType::Remap;
+    }
+};
+
+// Base class for nodes whose output sample depends only on the input sample
+// at the same position (plus, at most, the input's min/max).
+//
+// Executing such a node also evaluates the dirty pointwise nodes feeding it
+// that have no other consumer: their ops are concatenated and applied in one
+// blocked pass over the chain's source, so at most the final buffer is
+// allocated. Fused upstream nodes stay dirty and never materialize an output.
+// Ops that need the range of their input get it from a read-only reduction
+// pass over the preceding ops, so results are identical to running each node
+// separately.
+//
+// Affine ops at either end of the chain touch no samples: they become the
+// output's pending remap (see Heightfield::Remap), and a remap pending on the
+// input is applied in the pass itself. A chain of only affine ops is O(1).
+//
+// Sparse inputs stay sparse: each uniform tile is evaluated once, as its
+// single value.
+class PointwiseNode : public Node {
+public:
+    PointwiseNode(uint32 id, const String& name, NodeCategory category);
+
+    bool Execute(NodeGraph* graph) override;
+    bool IsPointwise() const override { return true; }
+    bool FoldsPendingRemap() const override { return true; }
+    bool HandlesSparseInput() const override { return true; }
+
+    // Ops that need their input's range depend on the whole image
+    bool IsRegionLocal() const override;
+
+    // Append this node's operations, in evaluation order
+    virtual void AppendOps(std::vector<PointwiseOp>& ops) const = 0;
+
+    // Evaluate ops over the input. Works in place when the input's samples
+    // are not shared, otherwise writes a new heightfield.
+    static Unique<Heightfield> Apply(Unique<Heightfield> input, std::vector<PointwiseOp>& ops);
+
+private:
+    // Apply's pass over sparse tiles; ops from last on are folded afterwards
+    static Unique<Heightfield> ApplySparse(Unique<Heightfield> input, std::vector<PointwiseOp>& pass,
+                                           const std::vector<PointwiseOp>& ops, size_t last);
+};
+
+} // namespace Terrain
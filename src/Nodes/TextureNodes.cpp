@@ -1,17 +1,54 @@
 #include "TextureNodes.h"
 #include "NodeGraph.h"
+#include "DiskCache.h"
 #include "Core/Logger.h"
 
 namespace Terrain {
 
 // ============================================================================
-// Normal Map Node
+// Texture Node
 // ============================================================================
 
-NormalMapNode::NormalMapNode(uint32 id)
-    : Node(id, "Normal Map", NodeCategory::Output) {
+TextureNode::TextureNode(uint32 id, const String& name, const String& defaultOutputPath)
+    : Node(id, name, NodeCategory::Output), outputPath(defaultOutputPath) {
     AddInputPin("Input", PinType::Heightfield);
+}
+
+bool TextureNode::ProduceTexture(const char* description, const std::function<Unique<Texture>()>& generate) {
+    // Reuse a texture generated earlier (possibly by another process)
+    // from the same input and parameters
+    uint64 hash = ComputeContentHash();
+    m_CachedTexture = hash != 0 ? DiskCache::Get().LoadTexture(hash) : nullptr;
+
+    if (!m_CachedTexture) {
+        LOG_INFO("Generating %s...", description);
+        m_CachedTexture = generate();
+
+        if (!m_CachedTexture) {
+            LOG_ERROR("Failed to generate %s", description);
+            return false;
+        }
+
+        if (hash != 0) {
+            DiskCache::Get().StoreTexture(hash, *m_CachedTexture);
+        }
+    }
+
+    // Auto-export if path is set
+    if (!outputPath.empty()) {
+        m_CachedTexture->ExportPNG(outputPath);
+    }
 
+    m_Dirty = false;
+    return true;
+}
+
+// ============================================================================
+// Normal Map Node
+// ============================================================================
+
+NormalMapNode::NormalMapNode(uint32 id)
+    : TextureNode(id, "Normal Map", "normal_map.png") {
     // Default parameters
     params.strength = 1.0f;
     params.heightScale = 1.0f;
@@ -29,23 +66,16 @@ bool NormalMapNode::Execute(NodeGraph* graph) {
         return false;
     }
 
-    LOG_INFO("Generating normal map...");
-
-    // Generate normal map
-    NormalMapGenerator generator;
-    m_CachedTexture = generator.Generate(*input, params);
-
-    if (!m_CachedTexture) {
-        LOG_ERROR("Failed to generate normal map");
-        return false;
-    }
-
-    // Auto-export if path is set
-    if (!outputPath.empty()) {
-        m_CachedTexture->ExportPNG(outputPath);
-    }
+    return ProduceTexture("normal map", [&] {
+        NormalMapGenerator generator;
+        return generator.Generate(*input, params);
+    });
+}
 
-    m_Dirty = false;
+bool NormalMapNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(params.strength);
+    hasher.Add(params.heightScale);
+    hasher.Add(params.invertY);
     return true;
 }
 
@@ -54,9 +84,7 @@ bool NormalMapNode::Execute(NodeGraph* graph) {
 // ============================================================================
 
 AmbientOcclusionNode::AmbientOcclusionNode(uint32 id)
-    : Node(id, "Ambient Occlusion", NodeCategory::Output) {
-    AddInputPin("Input", PinType::Heightfield);
-
+    : TextureNode(id, "Ambient Occlusion", "ambient_occlusion.png") {
     // Default parameters
     params.samples = 16;
     params.radius = 10.0f;
@@ -76,23 +104,18 @@ bool AmbientOcclusionNode::Execute(NodeGraph* graph) {
         return false;
     }
 
-    LOG_INFO("Generating ambient occlusion (this may take a while)...");
-
-    // Generate AO
-    AmbientOcclusionGenerator generator;
-    m_CachedTexture = generator.Generate(*input, params);
-
-    if (!m_CachedTexture) {
-        LOG_ERROR("Failed to generate ambient occlusion");
-        return false;
-    }
-
-    // Auto-export if path is set
-    if (!outputPath.empty()) {
-        m_CachedTexture->ExportPNG(outputPath);
-    }
+    return ProduceTexture("ambient occlusion", [&] {
+        AmbientOcclusionGenerator generator;
+        return generator.Generate(*input, params);
+    });
+}
 
-    m_Dirty = false;
+bool AmbientOcclusionNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(params.samples);
+    hasher.Add(params.radius);
+    hasher.Add(params.strength);
+    hasher.Add(params.bias);
+    hasher.Add(params.heightScale);
     return true;
 }
 
@@ -101,9 +124,7 @@ bool AmbientOcclusionNode::Execute(NodeGraph* graph) {
 // ============================================================================
 
 SplatmapNode::SplatmapNode(uint32 id)
-    : Node(id, "Splatmap", NodeCategory::Output) {
-    AddInputPin("Input", PinType::Heightfield);
-
+    : TextureNode(id, "Splatmap", "splatmap.png") {
     // Use mountain preset by default
     params = SplatmapGenerator::CreateMountainPreset();
 }
@@ -119,23 +140,25 @@ bool SplatmapNode::Execute(NodeGraph* graph) {
         return false;
     }
 
-    LOG_INFO("Generating splatmap...");
-
-    // Generate splatmap
-    SplatmapGenerator generator;
-    m_CachedTexture = generator.Generate(*input, params);
-
-    if (!m_CachedTexture) {
-        LOG_ERROR("Failed to generate splatmap");
-        return false;
-    }
+    return ProduceTexture("splatmap", [&] {
+        SplatmapGenerator generator;
+        return generator.Generate(*input, params);
+    });
+}
 
-    // Auto-export if path is set
-    if (!outputPath.empty()) {
-        m_CachedTexture->ExportPNG(outputPath);
+bool SplatmapNode::HashParameters(Hasher& hasher) const {
+    hasher.Add(params.layerCount);
+    hasher.Add(params.heightScale);
+    for (uint32 i = 0; i < params.layerCount && i < 4; i++) {
+        const MaterialLayer& layer = params.layers[i];
+        hasher.Add(layer.heightMin);
+        hasher.Add(layer.heightMax);
+        hasher.Add(layer.slopeMin);
+        hasher.Add(layer.slopeMax);
+        hasher.Add(layer.blendRange);
+        hasher.Add(layer.noiseScale);
+        hasher.Add(layer.seed);
     }
-
-    m_Dirty = false;
     return true;
 }
 
@@ -4,56 +4,62 @@
 #include "Texture/NormalMapGenerator.h"
 #include "Texture/AmbientOcclusionGenerator.h"
 #include "Texture/SplatmapGenerator.h"
+#include <functional>
 
 namespace Terrain {
 
 // Note: Texture nodes are special - they don't output heightfields,
-// but generate textures that are saved separately
+// but generate textures that are saved separately. Generated textures are
+// kept in the DiskCache under the node's content hash.
 
-// Normal Map Generator Node
-class NormalMapNode : public Node {
+// Base of the texture nodes: owns the generated texture and its auto-export
+class TextureNode : public Node {
 public:
-    NormalMapNode(uint32 id);
-    bool Execute(NodeGraph* graph) override;
+    TextureNode(uint32 id, const String& name, const String& defaultOutputPath);
 
-    NormalMapParams params;
-    String outputPath = "normal_map.png";
+    String outputPath;
 
     // Cached texture result
     Unique<Texture> GetTexture() const { return m_CachedTexture ? MakeUnique<Texture>(*m_CachedTexture) : nullptr; }
 
-private:
+protected:
+    // Reuses a texture generated earlier (possibly by another process) from
+    // the same input and parameters, or calls generate and stores its result
+    // in the DiskCache; then exports to outputPath if set. description names
+    // the texture in log messages.
+    bool ProduceTexture(const char* description, const std::function<Unique<Texture>()>& generate);
+
     Unique<Texture> m_CachedTexture;
 };
 
+// Normal Map Generator Node
+class NormalMapNode : public TextureNode {
+public:
+    NormalMapNode(uint32 id);
+    bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
+
+    NormalMapParams params;
+};
+
 // Ambient Occlusion Generator Node
-class AmbientOcclusionNode : public Node {
+class AmbientOcclusionNode : public TextureNode {
 public:
     AmbientOcclusionNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
 
     AmbientOcclusionParams params;
-    String outputPath = "ambient_occlusion.png";
-
-    Unique<Texture> GetTexture() const { return m_CachedTexture ? MakeUnique<Texture>(*m_CachedTexture) : nullptr; }
-
-private:
-    Unique<Texture> m_CachedTexture;
 };
 
 // Splatmap Generator Node
-class SplatmapNode : public Node {
+class SplatmapNode : public TextureNode {
 public:
     SplatmapNode(uint32 id);
     bool Execute(NodeGraph* graph) override;
+    bool HashParameters(Hasher& hasher) const override;
 
     SplatmapParams params;
-    String outputPath = "splatmap.png";
-
-    Unique<Texture> GetTexture() const { return m_CachedTexture ? MakeUnique<Texture>(*m_CachedTexture) : nullptr; }
-
-private:
-    Unique<Texture> m_CachedTexture;
 };
 
 } // namespace Terrain
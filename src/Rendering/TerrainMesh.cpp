@@ -25,21 +25,25 @@ void TerrainMesh::GenerateFromHeightfield(const Heightfield& heightfield, float3
     // Generate vertices
     m_Vertices.reserve(width * height);
 
+    Heightfield resolved = heightfield.GetResolved();
+    HeightfieldView<const float32> heights = resolved.GetView();
+
     for (uint32 y = 0; y < height; y++) {
+        std::span<const float32> row = heights.Row(y);
         for (uint32 x = 0; x < width; x++) {
             Vertex vertex;
 
             // Position
             vertex.position.x = static_cast<float32>(x) - width * 0.5f;
             vertex.position.z = static_cast<float32>(y) - height * 0.5f;
-            vertex.position.y = heightfield.GetHeight(x, y) * heightScale;
+            vertex.position.y = row[x] * heightScale;
 
             // Texture coordinates
             vertex.texCoord.x = static_cast<float32>(x) / (width - 1);
             vertex.texCoord.y = static_cast<float32>(y) / (height - 1);
 
             // Color based on height (for clay rendering)
-            float32 normalizedHeight = heightfield.GetHeight(x, y);
+            float32 normalizedHeight = row[x];
             vertex.color = glm::vec3(normalizedHeight);
 
             // Normal (calculated later)
@@ -3,6 +3,7 @@
 #include "Nodes/GeneratorNodes.h"
 #include "Nodes/ModifierNodes.h"
 #include "Nodes/ErosionNodes.h"
+#include "Nodes/LayerNodes.h"
 #include "Nodes/TextureNodes.h"
 #include "Nodes/MeshExportNodes.h"
 #include <fstream>
@@ -156,6 +157,14 @@ json GraphSerializer::SerializeNode(const Node* node) {
     glm::vec2 pos = node->GetPosition();
     j["position"] = {pos.x, pos.y};
 
+    if (node->IsPinned()) {
+        j["pinned"] = true;
+    }
+
+    if (node->GetOutputPrecision() != SamplePrecision::Float32) {
+        j["precision"] = node->GetOutputPrecision() == SamplePrecision::Float16 ? "fp16" : "unorm16";
+    }
+
     // Parameters
     j["params"] = SerializeNodeParams(node);
 
@@ -181,6 +190,19 @@ Node* GraphSerializer::DeserializeNode(NodeGraph* graph, const json& j) {
             node->SetPosition(glm::vec2(x, y));
         }
 
+        if (j.contains("pinned")) {
+            node->SetPinned(j["pinned"].get<bool>());
+        }
+
+        if (j.contains("precision")) {
+            String precision = j["precision"];
+            if (precision == "fp16") {
+                node->SetOutputPrecision(SamplePrecision::Float16);
+            } else if (precision == "unorm16") {
+                node->SetOutputPrecision(SamplePrecision::UNorm16);
+            }
+        }
+
         // Deserialize parameters
         if (j.contains("params")) {
             DeserializeNodeParams(node, j["params"]);
@@ -289,6 +311,11 @@ Node* GraphSerializer::CreateNodeFromType(NodeGraph* graph, const String& type,
     // Erosion nodes
     else if (type == "HydraulicErosion") node = graph->CreateNodeWithID<HydraulicErosionNode>(id);
     else if (type == "ThermalErosion") node = graph->CreateNodeWithID<ThermalErosionNode>(id);
+    else if (type == "LayeredThermalErosion") node = graph->CreateNodeWithID<LayeredThermalErosionNode>(id);
+
+    // Layer nodes
+    else if (type == "LayerStack") node = graph->CreateNodeWithID<LayerStackNode>(id);
+    else if (type == "ExtractLayer") node = graph->CreateNodeWithID<LayerExtractNode>(id);
 
     // Texture nodes
     else if (type == "NormalMap") node = graph->CreateNodeWithID<NormalMapNode>(id);
@@ -354,6 +381,11 @@ json GraphSerializer::SerializeNodeParams(const Node* node) {
         params["scale"] = scale->params.scale;
         params["bias"] = scale->params.bias;
     }
+    // Extract Layer
+    else if (type == "ExtractLayer") {
+        auto* extract = static_cast<const LayerExtractNode*>(node);
+        params["layer"] = static_cast<int>(extract->layer);
+    }
     // Add more node types as needed...
 
     return params;
@@ -400,6 +432,20 @@ bool GraphSerializer::DeserializeNodeParams(Node* node, const json& j) {
             if (j.contains("scale")) scale->params.scale = j["scale"];
             if (j.contains("bias")) scale->params.bias = j["bias"];
         }
+        // Extract Layer
+        else if (type == "ExtractLayer") {
+            auto* extract = static_cast<LayerExtractNode*>(node);
+            if (j.contains("layer")) {
+                // Indexes the stack's channels, so it must name a layer
+                int layer = j["layer"].get<int>();
+                if (layer >= 0 && layer < static_cast<int>(kTerrainLayerCount)) {
+                    extract->layer = static_cast<TerrainLayer>(layer);
+                } else {
+                    LOG_ERROR("ExtractLayer node %u: invalid layer %d, using %s", node->GetID(), layer,
+                              GetTerrainLayerName(extract->layer));
+                }
+            }
+        }
         // Add more node types as needed...
 
         return true;
@@ -1,30 +1,947 @@
 #include "Heightfield.h"
 #include "Core/Logger.h"
+#include "Core/JobSystem.h"
 #include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cmath>
 #include <cstring>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 namespace Terrain {
 
-Heightfield::Heightfield(uint32 width, uint32 height)
+namespace {
+    // Scalar conversions, rounding to nearest even like the SIMD paths
+    uint16 FloatToHalf(float32 value) {
+        uint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint32 sign = (bits >> 16) & 0x8000;
+        uint32 magnitude = bits & 0x7FFFFFFF;
+
+        if (magnitude >= 0x7F800000) {
+            // Infinity stays infinite, NaN stays (quiet) NaN
+            return static_cast<uint16>(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 | ((magnitude >> 13) & 0x3FF) : 0));
+        }
+        if (magnitude >= 0x477FF000) {
+            // 65520 and up round past the largest half
+            return static_cast<uint16>(sign | 0x7C00);
+        }
+        if (magnitude < 0x38800000) {
+            // Below 2^-14: subnormal half in units of 2^-24
+            if (magnitude <= 0x33000000) {
+                return static_cast<uint16>(sign);
+            }
+            uint32 mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+            uint32 shift = 126 - (magnitude >> 23);
+            uint32 half = mantissa >> shift;
+            uint32 remainder = mantissa & ((1u << shift) - 1);
+            uint32 halfway = 1u << (shift - 1);
+            if (remainder > halfway || (remainder == halfway && (half & 1))) {
+                half++;
+            }
+            return static_cast<uint16>(sign | half);
+        }
+
+        // Rebias the exponent from 127 to 15 and drop 13 mantissa bits
+        uint32 half = (magnitude - 0x38000000) >> 13;
+        uint32 remainder = magnitude & 0x1FFF;
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+            half++;
+        }
+        return static_cast<uint16>(sign | half);
+    }
+
+    float32 HalfToFloat(uint16 half) {
+        uint32 sign = static_cast<uint32>(half & 0x8000) << 16;
+        uint32 exponent = (half >> 10) & 0x1F;
+        uint32 mantissa = half & 0x3FF;
+
+        uint32 bits;
+        if (exponent == 0) {
+            // Zero or subnormal: mantissa * 2^-24 is exact in float32
+            float32 value = static_cast<float32>(mantissa) * 5.9604644775390625e-8f;
+            return sign ? -value : value;
+        } else if (exponent == 31) {
+            bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0);
+        } else {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+
+        float32 value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint16 FloatToUNorm16(float32 value, float32 offset, float32 invScale) {
+        float32 code = std::nearbyint((value - offset) * invScale);
+        return static_cast<uint16>(std::clamp(code, 0.0f, 65535.0f));
+    }
+
+    // code * scale is exact in double, so the result is the same whether or
+    // not the compiler fuses the multiply-add
+    float32 UNorm16ToFloat(uint16 code, float32 offset, float32 scale) {
+        return static_cast<float32>(static_cast<float64>(offset) + static_cast<float64>(code) * scale);
+    }
+
+    // Samples per statistics chunk. Chunks are fixed and combined in order,
+    // so the result does not depend on the thread count.
+    constexpr uint64 kStatsChunkSize = 64 * 1024;
+
+    struct BlockStats {
+        float32 min;
+        float32 max;
+        float64 sum;
+    };
+
+    // Min, max and sum of a block in one pass over 8 lanes (AVX2 in AVX2
+    // builds). The scalar loop keeps the same lanes, so both paths agree.
+    BlockStats ReduceBlock(const float32* source, uint64 count) {
+        constexpr uint32 kLanes = 8;
+        float32 lo[kLanes];
+        float32 hi[kLanes];
+        float64 sum[kLanes] = {};
+        std::fill(lo, lo + kLanes, source[0]);
+        std::fill(hi, hi + kLanes, source[0]);
+
+        uint64 i = 0;
+#if defined(__AVX2__)
+        __m256 loV = _mm256_loadu_ps(lo);
+        __m256 hiV = _mm256_loadu_ps(hi);
+        __m256d sumLow = _mm256_setzero_pd();
+        __m256d sumHigh = _mm256_setzero_pd();
+        for (; i + kLanes <= count; i += kLanes) {
+            __m256 v = _mm256_loadu_ps(source + i);
+            loV = _mm256_min_ps(v, loV);
+            hiV = _mm256_max_ps(v, hiV);
+            sumLow = _mm256_add_pd(sumLow, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+            sumHigh = _mm256_add_pd(sumHigh, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+        }
+        _mm256_storeu_ps(lo, loV);
+        _mm256_storeu_ps(hi, hiV);
+        _mm256_storeu_pd(sum, sumLow);
+        _mm256_storeu_pd(sum + 4, sumHigh);
+#else
+        for (; i + kLanes <= count; i += kLanes) {
+            for (uint32 lane = 0; lane < kLanes; lane++) {
+                float32 v = source[i + lane];
+                lo[lane] = v < lo[lane] ? v : lo[lane];
+                hi[lane] = v > hi[lane] ? v : hi[lane];
+                sum[lane] += v;
+            }
+        }
+#endif
+
+        BlockStats stats = { lo[0], hi[0], 0.0 };
+        for (uint32 lane = 0; lane < kLanes; lane++) {
+            stats.min = std::min(stats.min, lo[lane]);
+            stats.max = std::max(stats.max, hi[lane]);
+            stats.sum += sum[lane];
+        }
+        for (; i < count; i++) {
+            stats.min = std::min(stats.min, source[i]);
+            stats.max = std::max(stats.max, source[i]);
+            stats.sum += source[i];
+        }
+        return stats;
+    }
+
+    void MergeBlock(BlockStats& into, const BlockStats& block) {
+        into.min = std::min(into.min, block.min);
+        into.max = std::max(into.max, block.max);
+        into.sum += block.sum;
+    }
+
+    // Combine per-chunk results in order
+    HeightfieldStats CombineBlocks(const std::vector<BlockStats>& blocks, uint64 count) {
+        HeightfieldStats stats;
+        stats.min = blocks[0].min;
+        stats.max = blocks[0].max;
+        float64 sum = 0.0;
+        for (const BlockStats& block : blocks) {
+            stats.min = std::min(stats.min, block.min);
+            stats.max = std::max(stats.max, block.max);
+            sum += block.sum;
+        }
+        stats.mean = static_cast<float32>(sum / static_cast<float64>(count));
+        return stats;
+    }
+
+    // Samples per sparse tile slot; edge tiles leave part of theirs unused
+    constexpr uint64 kTileSlotSize = static_cast<uint64>(kSparseTileSize) * kSparseTileSize;
+    constexpr uint32 kUniformSlot = ~0u;
+
+    // Bitwise, so tiles of -0 or NaN stay exactly what was stored
+    bool IsUniformRegion(HeightfieldView<const float32> region) {
+        uint32 first = std::bit_cast<uint32>(region(0, 0));
+        for (uint32 y = 0; y < region.height; y++) {
+            for (float32 sample : region.Row(y)) {
+                if (std::bit_cast<uint32>(sample) != first) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Block conversions. AVX2 builds convert 8 samples at a time (F16C for
+    // halves); the scalar loop finishes the tail and serves other targets.
+    void EncodeHalf(const float32* source, uint16* dest, uint64 count) {
+        uint64 i = 0;
+#if defined(__AVX2__) && (defined(__F16C__) || defined(_MSC_VER))
+        for (; i + 8 <= count; i += 8) {
+            __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), half);
+        }
+#endif
+        for (; i < count; i++) {
+            dest[i] = FloatToHalf(source[i]);
+        }
+    }
+
+    void DecodeHalf(const uint16* source, float32* dest, uint64 count) {
+        uint64 i = 0;
+#if defined(__AVX2__) && (defined(__F16C__) || defined(_MSC_VER))
+        for (; i + 8 <= count; i += 8) {
+            __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+            _mm256_storeu_ps(dest + i, _mm256_cvtph_ps(half));
+        }
+#endif
+        for (; i < count; i++) {
+            dest[i] = HalfToFloat(source[i]);
+        }
+    }
+
+    void EncodeUNorm16(const float32* source, uint16* dest, uint64 count, float32 offset, float32 invScale) {
+        uint64 i = 0;
+#if defined(__AVX2__)
+        __m256 offsetV = _mm256_set1_ps(offset);
+        __m256 invScaleV = _mm256_set1_ps(invScale);
+        __m256 maxCode = _mm256_set1_ps(65535.0f);
+        for (; i + 8 <= count; i += 8) {
+            __m256 scaled = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(source + i), offsetV), invScaleV);
+            scaled = _mm256_round_ps(scaled, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            scaled = _mm256_min_ps(_mm256_max_ps(scaled, _mm256_setzero_ps()), maxCode);
+            __m256i codes = _mm256_cvtps_epi32(scaled);
+            // packus works within 128-bit lanes: pack, then gather the two halves
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(codes, codes), 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm256_castsi256_si128(packed));
+        }
+#endif
+        for (; i < count; i++) {
+            dest[i] = FloatToUNorm16(source[i], offset, invScale);
+        }
+    }
+
+    void DecodeUNorm16(const uint16* source, float32* dest, uint64 count, float32 offset, float32 scale) {
+        uint64 i = 0;
+#if defined(__AVX2__)
+        __m256d offsetV = _mm256_set1_pd(offset);
+        __m256d scaleV = _mm256_set1_pd(scale);
+        for (; i + 8 <= count; i += 8) {
+            __m256i codes = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+            __m256d low = _mm256_add_pd(offsetV, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(codes)), scaleV));
+            __m256d high = _mm256_add_pd(offsetV, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(codes, 1)), scaleV));
+            _mm_storeu_ps(dest + i, _mm256_cvtpd_ps(low));
+            _mm_storeu_ps(dest + i + 4, _mm256_cvtpd_ps(high));
+        }
+#endif
+        for (; i < count; i++) {
+            dest[i] = UNorm16ToFloat(source[i], offset, scale);
+        }
+    }
+}
+
+float32 GetPrecisionErrorBound(SamplePrecision precision, float32 minVal, float32 maxVal) {
+    float32 magnitude = std::max(std::abs(minVal), std::abs(maxVal));
+
+    switch (precision) {
+        case SamplePrecision::Float16: {
+            if (!(magnitude < 65520.0f)) {
+                return std::numeric_limits<float32>::infinity();
+            }
+            // Half an ulp of the largest binade in range; below 2^-14 the
+            // spacing is a fixed 2^-24
+            int32 exponent = 0;
+            std::frexp(magnitude, &exponent);
+            return std::ldexp(1.0f, std::max(exponent - 1, -14) - 11);
+        }
+        case SamplePrecision::UNorm16: {
+            float32 step = (maxVal - minVal) / 65535.0f;
+            if (!std::isfinite(step)) {
+                return std::numeric_limits<float32>::infinity();
+            }
+            // Half a level from rounding, plus float32 rounding when
+            // scaling and decoding
+            return step * 0.5f + magnitude * 4.0f * FLT_EPSILON;
+        }
+        default:
+            return 0.0f;
+    }
+}
+
+// Sparse samples: a value per tile, and for each non-uniform tile a slot of
+// kSparseTileSize^2 samples (row-major, kSparseTileSize apart) in one pooled
+// buffer
+struct Heightfield::SparseTiles {
+    std::vector<float32> values;   // Per tile; what a uniform tile holds
+    std::vector<uint32> slots;     // Per tile; kUniformSlot if uniform
+    PooledBuffer<float32> samples;
+    uint32 slotCount = 0;          // Slots in use
+
+    float32* GetSlot(uint32 slot) const { return samples.data->data() + slot * kTileSlotSize; }
+
+    // Slot for one more tile. Growing moves the samples, so views of other
+    // tiles do not survive it.
+    uint32 AddSlot() {
+        uint64 capacity = samples.data ? samples.data->size() / kTileSlotSize : 0;
+        if (slotCount == capacity) {
+            uint64 grown = std::max<uint64>(capacity * 2, 4);
+            auto buffer = BufferPool<float32>::Get().Acquire(grown * kTileSlotSize, BufferInit::Uninitialized);
+            if (slotCount > 0) {
+                std::copy(GetSlot(0), GetSlot(slotCount), buffer.data->begin());
+            }
+            samples = std::move(buffer);
+        }
+        return slotCount++;
+    }
+};
+
+SampleRemap SampleRemap::Then(const SampleRemap& next) const {
+    if (IsIdentity()) {
+        return next;
+    }
+    if (next.IsIdentity()) {
+        return *this;
+    }
+
+    // Both as v * k + b, composed in double
+    float64 k1 = static_cast<float64>(scale) / range;
+    float64 b1 = offset - origin * k1;
+    float64 k2 = static_cast<float64>(next.scale) / next.range;
+    float64 b2 = next.offset - next.origin * k2;
+
+    SampleRemap composed;
+    composed.scale = static_cast<float32>(k1 * k2);
+    composed.offset = static_cast<float32>(b1 * k2 + b2);
+    return composed;
+}
+
+Heightfield::Heightfield(uint32 width, uint32 height, BufferInit init)
     : m_Width(width), m_Height(height) {
-    m_Data.resize(width * height, 0.0f);
+    SetHeapBuffer(BufferPool<float32>::Get().Acquire(static_cast<size_t>(width) * height, init));
+}
+
+Heightfield::Heightfield(uint32 width, uint32 height, Shared<MappedFile> mapping)
+    : m_Width(width), m_Height(height), m_Mapping(std::move(mapping)) {
+    m_Samples = static_cast<float32*>(m_Mapping->GetData());
+}
+
+Heightfield::Heightfield(uint32 width, uint32 height, Shared<SparseTiles> tiles)
+    : m_Width(width), m_Height(height), m_Sparse(std::move(tiles)) {
 }
 
 Heightfield::~Heightfield() {
 }
 
+Unique<Heightfield> Heightfield::CreateUniform(uint32 width, uint32 height, float32 value) {
+    auto tiles = MakeShared<SparseTiles>();
+    Unique<Heightfield> heightfield(new Heightfield(width, height, tiles));
+    tiles->values.assign(heightfield->GetTileCount(), value);
+    tiles->slots.assign(heightfield->GetTileCount(), kUniformSlot);
+
+    if (heightfield->GetPixelCount() > 0) {
+        heightfield->m_Stats = { value, value, value };
+        heightfield->m_StatsVersion = heightfield->m_Version;
+    }
+    return heightfield;
+}
+
+Unique<Heightfield> Heightfield::CreateMapped(const String& path, uint32 width, uint32 height, const MapOptions& options) {
+    uint64 bytes = static_cast<uint64>(width) * height * sizeof(float32);
+    auto mapping = MappedFile::Create(path, bytes, options);
+    if (!mapping) {
+        return nullptr;
+    }
+    return Unique<Heightfield>(new Heightfield(width, height, std::move(mapping)));
+}
+
+Unique<Heightfield> Heightfield::OpenMapped(const String& path, uint32 width, uint32 height, const MapOptions& options) {
+    auto mapping = MappedFile::Open(path, MapMode::Private, options);
+    if (!mapping) {
+        return nullptr;
+    }
+
+    uint64 bytes = static_cast<uint64>(width) * height * sizeof(float32);
+    if (mapping->GetSize() != bytes) {
+        LOG_ERROR("%s holds %llu bytes, expected %llu for %ux%u samples", path.c_str(),
+                  static_cast<unsigned long long>(mapping->GetSize()),
+                  static_cast<unsigned long long>(bytes), width, height);
+        return nullptr;
+    }
+    return Unique<Heightfield>(new Heightfield(width, height, std::move(mapping)));
+}
+
+HeightfieldStats Heightfield::GetStats() const {
+    if (m_StatsVersion != m_Version) {
+        m_Stats = ComputeStats(nullptr);
+        m_StatsVersion = m_Version;
+    }
+    if (m_Remap.IsIdentity()) {
+        return m_Stats;
+    }
+
+    // The remap is monotonic, so it takes the extremes to the extremes of
+    // the remapped samples (swapped if it mirrors them)
+    float32 a = m_Remap.Apply(m_Stats.min);
+    float32 b = m_Remap.Apply(m_Stats.max);
+    return { std::min(a, b), std::max(a, b), m_Remap.Apply(m_Stats.mean) };
+}
+
+void Heightfield::Transform(const std::function<void(float32*, uint64, uint64)>& transform) {
+    Resolve();
+    Detach();
+    m_Version++;
+    m_Stats = ComputeStats(transform);
+    m_StatsVersion = m_Version;
+}
+
+void Heightfield::Remap(const SampleRemap& remap) {
+    // The stored samples and their statistics are unchanged
+    bool statsValid = m_StatsVersion == m_Version;
+    m_Remap = m_Remap.Then(remap);
+    m_Version++;
+    if (statsValid) {
+        m_StatsVersion = m_Version;
+    }
+}
+
+SampleRemap Heightfield::TakeRemap() {
+    SampleRemap remap = m_Remap;
+    if (!remap.IsIdentity()) {
+        bool statsValid = m_StatsVersion == m_Version;
+        m_Remap = SampleRemap();
+        m_Version++;
+        if (statsValid) {
+            m_StatsVersion = m_Version;
+        }
+    }
+    return remap;
+}
+
+void Heightfield::Resolve() {
+    Unpack();
+    if (IsSparse()) {
+        // Expanding writes every sample anyway, so apply the remap on the way
+        SampleRemap remap = m_Remap;
+        m_Remap = SampleRemap();
+        ExpandRemapped(remap);
+        return;
+    }
+    if (m_Remap.IsIdentity()) {
+        return;
+    }
+
+    SampleRemap remap = m_Remap;
+    m_Remap = SampleRemap();
+
+    // Shared samples stay alive with their other owners, so the remapped
+    // copy can be written straight from them
+    const float32* source = m_Samples;
+    if (IsShared()) {
+        SetHeapBuffer(BufferPool<float32>::Get().Acquire(GetPixelCount(), BufferInit::Uninitialized));
+    }
+
+    // Same values as before, so the version stays; the statistics of the new
+    // stored samples are gathered in the same pass
+    m_Stats = ComputeStats([&](float32* data, uint64 begin, uint64 end) {
+        for (uint64 i = begin; i < end; i++) {
+            data[i] = remap.Apply(source[i]);
+        }
+    });
+    m_StatsVersion = m_Version;
+}
+
+HeightfieldStats Heightfield::ComputeStats(const std::function<void(float32*, uint64, uint64)>& transform) const {
+    uint64 count = GetPixelCount();
+    if (count == 0) {
+        return HeightfieldStats();
+    }
+    if (IsSparse()) {
+        return ComputeSparseStats();
+    }
+
+    uint32 chunkCount = static_cast<uint32>((count + kStatsChunkSize - 1) / kStatsChunkSize);
+    std::vector<BlockStats> chunks(chunkCount);
+
+    ParallelFor(0, chunkCount, 1, [&](uint32 chunkBegin, uint32 chunkEnd) {
+        std::vector<float32> decoded;
+        for (uint32 chunk = chunkBegin; chunk < chunkEnd; chunk++) {
+            uint64 begin = static_cast<uint64>(chunk) * kStatsChunkSize;
+            uint64 size = std::min(kStatsChunkSize, count - begin);
+
+            const float32* samples = m_Samples + begin;
+            if (IsPacked()) {
+                decoded.resize(size);
+                DecodeRange(begin, size, decoded.data());
+                samples = decoded.data();
+            } else if (transform) {
+                // Reduce the chunk right after writing it, while it is in cache
+                transform(m_Samples, begin, begin + size);
+            }
+            chunks[chunk] = ReduceBlock(samples, size);
+        }
+    });
+
+    return CombineBlocks(chunks, count);
+}
+
+HeightfieldStats Heightfield::ComputeSparseStats() const {
+    // One block per tile: a uniform tile costs nothing to reduce
+    uint32 tileCount = GetTileCount();
+    std::vector<BlockStats> tiles(tileCount);
+
+    ParallelFor(0, tileCount, 0, [&](uint32 tileBegin, uint32 tileEnd) {
+        for (uint32 index = tileBegin; index < tileEnd; index++) {
+            if (IsUniformTile(index)) {
+                float32 value = m_Sparse->values[index];
+                uint64 size = static_cast<uint64>(GetTileWidth(index)) * GetTileHeight(index);
+                tiles[index] = { value, value, static_cast<float64>(value) * static_cast<float64>(size) };
+                continue;
+            }
+
+            HeightfieldView<const float32> view = GetTileView(index);
+            tiles[index] = ReduceBlock(view.Row(0).data(), view.width);
+            for (uint32 y = 1; y < view.height; y++) {
+                MergeBlock(tiles[index], ReduceBlock(view.Row(y).data(), view.width));
+            }
+        }
+    });
+
+    return CombineBlocks(tiles, GetPixelCount());
+}
+
+bool Heightfield::IsShared() const {
+    if (IsPacked()) {
+        return m_Packed.GetOwnerCount() > 1;
+    }
+    if (IsSparse()) {
+        return m_Sparse.use_count() > 1;
+    }
+    return m_Mapping ? m_Mapping.use_count() > 1 : m_Data.GetOwnerCount() > 1;
+}
+
+std::span<float32> Heightfield::GetDataMutable() {
+    Resolve();
+    Detach();
+    m_Version++;
+    return { m_Samples, static_cast<size_t>(GetPixelCount()) };
+}
+
+HeightfieldView<float32> Heightfield::GetViewMutable() {
+    std::span<float32> samples = GetDataMutable();
+    return { samples.data(), m_Width, m_Height, m_Width };
+}
+
+Heightfield Heightfield::GetResolved() const {
+    Heightfield resolved(*this);
+    resolved.Resolve();
+    return resolved;
+}
+
+Unique<Heightfield> Heightfield::Crop(uint32 x, uint32 y, uint32 width, uint32 height) const {
+    if (x + width > m_Width || y + height > m_Height) {
+        LOG_ERROR("Cannot crop %ux%u at (%u, %u) from a %ux%u heightfield", width, height, x, y, m_Width, m_Height);
+        return nullptr;
+    }
+
+    Heightfield resolved = GetResolved();
+    HeightfieldView<const float32> source = resolved.GetView().SubView(x, y, width, height);
+    auto cropped = MakeUnique<Heightfield>(width, height, BufferInit::Uninitialized);
+    HeightfieldView<float32> dest = cropped->GetViewMutable();
+    ParallelForRows(height, [&](uint32 rowBegin, uint32 rowEnd) {
+        for (uint32 row = rowBegin; row < rowEnd; row++) {
+            std::span<const float32> samples = source.Row(row);
+            std::copy(samples.begin(), samples.end(), dest.Row(row).begin());
+        }
+    });
+    return cropped;
+}
+
+void Heightfield::Detach() {
+    if (IsPacked()) {
+        Unpack();
+    } else if (IsSparse()) {
+        Expand();
+    } else if (IsShared()) {
+        auto copy = BufferPool<float32>::Get().Acquire(GetPixelCount(), BufferInit::Uninitialized);
+        std::copy(m_Samples, m_Samples + GetPixelCount(), copy.data->begin());
+        SetHeapBuffer(std::move(copy));
+    }
+}
+
+void Heightfield::SetHeapBuffer(PooledBuffer<float32> buffer) {
+    m_Data = std::move(buffer);
+    m_Mapping.reset();
+    m_Samples = m_Data.data->data();
+    m_Sparse.reset();
+
+    m_Precision = SamplePrecision::Float32;
+    m_Packed = PooledBuffer<uint16>();
+    m_PackingError = 0.0f;
+}
+
+void Heightfield::SetSparse(Shared<SparseTiles> tiles) {
+    m_Data = PooledBuffer<float32>();
+    m_Mapping.reset();
+    m_Samples = nullptr;
+    m_Sparse = std::move(tiles);
+
+    m_Precision = SamplePrecision::Float32;
+    m_Packed = PooledBuffer<uint16>();
+    m_PackingError = 0.0f;
+}
+
+Heightfield::SparseTiles& Heightfield::GetSparseMutable() {
+    if (m_Sparse.use_count() > 1) {
+        auto copy = MakeShared<SparseTiles>();
+        copy->values = m_Sparse->values;
+        copy->slots = m_Sparse->slots;
+        copy->slotCount = m_Sparse->slotCount;
+        if (m_Sparse->slotCount > 0) {
+            copy->samples = BufferPool<float32>::Get().Acquire(m_Sparse->slotCount * kTileSlotSize, BufferInit::Uninitialized);
+            std::copy(m_Sparse->GetSlot(0), m_Sparse->GetSlot(m_Sparse->slotCount), copy->samples.data->begin());
+        }
+        m_Sparse = std::move(copy);
+    }
+    return *m_Sparse;
+}
+
+uint32 Heightfield::GetTileWidth(uint32 index) const {
+    uint32 x = (index % GetTilesX()) * kSparseTileSize;
+    return std::min(kSparseTileSize, m_Width - x);
+}
+
+uint32 Heightfield::GetTileHeight(uint32 index) const {
+    uint32 y = (index / GetTilesX()) * kSparseTileSize;
+    return std::min(kSparseTileSize, m_Height - y);
+}
+
+bool Heightfield::Compact(float32 minUniformFraction) {
+    if (IsSparse()) {
+        return true;
+    }
+    if (IsPacked() || IsMapped() || GetPixelCount() == 0) {
+        return false;
+    }
+
+    // Non-uniform tiles usually give themselves away within a few samples,
+    // so finding out costs far less than a pass over the samples
+    uint32 tileCount = GetTileCount();
+    std::vector<uint8> uniform(tileCount);
+    ParallelFor(0, tileCount, 0, [&](uint32 tileBegin, uint32 tileEnd) {
+        for (uint32 index = tileBegin; index < tileEnd; index++) {
+            uniform[index] = IsUniformRegion(GetTileView(index));
+        }
+    });
+
+    uint32 uniformCount = static_cast<uint32>(std::count(uniform.begin(), uniform.end(), uint8(1)));
+    if (uniformCount == 0 || uniformCount < minUniformFraction * static_cast<float32>(tileCount)) {
+        return false;
+    }
+
+    auto tiles = MakeShared<SparseTiles>();
+    tiles->values.resize(tileCount);
+    tiles->slots.resize(tileCount);
+    for (uint32 index = 0; index < tileCount; index++) {
+        tiles->slots[index] = uniform[index] ? kUniformSlot : tiles->slotCount++;
+    }
+    if (tiles->slotCount > 0) {
+        tiles->samples = BufferPool<float32>::Get().Acquire(tiles->slotCount * kTileSlotSize, BufferInit::Uninitialized);
+    }
+
+    ParallelFor(0, tileCount, 0, [&](uint32 tileBegin, uint32 tileEnd) {
+        for (uint32 index = tileBegin; index < tileEnd; index++) {
+            HeightfieldView<const float32> source = GetTileView(index);
+            tiles->values[index] = source(0, 0);
+            if (uniform[index]) {
+                continue;
+            }
+            float32* dest = tiles->GetSlot(tiles->slots[index]);
+            for (uint32 y = 0; y < source.height; y++) {
+                std::span<const float32> row = source.Row(y);
+                std::copy(row.begin(), row.end(), dest + y * kSparseTileSize);
+            }
+        }
+    });
+
+    // Same values, so the version and cached statistics stay valid
+    SetSparse(std::move(tiles));
+    return true;
+}
+
+void Heightfield::Expand() {
+    ExpandRemapped(SampleRemap());
+}
+
+void Heightfield::ExpandRemapped(const SampleRemap& remap) {
+    if (!IsSparse()) {
+        return;
+    }
+
+    auto samples = BufferPool<float32>::Get().Acquire(GetPixelCount(), BufferInit::Uninitialized);
+    HeightfieldView<float32> dest(samples.data->data(), m_Width, m_Height, m_Width);
+    bool identity = remap.IsIdentity();
+
+    ParallelFor(0, GetTileCount(), 0, [&](uint32 tileBegin, uint32 tileEnd) {
+        for (uint32 index = tileBegin; index < tileEnd; index++) {
+            uint32 x = (index % GetTilesX()) * kSparseTileSize;
+            uint32 y = (index / GetTilesX()) * kSparseTileSize;
+            HeightfieldView<float32> tile = dest.SubView(x, y, GetTileWidth(index), GetTileHeight(index));
+
+            if (IsUniformTile(index)) {
+                float32 value = identity ? m_Sparse->values[index] : remap.Apply(m_Sparse->values[index]);
+                for (uint32 row = 0; row < tile.height; row++) {
+                    std::span<float32> out = tile.Row(row);
+                    std::fill(out.begin(), out.end(), value);
+                }
+                continue;
+            }
+
+            HeightfieldView<const float32> source = GetTileView(index);
+            for (uint32 row = 0; row < tile.height; row++) {
+                std::span<const float32> in = source.Row(row);
+                std::span<float32> out = tile.Row(row);
+                if (identity) {
+                    std::copy(in.begin(), in.end(), out.begin());
+                } else {
+                    for (uint32 i = 0; i < tile.width; i++) {
+                        out[i] = remap.Apply(in[i]);
+                    }
+                }
+            }
+        }
+    });
+
+    // Same values: the version stays, and so do the statistics unless the
+    // stored samples were remapped
+    SetHeapBuffer(std::move(samples));
+    if (!identity) {
+        m_StatsVersion = ~0ull;
+    }
+}
+
+uint32 Heightfield::GetUniformTileCount() const {
+    if (!IsSparse()) {
+        return 0;
+    }
+    return static_cast<uint32>(std::count(m_Sparse->slots.begin(), m_Sparse->slots.end(), kUniformSlot));
+}
+
+bool Heightfield::IsUniformTile(uint32 index) const {
+    return IsSparse() && m_Sparse->slots[index] == kUniformSlot;
+}
+
+float32 Heightfield::GetTileValue(uint32 index) const {
+    assert(IsUniformTile(index));
+    return m_Sparse->values[index];
+}
+
+HeightfieldView<const float32> Heightfield::GetTileView(uint32 index) const {
+    uint32 width = GetTileWidth(index);
+    uint32 height = GetTileHeight(index);
+    if (IsSparse()) {
+        assert(!IsUniformTile(index));
+        return { m_Sparse->GetSlot(m_Sparse->slots[index]), width, height, kSparseTileSize };
+    }
+
+    // Dense samples: the tile's window onto them
+    uint32 x = (index % GetTilesX()) * kSparseTileSize;
+    uint32 y = (index / GetTilesX()) * kSparseTileSize;
+    return GetView().SubView(x, y, width, height);
+}
+
+void Heightfield::ExpandTile(uint32 index) {
+    if (!IsUniformTile(index)) {
+        return;
+    }
+
+    SparseTiles& tiles = GetSparseMutable();
+    uint32 slot = tiles.AddSlot();
+    float32* samples = tiles.GetSlot(slot);
+    std::fill(samples, samples + kTileSlotSize, tiles.values[index]);
+    tiles.slots[index] = slot;
+}
+
+void Heightfield::TransformTiles(const std::function<float32(uint32, float32)>& uniform,
+                                 const std::function<void(uint32, HeightfieldView<float32>)>& dense) {
+    assert(IsSparse());
+    SampleRemap remap = m_Remap;
+    m_Remap = SampleRemap();
+    bool identity = remap.IsIdentity();
+
+    SparseTiles& tiles = GetSparseMutable();
+    m_Version++;
+
+    ParallelFor(0, GetTileCount(), 0, [&](uint32 tileBegin, uint32 tileEnd) {
+        for (uint32 index = tileBegin; index < tileEnd; index++) {
+            if (tiles.slots[index] == kUniformSlot) {
+                float32 value = tiles.values[index];
+                tiles.values[index] = uniform(index, identity ? value : remap.Apply(value));
+                continue;
+            }
+
+            HeightfieldView<float32> view(tiles.GetSlot(tiles.slots[index]), GetTileWidth(index),
+                                          GetTileHeight(index), kSparseTileSize);
+            if (!identity) {
+                for (uint32 y = 0; y < view.height; y++) {
+                    for (float32& sample : view.Row(y)) {
+                        sample = remap.Apply(sample);
+                    }
+                }
+            }
+            dense(index, view);
+        }
+    });
+
+    m_Stats = ComputeSparseStats();
+    m_StatsVersion = m_Version;
+}
+
+bool Heightfield::Pack(SamplePrecision precision, float32 maxError) {
+    if (precision == m_Precision) {
+        return true;
+    }
+    Resolve();
+    if (precision == SamplePrecision::Float32 || GetPixelCount() == 0) {
+        return precision == SamplePrecision::Float32;
+    }
+
+    float32 minVal = GetStats().min;
+    float32 maxVal = GetStats().max;
+    float32 error = GetPrecisionErrorBound(precision, minVal, maxVal);
+    if (!std::isfinite(error) || !(error <= maxError)) {
+        return false;
+    }
+
+    uint64 count = GetPixelCount();
+    auto packed = BufferPool<uint16>::Get().Acquire(count, BufferInit::Uninitialized);
+    const float32* source = m_Samples;
+    uint16* dest = packed.data->data();
+
+    if (precision == SamplePrecision::Float16) {
+        ParallelForSamples(count, [&](uint64 begin, uint64 end) {
+            EncodeHalf(source + begin, dest + begin, end - begin);
+        });
+    } else {
+        m_PackedOffset = minVal;
+        m_PackedScale = (maxVal - minVal) / 65535.0f;
+        float32 invScale = m_PackedScale > 0.0f ? 1.0f / m_PackedScale : 0.0f;
+        ParallelForSamples(count, [&](uint64 begin, uint64 end) {
+            EncodeUNorm16(source + begin, dest + begin, end - begin, m_PackedOffset, invScale);
+        });
+    }
+
+    m_Data = PooledBuffer<float32>();
+    m_Mapping.reset();
+    m_Samples = nullptr;
+    m_Packed = std::move(packed);
+    m_Precision = precision;
+    m_PackingError = error;
+
+    // Rounding changed the samples
+    m_Version++;
+    return true;
+}
+
+void Heightfield::Unpack() {
+    if (!IsPacked()) {
+        return;
+    }
+
+    uint64 count = GetPixelCount();
+    auto samples = BufferPool<float32>::Get().Acquire(count, BufferInit::Uninitialized);
+    float32* dest = samples.data->data();
+    ParallelForSamples(count, [&](uint64 begin, uint64 end) {
+        DecodeRange(begin, end - begin, dest + begin);
+    });
+
+    // Same values, so the version and cached statistics stay valid
+    SetHeapBuffer(std::move(samples));
+}
+
+void Heightfield::DecodeRange(uint64 begin, uint64 count, float32* dest) const {
+    const uint16* source = m_Packed.data->data() + begin;
+    if (m_Precision == SamplePrecision::Float16) {
+        DecodeHalf(source, dest, count);
+    } else {
+        DecodeUNorm16(source, dest, count, m_PackedOffset, m_PackedScale);
+    }
+}
+
+uint64 Heightfield::GetByteSize() const {
+    if (IsSparse()) {
+        return m_Sparse->values.size() * (sizeof(float32) + sizeof(uint32)) +
+               m_Sparse->slotCount * kTileSlotSize * sizeof(float32);
+    }
+    return GetPixelCount() * (IsPacked() ? sizeof(uint16) : sizeof(float32));
+}
+
+float32 Heightfield::DecodeSample(uint16 code) const {
+    if (m_Precision == SamplePrecision::Float16) {
+        return HalfToFloat(code);
+    }
+    return UNorm16ToFloat(code, m_PackedOffset, m_PackedScale);
+}
+
+bool Heightfield::Sync() const {
+    return m_Mapping ? m_Mapping->Sync() : true;
+}
+
+void Heightfield::AdviseAccess(MapAccess access) {
+    if (m_Mapping) {
+        m_Mapping->Advise(access);
+    }
+}
+
 float32 Heightfield::GetHeight(uint32 x, uint32 y) const {
     if (x >= m_Width || y >= m_Height) return 0.0f;
-    return m_Data[y * m_Width + x];
+    size_t index = static_cast<size_t>(y) * m_Width + x;
+    float32 value;
+    if (IsSparse()) {
+        uint32 tile = (y / kSparseTileSize) * GetTilesX() + x / kSparseTileSize;
+        value = IsUniformTile(tile) ? m_Sparse->values[tile]
+                                    : GetTileView(tile)(x % kSparseTileSize, y % kSparseTileSize);
+    } else {
+        value = IsPacked() ? DecodeSample((*m_Packed.data)[index]) : m_Samples[index];
+    }
+    return m_Remap.IsIdentity() ? value : m_Remap.Apply(value);
 }
 
 void Heightfield::SetHeight(uint32 x, uint32 y, float32 height) {
     if (x >= m_Width || y >= m_Height) return;
-    m_Data[y * m_Width + x] = height;
+    if (IsSparse()) {
+        // Only the written tile gets samples of its own
+        if (!m_Remap.IsIdentity()) {
+            TransformTiles([](uint32, float32 value) { return value; }, [](uint32, HeightfieldView<float32>) {});
+        }
+        uint32 tile = (y / kSparseTileSize) * GetTilesX() + x / kSparseTileSize;
+        ExpandTile(tile);
+        SparseTiles& tiles = GetSparseMutable();
+        m_Version++;
+        tiles.GetSlot(tiles.slots[tile])[(y % kSparseTileSize) * kSparseTileSize + x % kSparseTileSize] = height;
+        return;
+    }
+    Resolve();
+    Detach();
+    m_Version++;
+    m_Samples[static_cast<size_t>(y) * m_Width + x] = height;
 }
 
 void Heightfield::AllocateGPUBuffer(BufferManager* bufferMgr) {
-    VkDeviceSize bufferSize = m_Width * m_Height * sizeof(float32);
+    VkDeviceSize bufferSize = GetPixelCount() * sizeof(float32);
     m_GPUBuffer = bufferMgr->CreateStorageBuffer(bufferSize);
     LOG_INFO("Allocated GPU buffer for %dx%d heightfield (%zu MB)",
              m_Width, m_Height, bufferSize / (1024 * 1024));
@@ -36,13 +953,15 @@ void Heightfield::UploadToGPU(BufferManager* bufferMgr) {
         return;
     }
 
+    Resolve();
+
     // Create staging buffer
-    VkDeviceSize bufferSize = m_Width * m_Height * sizeof(float32);
+    VkDeviceSize bufferSize = GetPixelCount() * sizeof(float32);
     BufferAllocation staging = bufferMgr->CreateStagingBuffer(bufferSize);
 
     // Copy data to staging
     void* data = bufferMgr->MapBuffer(staging);
-    std::memcpy(data, m_Data.data(), bufferSize);
+    std::memcpy(data, m_Samples, bufferSize);
     bufferMgr->UnmapBuffer(staging);
 
     // TODO: Copy staging to device buffer (needs command buffer)
@@ -58,14 +977,14 @@ void Heightfield::DownloadFromGPU(BufferManager* bufferMgr) {
     }
 
     // Create staging buffer
-    VkDeviceSize bufferSize = m_Width * m_Height * sizeof(float32);
+    VkDeviceSize bufferSize = GetPixelCount() * sizeof(float32);
     BufferAllocation staging = bufferMgr->CreateStagingBuffer(bufferSize);
 
     // TODO: Copy device buffer to staging (needs command buffer)
 
     // Copy from staging to CPU
     void* data = bufferMgr->MapBuffer(staging);
-    std::memcpy(m_Data.data(), data, bufferSize);
+    std::memcpy(GetDataMutable().data(), data, bufferSize);
     bufferMgr->UnmapBuffer(staging);
 
     bufferMgr->DestroyBuffer(staging);
@@ -74,29 +993,49 @@ void Heightfield::DownloadFromGPU(BufferManager* bufferMgr) {
 }
 
 void Heightfield::Clear(float32 value) {
-    std::fill(m_Data.begin(), m_Data.end(), value);
+    if (IsMapped() && !IsShared()) {
+        // Writes go to the file
+        std::fill(m_Samples, m_Samples + GetPixelCount(), value);
+    } else {
+        // Every tile uniform: no samples to write at all
+        auto tiles = MakeShared<SparseTiles>();
+        tiles->values.assign(GetTileCount(), value);
+        tiles->slots.assign(GetTileCount(), kUniformSlot);
+        SetSparse(std::move(tiles));
+    }
+
+    m_Remap = SampleRemap();
+    m_Version++;
+    if (GetPixelCount() > 0) {
+        m_Stats = { value, value, value };
+        m_StatsVersion = m_Version;
+    }
 }
 
 void Heightfield::Normalize(float32 minVal, float32 maxVal) {
-    float32 currentMin = GetMin();
-    float32 currentMax = GetMax();
+    HeightfieldStats current = GetStats();
+    float32 currentMin = current.min;
+    float32 currentMax = current.max;
 
     if (currentMax - currentMin < 0.0001f) {
         Clear((minVal + maxVal) * 0.5f);
         return;
     }
 
-    for (auto& height : m_Data) {
-        height = minVal + (height - currentMin) / (currentMax - currentMin) * (maxVal - minVal);
-    }
+    SampleRemap remap;
+    remap.origin = currentMin;
+    remap.range = currentMax - currentMin;
+    remap.scale = maxVal - minVal;
+    remap.offset = minVal;
+    Remap(remap);
 }
 
 float32 Heightfield::GetMin() const {
-    return *std::min_element(m_Data.begin(), m_Data.end());
+    return GetStats().min;
 }
 
 float32 Heightfield::GetMax() const {
-    return *std::max_element(m_Data.begin(), m_Data.end());
+    return GetStats().max;
 }
 
 } // namespace Terrain
@@ -1,27 +1,196 @@
 #pragma once
 
 #include "Core/Types.h"
+#include "Core/BufferPool.h"
+#include "Core/MappedFile.h"
 #include "GPU/BufferManager.h"
-#include <vector>
+#include "HeightfieldView.h"
+#include <functional>
+#include <limits>
+#include <span>
 
 namespace Terrain {
 
+// Precision heightfield samples are stored at. Kernels always compute in
+// float32; the 16-bit formats are for samples at rest (cached node outputs)
+// and halve their footprint and the bandwidth of reading them back.
+enum class SamplePrecision {
+    Float32,
+    Float16,  // IEEE half: 11 significant bits, range +-65504
+    UNorm16   // 65536 evenly spaced levels between the samples' min and max
+};
+
+// Largest absolute error from storing samples in [minVal, maxVal] at the
+// given precision; infinity if they cannot be represented
+float32 GetPrecisionErrorBound(SamplePrecision precision, float32 minVal, float32 maxVal);
+
+// Sparse storage tiles are kSparseTileSize samples square, partial at the
+// right and bottom edges
+constexpr uint32 kSparseTileSize = 64;
+
+// Node outputs switch to sparse storage once this share of tiles is uniform
+constexpr float32 kMinUniformTileFraction = 0.5f;
+
+// Summary statistics of a heightfield's samples
+struct HeightfieldStats {
+    float32 min = 0.0f;
+    float32 max = 0.0f;
+    float32 mean = 0.0f;
+};
+
+// Affine remap of sample values, (v - origin) / range * scale + offset. The
+// origin/range form evaluates a single Normalize exactly like the eager loop
+// did; composed remaps collapse to v * scale + offset.
+struct SampleRemap {
+    float32 origin = 0.0f;
+    float32 range = 1.0f;
+    float32 scale = 1.0f;
+    float32 offset = 0.0f;
+
+    bool IsIdentity() const { return origin == 0.0f && range == 1.0f && scale == 1.0f && offset == 0.0f; }
+    float32 Apply(float32 value) const { return (value - origin) / range * scale + offset; }
+
+    // This remap followed by next
+    SampleRemap Then(const SampleRemap& next) const;
+};
+
+// Heightfield samples are reference-counted and copy-on-write: copying a
+// Heightfield shares the underlying buffer, and the first mutable access on a
+// shared buffer detaches it with a private copy. Buffers come from the float
+// BufferPool, so re-executing a graph at the same resolution reuses them.
+//
+// Large maps can instead live in a memory-mapped raw float32 file (the
+// ExportRAW layout): samples are paged in on first touch and never copied
+// through the heap.
+//
+// Affine operations (Normalize, scaling, inversion) are not applied to the
+// samples: they update a pending remap in O(1), which the next consumer folds
+// into its own pass or Resolve() applies. GetHeight and GetStats report the
+// remapped values.
+//
+// Mostly flat samples (constants, masks, clamped lowlands) can be stored
+// sparse: tile by tile, with every tile whose samples are all equal held as
+// that single value.
 class Heightfield {
 public:
-    Heightfield(uint32 width, uint32 height);
+    Heightfield(uint32 width, uint32 height, BufferInit init = BufferInit::Zero);
+
+    // Create (or overwrite) a zero-filled file holding the samples. Writes
+    // go to the file; Sync() makes them durable.
+    static Unique<Heightfield> CreateMapped(const String& path, uint32 width, uint32 height,
+                                            const MapOptions& options = MapOptions());
+
+    // Map an existing file without copying it. Writes stay in this process
+    // and never modify the file.
+    static Unique<Heightfield> OpenMapped(const String& path, uint32 width, uint32 height,
+                                          const MapOptions& options = MapOptions());
+
+    // Sparse heightfield whose tiles all hold value: O(tiles), not O(samples)
+    static Unique<Heightfield> CreateUniform(uint32 width, uint32 height, float32 value);
+
+    Heightfield(const Heightfield& other) = default;
+    Heightfield(Heightfield&& other) noexcept = default;
+    Heightfield& operator=(const Heightfield& other) = default;
+    Heightfield& operator=(Heightfield&& other) noexcept = default;
     ~Heightfield();
 
     // Dimensions
     uint32 GetWidth() const { return m_Width; }
     uint32 GetHeight() const { return m_Height; }
-    uint32 GetPixelCount() const { return m_Width * m_Height; }
+    uint64 GetPixelCount() const { return static_cast<uint64>(m_Width) * m_Height; }
 
     // CPU data
-    const std::vector<float32>& GetData() const { return m_Data; }
-    std::vector<float32>& GetDataMutable() { return m_Data; }
+    // GetData returns the stored samples: call Resolve() first, or apply
+    // GetRemap() to each sample of a dense heightfield. GetDataMutable
+    // resolves implicitly.
+    std::span<const float32> GetData() const { return { m_Samples, static_cast<size_t>(GetPixelCount()) }; }
+    std::span<float32> GetDataMutable(); // Counts as a modification (see GetVersion)
+    bool IsShared() const;
+
+    // The same samples as a 2D view, for kernels that work row by row or
+    // on a sub-rectangle
+    HeightfieldView<const float32> GetView() const { return { m_Samples, m_Width, m_Height, m_Width }; }
+    HeightfieldView<float32> GetViewMutable();
+
+    // A copy whose stored samples are its values: shares the samples if
+    // there is nothing to resolve
+    Heightfield GetResolved() const;
+
+    // The resolved values of a sub-rectangle, as a heightfield of its own
+    Unique<Heightfield> Crop(uint32 x, uint32 y, uint32 width, uint32 height) const;
+
+    // Checked single-sample access, for tools and sparse lookups
     float32 GetHeight(uint32 x, uint32 y) const;
     void SetHeight(uint32 x, uint32 y, float32 height);
 
+    // Statistics are computed in one pass on first use and cached until the
+    // samples change. Every mutable access bumps the version, so samples
+    // written through a span must not be interleaved with statistics reads:
+    // fetch the span again after writing if GetStats() ran in between. A
+    // pending remap is applied to the cached statistics, not the samples.
+    HeightfieldStats GetStats() const;
+    uint64 GetVersion() const { return m_Version; }
+
+    // Rewrite the samples chunk by chunk, gathering the new statistics in the
+    // same pass. The transform gets the sample array and a [begin, end) range.
+    void Transform(const std::function<void(float32*, uint64, uint64)>& transform);
+
+    // Pending remap
+    // Remap composes with any remap already pending and touches no samples.
+    // TakeRemap hands the pending remap to a caller that applies it itself,
+    // leaving the stored samples as the heightfield's values.
+    void Remap(const SampleRemap& remap);
+    SampleRemap TakeRemap();
+    const SampleRemap& GetRemap() const { return m_Remap; }
+    bool IsResolved() const { return IsDense() && m_Remap.IsIdentity(); }
+    void Resolve(); // Unpack, expand and apply the pending remap to the samples
+
+    // Storage precision
+    // Pack resolves, then converts the samples to a 16-bit format if every
+    // sample stays within maxError of its current value, and otherwise leaves
+    // them float32 and returns false. Packed samples must be unpacked before
+    // GetData(); the mutating accessors unpack implicitly.
+    bool Pack(SamplePrecision precision, float32 maxError = std::numeric_limits<float32>::infinity());
+    void Unpack();
+    bool IsPacked() const { return m_Precision != SamplePrecision::Float32; }
+    SamplePrecision GetPrecision() const { return m_Precision; }
+    float32 GetPackingError() const { return m_PackingError; } // Bound while packed, else 0
+    uint64 GetByteSize() const;
+
+    // Sparse storage
+    // Compact switches to sparse storage if at least minUniformFraction of
+    // the tiles are uniform, and otherwise leaves the samples flat and
+    // returns false; Expand switches back. Like packed samples, sparse ones
+    // must be expanded before GetData(). The mutating accessors expand
+    // implicitly, except SetHeight, which only expands the tile it writes.
+    bool Compact(float32 minUniformFraction = kMinUniformTileFraction);
+    void Expand();
+    bool IsSparse() const { return m_Sparse != nullptr; }
+    bool IsDense() const { return !IsPacked() && !IsSparse(); } // GetData() holds the samples
+
+    // Tiles of sparse storage, in row-major order. Values are the stored
+    // samples, before any pending remap.
+    uint32 GetTilesX() const { return (m_Width + kSparseTileSize - 1) / kSparseTileSize; }
+    uint32 GetTilesY() const { return (m_Height + kSparseTileSize - 1) / kSparseTileSize; }
+    uint32 GetTileCount() const { return GetTilesX() * GetTilesY(); }
+    uint32 GetUniformTileCount() const;
+    bool IsUniformTile(uint32 index) const;
+    float32 GetTileValue(uint32 index) const;                       // Uniform tiles only
+    HeightfieldView<const float32> GetTileView(uint32 index) const; // Non-uniform tiles only
+    void ExpandTile(uint32 index);                                  // Store a uniform tile's samples
+
+    // Rewrite sparse samples tile by tile on the job system, then gather the
+    // new statistics. uniform(index, value) returns a uniform tile's new
+    // value; dense(index, samples) rewrites a non-uniform tile in place.
+    void TransformTiles(const std::function<float32(uint32, float32)>& uniform,
+                        const std::function<void(uint32, HeightfieldView<float32>)>& dense);
+
+    // File backing
+    bool IsMapped() const { return m_Mapping != nullptr; }
+    const MappedFile* GetMapping() const { return m_Mapping.get(); }
+    bool Sync() const;                   // Flush written samples to the file
+    void AdviseAccess(MapAccess access); // How the next consumer reads the samples
+
     // GPU buffer
     void AllocateGPUBuffer(BufferManager* bufferMgr);
     void UploadToGPU(BufferManager* bufferMgr);
@@ -33,11 +202,60 @@ public:
     void Normalize(float32 minVal = 0.0f, float32 maxVal = 1.0f);
     float32 GetMin() const;
     float32 GetMax() const;
+    float32 GetMean() const { return GetStats().mean; }
 
 private:
+    struct SparseTiles;
+
+    Heightfield(uint32 width, uint32 height, Shared<MappedFile> mapping);
+    Heightfield(uint32 width, uint32 height, Shared<SparseTiles> tiles);
+
+    // Give this heightfield a private copy of its samples if the buffer is shared
+    void Detach();
+
+    // Switch to a fresh heap buffer, dropping any mapping, packed or sparse
+    // samples
+    void SetHeapBuffer(PooledBuffer<float32> buffer);
+
+    // Switch to sparse tiles, dropping any other storage
+    void SetSparse(Shared<SparseTiles> tiles);
+
+    // Sparse tiles this heightfield may modify: a private copy if shared
+    SparseTiles& GetSparseMutable();
+
+    // Expand sparse tiles to flat samples, remapping them on the way
+    void ExpandRemapped(const SampleRemap& remap);
+
+    // Tile rectangle in samples
+    uint32 GetTileWidth(uint32 index) const;
+    uint32 GetTileHeight(uint32 index) const;
+
+    float32 DecodeSample(uint16 code) const;
+    void DecodeRange(uint64 begin, uint64 count, float32* dest) const;
+
+    // Fixed-chunk reduction over the samples. A transform, if given, first
+    // rewrites each chunk in place (for passes that produce new statistics).
+    HeightfieldStats ComputeStats(const std::function<void(float32*, uint64, uint64)>& transform) const;
+    HeightfieldStats ComputeSparseStats() const; // One block per tile
+
     uint32 m_Width;
     uint32 m_Height;
-    std::vector<float32> m_Data;
+    PooledBuffer<float32> m_Data;     // Heap samples
+    Shared<MappedFile> m_Mapping;     // File-backed samples, used instead of m_Data
+    float32* m_Samples = nullptr;     // Whichever of the two holds the samples (null while packed or sparse)
+    Shared<SparseTiles> m_Sparse;     // Tile-by-tile samples while sparse
+
+    SamplePrecision m_Precision = SamplePrecision::Float32;
+    PooledBuffer<uint16> m_Packed;    // 16-bit samples while packed
+    float32 m_PackedOffset = 0.0f;    // UNorm16: sample = offset + code * scale
+    float32 m_PackedScale = 0.0f;
+    float32 m_PackingError = 0.0f;
+
+    SampleRemap m_Remap;              // Pending remap of the stored samples
+
+    uint64 m_Version = 0;                      // Bumped on every modification
+    mutable uint64 m_StatsVersion = ~0ull;     // Version m_Stats was computed for
+    mutable HeightfieldStats m_Stats;          // Of the stored samples, before m_Remap
     BufferAllocation m_GPUBuffer;
 };
 
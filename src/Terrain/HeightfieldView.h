@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Core/Types.h"
+#include <cassert>
+#include <span>
+#include <type_traits>
+
+namespace Terrain {
+
+// What samples beyond the edge of a heightfield hold, for stencils and halos
+enum class BorderMode : uint8 {
+    Clamp,    // The nearest sample inside
+    Wrap,     // Samples from the opposite edge, so results tile seamlessly
+    Mirror,   // Reflected about the edge sample, which is not repeated
+    Constant  // A fixed value
+};
+
+// Coordinate in [0, size) that i reads under a border mode, or -1 if it
+// reads the constant
+inline int32 ResolveBorder(int32 i, int32 size, BorderMode mode) {
+    if (i >= 0 && i < size) {
+        return i;
+    }
+    switch (mode) {
+        case BorderMode::Clamp:
+            return i < 0 ? 0 : size - 1;
+        case BorderMode::Wrap:
+            i %= size;
+            return i < 0 ? i + size : i;
+        case BorderMode::Mirror: {
+            if (size == 1) {
+                return 0;
+            }
+            int32 period = 2 * size - 2;
+            i = (i < 0 ? -i : i) % period;
+            return i < size ? i : period - i;
+        }
+        default:
+            return -1;
+    }
+}
+
+// Non-owning 2D window onto row-major samples: width x height samples whose
+// rows start stride samples apart. A sub-rectangle is a view of the same
+// samples with the parent's stride, so kernels can work on a region without
+// copying it.
+//
+// Accessors are bounds-checked only in debug builds. Kernels should loop
+// over Row() spans: rows are contiguous, so inner loops index one pointer
+// and auto-vectorize.
+template<typename T>
+struct HeightfieldView {
+    T* data = nullptr;   // Sample (0, 0)
+    uint32 width = 0;
+    uint32 height = 0;
+    uint64 stride = 0;   // Samples from one row to the next
+
+    HeightfieldView() = default;
+    HeightfieldView(T* data, uint32 width, uint32 height, uint64 stride)
+        : data(data), width(width), height(height), stride(stride) {}
+
+    // Mutable views convert to read-only ones
+    template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    HeightfieldView(const HeightfieldView<U>& other)
+        : data(other.data), width(other.width), height(other.height), stride(other.stride) {}
+
+    uint64 GetPixelCount() const { return static_cast<uint64>(width) * height; }
+    bool IsContiguous() const { return stride == width || height <= 1; }
+
+    std::span<T> Row(uint32 y) const {
+        assert(y < height);
+        return { data + y * stride, width };
+    }
+
+    T& operator()(uint32 x, uint32 y) const {
+        assert(x < width && y < height);
+        return data[y * stride + x];
+    }
+
+    // Sample at any position, with the border mode deciding what lies
+    // beyond the view (slow path for sparse lookups; stencils over whole
+    // heightfields should use a TiledGrid halo)
+    std::remove_const_t<T> Sample(int32 x, int32 y, BorderMode border, std::remove_const_t<T> constant = {}) const {
+        int32 sx = ResolveBorder(x, static_cast<int32>(width), border);
+        int32 sy = ResolveBorder(y, static_cast<int32>(height), border);
+        return sx < 0 || sy < 0 ? constant : (*this)(static_cast<uint32>(sx), static_cast<uint32>(sy));
+    }
+
+    HeightfieldView SubView(uint32 x, uint32 y, uint32 subWidth, uint32 subHeight) const {
+        assert(x + subWidth <= width && y + subHeight <= height);
+        return { data + y * stride + x, subWidth, subHeight, stride };
+    }
+
+    // The whole view as one span; only valid for contiguous views
+    std::span<T> Samples() const {
+        assert(IsContiguous());
+        return { data, static_cast<size_t>(GetPixelCount()) };
+    }
+};
+
+} // namespace Terrain
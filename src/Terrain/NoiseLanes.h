@@ -0,0 +1,161 @@
+#pragma once
+
+#include "Core/Types.h"
+#include <bit>
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+namespace Terrain {
+
+// Lane types for the CPU noise kernels: SimdLanes holds as many floats as
+// the build's widest instruction set (AVX2: 8, SSE4.1: 4, otherwise 1) and
+// ScalarLanes one, for row tails. Kernels are templates over the lane type,
+// so every width runs the same float operations in the same order and
+// produces identical results.
+//
+// Masks are integer lanes of all ones or all zeros. Integer arithmetic
+// wraps like a shader's.
+struct ScalarLanes {
+    static constexpr uint32 kWidth = 1;
+    using Float = float32;
+    using Int = uint32;
+
+    static Float Set(float32 value) { return value; }
+    static Int SetInt(int32 value) { return static_cast<uint32>(value); }
+
+    static Float Add(Float a, Float b) { return a + b; }
+    static Float Sub(Float a, Float b) { return a - b; }
+    static Float Mul(Float a, Float b) { return a * b; }
+    static Float Div(Float a, Float b) { return a / b; }
+    static Float Min(Float a, Float b) { return b < a ? b : a; }
+    static Float Max(Float a, Float b) { return a < b ? b : a; }
+    static Float Sqrt(Float a) { return std::sqrt(a); }
+    static Float Abs(Float a) { return std::fabs(a); }
+    static Float Floor(Float a) { return std::floor(a); }
+    static Int ToInt(Float a) { return static_cast<uint32>(static_cast<int32>(a)); }
+    static Float ToFloat(Int a) { return static_cast<float32>(static_cast<int32>(a)); }
+    static Int LessThan(Float a, Float b) { return a < b ? ~0u : 0u; }
+
+    static Int AddInt(Int a, Int b) { return a + b; }
+    static Int MulInt(Int a, uint32 b) { return a * b; }
+    static Int And(Int a, uint32 bits) { return a & bits; }
+    static Int Or(Int a, Int b) { return a | b; }
+    static Int Xor(Int a, Int b) { return a ^ b; }
+    static Int ShiftRight(Int a, int32 bits) { return a >> bits; }
+    static Int Less(Int a, uint32 b) { return a < b ? ~0u : 0u; }
+    static Int Equal(Int a, uint32 b) { return a == b ? ~0u : 0u; }
+    static Int Lookup(const int32* table, Int index) { return static_cast<uint32>(table[index]); }
+
+    static Float Select(Int mask, Float a, Float b) { return mask ? a : b; }
+    static Int SelectInt(Int mask, Int a, Int b) { return mask ? a : b; }
+    static Float FlipSign(Float a, Int mask) {
+        return std::bit_cast<float32>(std::bit_cast<uint32>(a) ^ (mask & 0x80000000u));
+    }
+    static uint32 GetMaskBits(Int mask) { return mask & 1u; } // Bit i set if lane i is
+
+    static Float Load(const float32* source) { return *source; }
+    static Int LoadInt(const int32* source) { return static_cast<uint32>(*source); }
+    static void Store(float32* dest, Float value) { *dest = value; }
+};
+
+#if defined(__AVX2__)
+struct SimdLanes {
+    static constexpr uint32 kWidth = 8;
+    using Float = __m256;
+    using Int = __m256i;
+
+    static Float Set(float32 value) { return _mm256_set1_ps(value); }
+    static Int SetInt(int32 value) { return _mm256_set1_epi32(value); }
+
+    static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+    static Float Min(Float a, Float b) { return _mm256_min_ps(b, a); }
+    static Float Max(Float a, Float b) { return _mm256_max_ps(b, a); }
+    static Float Sqrt(Float a) { return _mm256_sqrt_ps(a); }
+    static Float Abs(Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static Float Floor(Float a) { return _mm256_floor_ps(a); }
+    static Int ToInt(Float a) { return _mm256_cvttps_epi32(a); }
+    static Float ToFloat(Int a) { return _mm256_cvtepi32_ps(a); }
+    static Int LessThan(Float a, Float b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+
+    static Int AddInt(Int a, Int b) { return _mm256_add_epi32(a, b); }
+    static Int MulInt(Int a, uint32 b) { return _mm256_mullo_epi32(a, _mm256_set1_epi32(static_cast<int32>(b))); }
+    static Int And(Int a, uint32 bits) { return _mm256_and_si256(a, _mm256_set1_epi32(static_cast<int32>(bits))); }
+    static Int Or(Int a, Int b) { return _mm256_or_si256(a, b); }
+    static Int Xor(Int a, Int b) { return _mm256_xor_si256(a, b); }
+    static Int ShiftRight(Int a, int32 bits) { return _mm256_srli_epi32(a, bits); }
+    static Int Less(Int a, uint32 b) { return _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int32>(b)), a); }
+    static Int Equal(Int a, uint32 b) { return _mm256_cmpeq_epi32(a, _mm256_set1_epi32(static_cast<int32>(b))); }
+    static Int Lookup(const int32* table, Int index) { return _mm256_i32gather_epi32(table, index, 4); }
+
+    static Float Select(Int mask, Float a, Float b) { return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask)); }
+    static Int SelectInt(Int mask, Int a, Int b) { return _mm256_blendv_epi8(b, a, mask); }
+    static Float FlipSign(Float a, Int mask) {
+        return _mm256_xor_ps(a, _mm256_castsi256_ps(And(mask, 0x80000000u)));
+    }
+    static uint32 GetMaskBits(Int mask) { return static_cast<uint32>(_mm256_movemask_ps(_mm256_castsi256_ps(mask))); }
+
+    static Float Load(const float32* source) { return _mm256_loadu_ps(source); }
+    static Int LoadInt(const int32* source) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)); }
+    static void Store(float32* dest, Float value) { _mm256_storeu_ps(dest, value); }
+};
+constexpr const char* kNoiseInstructionSet = "AVX2";
+#elif defined(__SSE4_1__)
+struct SimdLanes {
+    static constexpr uint32 kWidth = 4;
+    using Float = __m128;
+    using Int = __m128i;
+
+    static Float Set(float32 value) { return _mm_set1_ps(value); }
+    static Int SetInt(int32 value) { return _mm_set1_epi32(value); }
+
+    static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+    static Float Min(Float a, Float b) { return _mm_min_ps(b, a); }
+    static Float Max(Float a, Float b) { return _mm_max_ps(b, a); }
+    static Float Sqrt(Float a) { return _mm_sqrt_ps(a); }
+    static Float Abs(Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static Float Floor(Float a) { return _mm_floor_ps(a); }
+    static Int ToInt(Float a) { return _mm_cvttps_epi32(a); }
+    static Float ToFloat(Int a) { return _mm_cvtepi32_ps(a); }
+    static Int LessThan(Float a, Float b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+
+    static Int AddInt(Int a, Int b) { return _mm_add_epi32(a, b); }
+    static Int MulInt(Int a, uint32 b) { return _mm_mullo_epi32(a, _mm_set1_epi32(static_cast<int32>(b))); }
+    static Int And(Int a, uint32 bits) { return _mm_and_si128(a, _mm_set1_epi32(static_cast<int32>(bits))); }
+    static Int Or(Int a, Int b) { return _mm_or_si128(a, b); }
+    static Int Xor(Int a, Int b) { return _mm_xor_si128(a, b); }
+    static Int ShiftRight(Int a, int32 bits) { return _mm_srli_epi32(a, bits); }
+    static Int Less(Int a, uint32 b) { return _mm_cmplt_epi32(a, _mm_set1_epi32(static_cast<int32>(b))); }
+    static Int Equal(Int a, uint32 b) { return _mm_cmpeq_epi32(a, _mm_set1_epi32(static_cast<int32>(b))); }
+    static Int Lookup(const int32* table, Int index) {
+        // No gathers before AVX2
+        return _mm_setr_epi32(table[_mm_extract_epi32(index, 0)], table[_mm_extract_epi32(index, 1)],
+                              table[_mm_extract_epi32(index, 2)], table[_mm_extract_epi32(index, 3)]);
+    }
+
+    static Float Select(Int mask, Float a, Float b) { return _mm_blendv_ps(b, a, _mm_castsi128_ps(mask)); }
+    static Int SelectInt(Int mask, Int a, Int b) { return _mm_blendv_epi8(b, a, mask); }
+    static Float FlipSign(Float a, Int mask) {
+        return _mm_xor_ps(a, _mm_castsi128_ps(And(mask, 0x80000000u)));
+    }
+    static uint32 GetMaskBits(Int mask) { return static_cast<uint32>(_mm_movemask_ps(_mm_castsi128_ps(mask))); }
+
+    static Float Load(const float32* source) { return _mm_loadu_ps(source); }
+    static Int LoadInt(const int32* source) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(source)); }
+    static void Store(float32* dest, Float value) { _mm_storeu_ps(dest, value); }
+};
+constexpr const char* kNoiseInstructionSet = "SSE4.1";
+#else
+using SimdLanes = ScalarLanes;
+constexpr const char* kNoiseInstructionSet = "scalar";
+#endif
+
+} // namespace Terrain
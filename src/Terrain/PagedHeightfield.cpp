@@ -0,0 +1,427 @@
+#include "PagedHeightfield.h"
+#include "Core/Logger.h"
+#include "Core/JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+namespace Terrain {
+
+namespace {
+    constexpr uint64 kTileSamples = static_cast<uint64>(kPagedTileSize) * kPagedTileSize;
+    constexpr uint64 kTileBytes = kTileSamples * sizeof(float32);
+
+    String MakeScratchPath() {
+        static std::atomic<uint64> s_Counter{0};
+        uint64 unique = std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+                        static_cast<uint64>(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+                        (s_Counter.fetch_add(1) << 48);
+
+        char name[48];
+        std::snprintf(name, sizeof(name), "terrain-paged-%016llx.tmp", static_cast<unsigned long long>(unique));
+
+        std::error_code error;
+        std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+        if (error) {
+            directory = ".";
+        }
+        return (directory / name).string();
+    }
+}
+
+PagedHeightfield::PagedHeightfield(uint32 width, uint32 height, uint64 residentBytes)
+    : m_Width(width), m_Height(height) {
+    m_TilesX = (width + kPagedTileSize - 1) / kPagedTileSize;
+    m_TilesY = (height + kPagedTileSize - 1) / kPagedTileSize;
+    m_MaxResidentTiles = std::max<uint64>(1, residentBytes / kTileBytes);
+    m_Stored.assign(GetTileCount(), 0);
+
+    m_Path = MakeScratchPath();
+    {
+        // Create the file so it can be opened for reading and writing
+        std::ofstream create(m_Path, std::ios::binary | std::ios::trunc);
+    }
+    m_File.open(m_Path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!m_File.is_open()) {
+        LOG_ERROR("Failed to create heightfield scratch file %s", m_Path.c_str());
+        return;
+    }
+
+    LOG_INFO("Paged heightfield %ux%u: %llu tiles, %llu MB resident budget",
+             width, height,
+             static_cast<unsigned long long>(GetTileCount()),
+             static_cast<unsigned long long>(m_MaxResidentTiles * kTileBytes / (1024 * 1024)));
+}
+
+PagedHeightfield::~PagedHeightfield() {
+    if (m_File.is_open()) {
+        m_File.close();
+    }
+
+    std::error_code error;
+    std::filesystem::remove(m_Path, error);
+}
+
+float32* PagedHeightfield::Acquire(uint64 index) const {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    for (;;) {
+        auto it = m_Lookup.find(index);
+        if (it != m_Lookup.end()) {
+            // Move to front (most recently used). The pin keeps the tile
+            // from being evicted while waiting for another thread's page-in.
+            CachedTile& tile = *it->second;
+            m_Tiles.splice(m_Tiles.begin(), m_Tiles, it->second);
+            tile.pins++;
+            if (tile.loading) {
+                m_IOFinished.wait(lock, [&] { return !tile.loading; });
+            } else {
+                m_Hits++;
+            }
+            return tile.samples.data->data();
+        }
+        if (!m_Writing.contains(index)) {
+            break;
+        }
+        // Evicted and still being written: the file is not current yet
+        m_IOFinished.wait(lock);
+    }
+
+    // Claim the tile as loading, then do the I/O unlocked
+    std::vector<CachedTile> writeBacks;
+    Evict(m_MaxResidentTiles - 1, writeBacks);
+
+    CachedTile loading;
+    loading.index = index;
+    loading.pins = 1;
+    loading.loading = true;
+    loading.samples = BufferPool<float32>::Get().Acquire(kTileSamples, BufferInit::Uninitialized);
+    m_Tiles.push_front(std::move(loading));
+    m_Lookup[index] = m_Tiles.begin();
+    m_PeakResidentTiles = std::max<uint64>(m_PeakResidentTiles, m_Tiles.size());
+
+    CachedTile& tile = m_Tiles.front();
+    float32* samples = tile.samples.data->data();
+    bool stored = m_Stored[index] != 0;
+    float32 fillValue = m_FillValue;
+    m_PendingIO++;
+    lock.unlock();
+
+    WriteBacks(writeBacks);
+
+    bool loaded = false;
+    if (stored) {
+        std::lock_guard<std::mutex> fileLock(m_FileMutex);
+        m_File.clear();
+        m_File.seekg(static_cast<std::streamoff>(index * kTileBytes));
+        loaded = static_cast<bool>(m_File.read(reinterpret_cast<char*>(samples), kTileBytes));
+        if (!loaded) {
+            LOG_ERROR("Failed to read tile %llu from %s", static_cast<unsigned long long>(index), m_Path.c_str());
+        }
+    }
+    if (!loaded) {
+        std::fill(samples, samples + kTileSamples, fillValue);
+    }
+
+    lock.lock();
+    FinishWriteBacks(writeBacks);
+    if (stored) {
+        m_PageIns++;
+    }
+    tile.loading = false;
+    m_PendingIO--;
+    m_IOFinished.notify_all();
+    return samples;
+}
+
+void PagedHeightfield::Release(uint64 index, TileAccess access) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto it = m_Lookup.find(index);
+    if (it == m_Lookup.end()) {
+        return;
+    }
+    it->second->pins--;
+    if (access == TileAccess::ReadWrite) {
+        it->second->dirty = true;
+    }
+}
+
+void PagedHeightfield::Evict(uint64 maxTiles, std::vector<CachedTile>& writeBacks) const {
+    // Oldest first; pinned tiles (including ones being paged in) stay, so
+    // the budget can be exceeded by the tiles currently in use
+    auto it = m_Tiles.end();
+    while (m_Tiles.size() > maxTiles && it != m_Tiles.begin()) {
+        --it;
+        if (it->pins > 0) {
+            continue;
+        }
+
+        m_Lookup.erase(it->index);
+        if (it->dirty) {
+            m_Writing.insert(it->index);
+            m_PendingIO++;
+            writeBacks.push_back(std::move(*it));
+        }
+        it = m_Tiles.erase(it);
+    }
+}
+
+void PagedHeightfield::WriteBacks(std::vector<CachedTile>& tiles) const {
+    for (CachedTile& tile : tiles) {
+        // The tile is out of the cache: dirty now means the write failed
+        tile.dirty = !WriteTile(tile);
+    }
+}
+
+void PagedHeightfield::FinishWriteBacks(const std::vector<CachedTile>& tiles) const {
+    for (const CachedTile& tile : tiles) {
+        if (!tile.dirty) {
+            m_Stored[tile.index] = 1;
+            m_WriteBacks++;
+        }
+        m_Writing.erase(tile.index);
+        m_PendingIO--;
+    }
+    if (!tiles.empty()) {
+        m_IOFinished.notify_all();
+    }
+}
+
+bool PagedHeightfield::WriteTile(const CachedTile& tile) const {
+    std::lock_guard<std::mutex> fileLock(m_FileMutex);
+    m_File.clear();
+    m_File.seekp(static_cast<std::streamoff>(tile.index * kTileBytes));
+    if (!m_File.write(reinterpret_cast<const char*>(tile.samples.data->data()), kTileBytes)) {
+        LOG_ERROR("Failed to write tile %llu to %s", static_cast<unsigned long long>(tile.index), m_Path.c_str());
+        return false;
+    }
+    return true;
+}
+
+PagedTile PagedHeightfield::MakeTile(uint64 index, float32* samples) const {
+    PagedTile tile;
+    tile.samples = samples;
+    tile.x = static_cast<uint32>(index % m_TilesX) * kPagedTileSize;
+    tile.y = static_cast<uint32>(index / m_TilesX) * kPagedTileSize;
+    tile.width = std::min(kPagedTileSize, m_Width - tile.x);
+    tile.height = std::min(kPagedTileSize, m_Height - tile.y);
+    return tile;
+}
+
+float32 PagedHeightfield::GetHeight(uint32 x, uint32 y) const {
+    if (x >= m_Width || y >= m_Height) return 0.0f;
+
+    uint64 index = static_cast<uint64>(y / kPagedTileSize) * m_TilesX + x / kPagedTileSize;
+    const float32* samples = Acquire(index);
+    float32 height = samples[static_cast<size_t>(y % kPagedTileSize) * kPagedTileSize + x % kPagedTileSize];
+    Release(index, TileAccess::Read);
+    return height;
+}
+
+void PagedHeightfield::SetHeight(uint32 x, uint32 y, float32 height) {
+    if (x >= m_Width || y >= m_Height) return;
+
+    uint64 index = static_cast<uint64>(y / kPagedTileSize) * m_TilesX + x / kPagedTileSize;
+    float32* samples = Acquire(index);
+    samples[static_cast<size_t>(y % kPagedTileSize) * kPagedTileSize + x % kPagedTileSize] = height;
+    Release(index, TileAccess::ReadWrite);
+}
+
+void PagedHeightfield::ReadRegion(uint32 x, uint32 y, uint32 width, uint32 height, float32* out) const {
+    if (x + width > m_Width || y + height > m_Height) {
+        LOG_ERROR("Paged heightfield: region %ux%u at (%u, %u) is out of bounds", width, height, x, y);
+        return;
+    }
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    for (uint32 tileY = y / kPagedTileSize; tileY <= (y + height - 1) / kPagedTileSize; tileY++) {
+        for (uint32 tileX = x / kPagedTileSize; tileX <= (x + width - 1) / kPagedTileSize; tileX++) {
+            uint64 index = static_cast<uint64>(tileY) * m_TilesX + tileX;
+            PagedTile tile = MakeTile(index, Acquire(index));
+
+            uint32 x0 = std::max(x, tile.x);
+            uint32 x1 = std::min(x + width, tile.x + tile.width);
+            uint32 y0 = std::max(y, tile.y);
+            uint32 y1 = std::min(y + height, tile.y + tile.height);
+            for (uint32 row = y0; row < y1; row++) {
+                const float32* source = tile.Row(row - tile.y) + (x0 - tile.x);
+                std::copy(source, source + (x1 - x0), out + static_cast<size_t>(row - y) * width + (x0 - x));
+            }
+
+            Release(index, TileAccess::Read);
+        }
+    }
+}
+
+void PagedHeightfield::WriteRegion(uint32 x, uint32 y, uint32 width, uint32 height, const float32* data) {
+    if (x + width > m_Width || y + height > m_Height) {
+        LOG_ERROR("Paged heightfield: region %ux%u at (%u, %u) is out of bounds", width, height, x, y);
+        return;
+    }
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    for (uint32 tileY = y / kPagedTileSize; tileY <= (y + height - 1) / kPagedTileSize; tileY++) {
+        for (uint32 tileX = x / kPagedTileSize; tileX <= (x + width - 1) / kPagedTileSize; tileX++) {
+            uint64 index = static_cast<uint64>(tileY) * m_TilesX + tileX;
+            PagedTile tile = MakeTile(index, Acquire(index));
+
+            uint32 x0 = std::max(x, tile.x);
+            uint32 x1 = std::min(x + width, tile.x + tile.width);
+            uint32 y0 = std::max(y, tile.y);
+            uint32 y1 = std::min(y + height, tile.y + tile.height);
+            for (uint32 row = y0; row < y1; row++) {
+                const float32* source = data + static_cast<size_t>(row - y) * width + (x0 - x);
+                std::copy(source, source + (x1 - x0), tile.Row(row - tile.y) + (x0 - tile.x));
+            }
+
+            Release(index, TileAccess::ReadWrite);
+        }
+    }
+}
+
+Unique<Heightfield> PagedHeightfield::ReadHeightfield(uint32 x, uint32 y, uint32 width, uint32 height) const {
+    auto heightfield = MakeUnique<Heightfield>(width, height, BufferInit::Uninitialized);
+    ReadRegion(x, y, width, height, heightfield->GetDataMutable().data());
+    return heightfield;
+}
+
+void PagedHeightfield::WriteHeightfield(uint32 x, uint32 y, const Heightfield& heightfield) {
+    if (!heightfield.IsResolved()) {
+        Heightfield resolved(heightfield);
+        resolved.Resolve();
+        WriteRegion(x, y, resolved.GetWidth(), resolved.GetHeight(), resolved.GetData().data());
+        return;
+    }
+    WriteRegion(x, y, heightfield.GetWidth(), heightfield.GetHeight(), heightfield.GetData().data());
+}
+
+void PagedHeightfield::VisitTiles(TileAccess access, const std::function<void(const PagedTile&)>& fn) const {
+    // One tile per task: a tile is already 64k samples, and far fewer tiles
+    // than ParallelForSamples' chunk size
+    ParallelFor(0, static_cast<uint32>(GetTileCount()), 1, [&](uint32 begin, uint32 end) {
+        for (uint64 index = begin; index < end; index++) {
+            fn(MakeTile(index, Acquire(index)));
+            Release(index, access);
+        }
+    });
+}
+
+void PagedHeightfield::ForEachTile(TileAccess access, const std::function<void(const PagedTile&)>& fn) {
+    VisitTiles(access, fn);
+}
+
+void PagedHeightfield::Clear(float32 value) {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    // In-flight I/O would store or load samples of the old contents
+    m_IOFinished.wait(lock, [&] { return m_PendingIO == 0; });
+
+    // Stored tiles become stale; unstored tiles read as the fill value
+    std::fill(m_Stored.begin(), m_Stored.end(), 0);
+    m_FillValue = value;
+    for (CachedTile& tile : m_Tiles) {
+        std::fill(tile.samples.data->begin(), tile.samples.data->end(), value);
+        tile.dirty = false;
+    }
+}
+
+void PagedHeightfield::Normalize(float32 minVal, float32 maxVal) {
+    float32 currentMin = GetMin();
+    float32 currentMax = GetMax();
+
+    if (currentMax - currentMin < 0.0001f) {
+        Clear((minVal + maxVal) * 0.5f);
+        return;
+    }
+
+    // Same arithmetic as Heightfield::Normalize
+    ForEachTile(TileAccess::ReadWrite, [&](const PagedTile& tile) {
+        for (uint32 y = 0; y < tile.height; y++) {
+            float32* row = tile.Row(y);
+            for (uint32 x = 0; x < tile.width; x++) {
+                row[x] = minVal + (row[x] - currentMin) / (currentMax - currentMin) * (maxVal - minVal);
+            }
+        }
+    });
+}
+
+float32 PagedHeightfield::Reduce(bool max) const {
+    if (GetTileCount() == 0) {
+        return 0.0f;
+    }
+
+    std::vector<float32> tileResults(GetTileCount());
+    VisitTiles(TileAccess::Read, [&](const PagedTile& tile) {
+        float32 result = tile.samples[0];
+        for (uint32 y = 0; y < tile.height; y++) {
+            const float32* row = tile.Row(y);
+            for (uint32 x = 0; x < tile.width; x++) {
+                result = max ? std::max(result, row[x]) : std::min(result, row[x]);
+            }
+        }
+        tileResults[static_cast<uint64>(tile.y / kPagedTileSize) * m_TilesX + tile.x / kPagedTileSize] = result;
+    });
+
+    return max ? *std::max_element(tileResults.begin(), tileResults.end())
+               : *std::min_element(tileResults.begin(), tileResults.end());
+}
+
+float32 PagedHeightfield::GetMin() const {
+    return Reduce(false);
+}
+
+float32 PagedHeightfield::GetMax() const {
+    return Reduce(true);
+}
+
+void PagedHeightfield::Flush() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_IOFinished.wait(lock, [&] { return m_PendingIO == 0; });
+    for (CachedTile& tile : m_Tiles) {
+        if (tile.dirty && WriteTile(tile)) {
+            m_Stored[tile.index] = 1;
+            tile.dirty = false;
+            m_WriteBacks++;
+        }
+    }
+    std::lock_guard<std::mutex> fileLock(m_FileMutex);
+    m_File.flush();
+}
+
+void PagedHeightfield::SetResidentBytes(uint64 bytes) {
+    std::vector<CachedTile> writeBacks;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_MaxResidentTiles = std::max<uint64>(1, bytes / kTileBytes);
+
+        // Shrink now rather than on the next page-in
+        Evict(m_MaxResidentTiles, writeBacks);
+    }
+
+    WriteBacks(writeBacks);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    FinishWriteBacks(writeBacks);
+}
+
+PagedHeightfieldStats PagedHeightfield::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    PagedHeightfieldStats stats;
+    stats.hits = m_Hits;
+    stats.pageIns = m_PageIns;
+    stats.writeBacks = m_WriteBacks;
+    stats.residentBytes = m_Tiles.size() * kTileBytes;
+    stats.peakResidentBytes = m_PeakResidentTiles * kTileBytes;
+    return stats;
+}
+
+} // namespace Terrain
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "Core/Types.h"
+#include "Core/BufferPool.h"
+#include "Heightfield.h"
+#include <fstream>
+#include <functional>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Terrain {
+
+// Tiles of a PagedHeightfield are kPagedTileSize samples square (256 KB)
+constexpr uint32 kPagedTileSize = 256;
+
+// One resident tile handed to PagedHeightfield::ForEachTile
+struct PagedTile {
+    float32* samples = nullptr;  // Row-major, kPagedTileSize samples per row
+    uint32 x = 0;                // Position of the first sample in the map
+    uint32 y = 0;
+    uint32 width = 0;            // Samples inside the map; edge tiles may be partial
+    uint32 height = 0;
+
+    float32* Row(uint32 localY) const { return samples + static_cast<size_t>(localY) * kPagedTileSize; }
+};
+
+enum class TileAccess {
+    Read,       // Samples are only read; the tile is not written back
+    ReadWrite   // Samples may change; the tile is written back when evicted
+};
+
+struct PagedHeightfieldStats {
+    uint64 hits = 0;           // Tile requests served from memory
+    uint64 pageIns = 0;        // Tiles read from the scratch file
+    uint64 writeBacks = 0;     // Dirty tiles written to the scratch file
+    uint64 residentBytes = 0;  // Currently resident
+    uint64 peakResidentBytes = 0;
+};
+
+// Heightfield for maps larger than memory. Samples live in a scratch file as
+// square tiles, and a bounded LRU cache keeps the recently used tiles
+// resident; dirty tiles are written back when evicted. Sample counts and
+// file offsets are 64-bit, so 64k x 64k maps (2^32 samples) work.
+//
+// The accessors mirror Heightfield, plus row-major region I/O for moving
+// windows in and out of in-memory Heightfields and ForEachTile for streaming
+// kernels. Memory use is bounded by the resident budget plus one tile per
+// thread inside ForEachTile. Tiles that were never written read as the
+// value of the last Clear() (0 initially) without touching the file.
+//
+// NodeGraph::ExecuteWorld generates world regions of any size into one,
+// tile by tile, and TerrainGenerator::ExportRAW streams it to disk.
+//
+// All methods are thread-safe. File I/O runs outside the cache lock, so
+// threads whose tiles are resident are never held up by another thread's
+// page-in or write-back; the I/O itself is serialized on the scratch file.
+class PagedHeightfield {
+public:
+    PagedHeightfield(uint32 width, uint32 height, uint64 residentBytes = 512ull * 1024 * 1024);
+    ~PagedHeightfield();
+
+    PagedHeightfield(const PagedHeightfield&) = delete;
+    PagedHeightfield& operator=(const PagedHeightfield&) = delete;
+
+    // False if the scratch file could not be created
+    bool IsValid() const { return m_File.is_open(); }
+
+    // Dimensions
+    uint32 GetWidth() const { return m_Width; }
+    uint32 GetHeight() const { return m_Height; }
+    uint64 GetPixelCount() const { return static_cast<uint64>(m_Width) * m_Height; }
+    uint32 GetTilesX() const { return m_TilesX; }
+    uint32 GetTilesY() const { return m_TilesY; }
+    uint64 GetTileCount() const { return static_cast<uint64>(m_TilesX) * m_TilesY; }
+
+    // Single samples (slow path: one cache lookup each)
+    float32 GetHeight(uint32 x, uint32 y) const;
+    void SetHeight(uint32 x, uint32 y, float32 height);
+
+    // Row-major windows
+    void ReadRegion(uint32 x, uint32 y, uint32 width, uint32 height, float32* out) const;
+    void WriteRegion(uint32 x, uint32 y, uint32 width, uint32 height, const float32* data);
+    Unique<Heightfield> ReadHeightfield(uint32 x, uint32 y, uint32 width, uint32 height) const;
+    void WriteHeightfield(uint32 x, uint32 y, const Heightfield& heightfield);
+
+    // Run fn for every tile on the job system
+    void ForEachTile(TileAccess access, const std::function<void(const PagedTile&)>& fn);
+
+    // Operations
+    void Clear(float32 value = 0.0f);
+    void Normalize(float32 minVal = 0.0f, float32 maxVal = 1.0f);
+    float32 GetMin() const;
+    float32 GetMax() const;
+
+    // Write all dirty resident tiles to the scratch file
+    void Flush();
+
+    void SetResidentBytes(uint64 bytes);
+    PagedHeightfieldStats GetStats() const;
+
+private:
+    struct CachedTile {
+        uint64 index = 0;
+        PooledBuffer<float32> samples;
+        bool dirty = false;
+        bool loading = false; // Being paged in; other threads wait for it
+        uint32 pins = 0;
+    };
+    using TileList = std::list<CachedTile>;
+
+    // Pin a tile in memory, paging it in if needed; Release unpins it
+    float32* Acquire(uint64 index) const;
+    void Release(uint64 index, TileAccess access) const;
+
+    PagedTile MakeTile(uint64 index, float32* samples) const;
+    void VisitTiles(TileAccess access, const std::function<void(const PagedTile&)>& fn) const;
+
+    // Take unpinned tiles out of the cache, oldest first, until at most
+    // maxTiles remain (locked). Dirty ones are moved to writeBacks and stay
+    // marked as being written until FinishWriteBacks.
+    void Evict(uint64 maxTiles, std::vector<CachedTile>& writeBacks) const;
+    void WriteBacks(std::vector<CachedTile>& tiles) const; // Unlocked: file I/O only
+    void FinishWriteBacks(const std::vector<CachedTile>& tiles) const; // Locked
+    bool WriteTile(const CachedTile& tile) const; // File I/O
+
+    // Min (or max) over all samples, combined in tile order
+    float32 Reduce(bool max) const;
+
+    uint32 m_Width;
+    uint32 m_Height;
+    uint32 m_TilesX;
+    uint32 m_TilesY;
+    uint64 m_MaxResidentTiles;
+    String m_Path;
+
+    // Cache state changes on reads, hence mutable. m_Mutex guards the cache,
+    // m_FileMutex the scratch file; m_FileMutex is never taken while
+    // m_Mutex is held, except by Flush.
+    mutable std::mutex m_Mutex;
+    mutable std::condition_variable m_IOFinished;
+    mutable std::mutex m_FileMutex;
+    mutable std::fstream m_File;
+    mutable TileList m_Tiles;  // Most recently used first
+    mutable std::unordered_map<uint64, TileList::iterator> m_Lookup;
+    mutable std::unordered_set<uint64> m_Writing; // Evicted tiles not yet on disk
+    mutable uint32 m_PendingIO = 0;               // Page-ins and write-backs in progress
+    mutable std::vector<uint8> m_Stored;  // Per tile: the scratch file holds its samples
+    float32 m_FillValue = 0.0f;           // Samples of tiles never stored
+
+    mutable uint64 m_Hits = 0;
+    mutable uint64 m_PageIns = 0;
+    mutable uint64 m_WriteBacks = 0;
+    mutable uint64 m_PeakResidentTiles = 0;
+};
+
+} // namespace Terrain
@@ -0,0 +1,326 @@
+#include "PerlinNoise.h"
+#include "NoiseLanes.h"
+#include "Core/JobSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace Terrain {
+
+namespace {
+    // Permutation table of perlin_noise.comp
+    constexpr int32 kPermutation[256] = {
+        151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,
+        8,99,37,240,21,10,23,190,6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,
+        35,11,32,57,177,33,88,237,149,56,87,174,20,125,136,171,168,68,175,74,165,71,
+        134,139,48,27,166,77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,
+        55,46,245,40,244,102,143,54,65,25,63,161,1,216,80,73,209,76,132,187,208,89,
+        18,169,200,196,135,130,116,188,159,86,164,100,109,198,173,186,3,64,52,217,226,
+        250,124,123,5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,
+        189,28,42,223,183,170,213,119,248,152,2,44,154,163,70,221,153,101,155,167,43,
+        172,9,129,22,39,253,19,98,108,110,79,113,224,232,178,185,112,104,218,246,97,
+        228,251,34,242,193,238,210,144,12,191,179,162,241,81,51,145,235,249,14,239,
+        107,49,192,214,31,181,199,106,157,184,84,204,176,115,121,50,45,127,4,150,254,
+        138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
+    };
+
+    // Per-octave constants, accumulated in float exactly as the shaders'
+    // loops do
+    struct OctaveTable {
+        int32 count = 0;
+        std::vector<float32> frequency;
+        std::vector<float32> amplitude;
+        float32 maxValue = 0.0f;
+        int32 seed = 0;
+
+        // PerlinParams or RidgedParams
+        template<typename Params>
+        explicit OctaveTable(const Params& params) {
+            count = std::max(params.octaves, 0);
+            seed = static_cast<int32>(params.seed);
+            float32 amp = 1.0f;
+            float32 freq = 1.0f;
+            for (int32 i = 0; i < count; i++) {
+                frequency.push_back(freq);
+                amplitude.push_back(amp);
+                maxValue += amp;
+                amp *= params.persistence;
+                freq *= params.lacunarity;
+            }
+        }
+    };
+
+    template<typename L>
+    typename L::Int Hash(typename L::Int x, typename L::Int y, typename L::Int seed) {
+        typename L::Int h = L::Lookup(kPermutation, L::And(L::AddInt(x, seed), 255));
+        return L::Lookup(kPermutation, L::And(L::AddInt(h, y), 255));
+    }
+
+    template<typename L>
+    typename L::Float Fade(typename L::Float t) {
+        using F = typename L::Float;
+        F cube = L::Mul(L::Mul(t, t), t);
+        F inner = L::Add(L::Mul(t, L::Sub(L::Mul(t, L::Set(6.0f)), L::Set(15.0f))), L::Set(10.0f));
+        return L::Mul(cube, inner);
+    }
+
+    template<typename L>
+    typename L::Float Lerp(typename L::Float a, typename L::Float b, typename L::Float t) {
+        return L::Add(a, L::Mul(t, L::Sub(b, a)));
+    }
+
+    template<typename L>
+    typename L::Float Grad(typename L::Int hash, typename L::Float x, typename L::Float y) {
+        typename L::Int h = L::And(hash, 15);
+        typename L::Float u = L::Select(L::Less(h, 8), x, y);
+        typename L::Float v = L::Select(L::Less(h, 4), y,
+                                        L::Select(L::Or(L::Equal(h, 12), L::Equal(h, 14)), x, L::Set(0.0f)));
+        return L::Add(L::FlipSign(u, L::Equal(L::And(h, 1), 1)), L::FlipSign(v, L::Equal(L::And(h, 2), 2)));
+    }
+
+    template<typename L>
+    typename L::Float Perlin(typename L::Float x, typename L::Float y, typename L::Int seed) {
+        using F = typename L::Float;
+        using I = typename L::Int;
+
+        F floorX = L::Floor(x);
+        F floorY = L::Floor(y);
+        I cellX = L::And(L::ToInt(floorX), 255);
+        I cellY = L::And(L::ToInt(floorY), 255);
+        x = L::Sub(x, floorX);
+        y = L::Sub(y, floorY);
+
+        F u = Fade<L>(x);
+        F v = Fade<L>(y);
+
+        I one = L::SetInt(1);
+        I aa = Hash<L>(cellX, cellY, seed);
+        I ab = Hash<L>(cellX, L::AddInt(cellY, one), seed);
+        I ba = Hash<L>(L::AddInt(cellX, one), cellY, seed);
+        I bb = Hash<L>(L::AddInt(cellX, one), L::AddInt(cellY, one), seed);
+
+        F xm1 = L::Sub(x, L::Set(1.0f));
+        F ym1 = L::Sub(y, L::Set(1.0f));
+        F gradAA = Grad<L>(aa, x, y);
+        F gradBA = Grad<L>(ba, xm1, y);
+        F gradAB = Grad<L>(ab, x, ym1);
+        F gradBB = Grad<L>(bb, xm1, ym1);
+
+        return Lerp<L>(Lerp<L>(gradAA, gradBA, u), Lerp<L>(gradAB, gradBB, u), v);
+    }
+
+    // Octaves > 0 fixes the octave count at compile time; 0 reads it from
+    // the table
+    template<typename L, int32 Octaves>
+    typename L::Float Fbm(typename L::Float x, typename L::Float y, const OctaveTable& octaves) {
+        typename L::Float value = L::Set(0.0f);
+        int32 count = Octaves > 0 ? Octaves : octaves.count;
+        for (int32 i = 0; i < count; i++) {
+            typename L::Float frequency = L::Set(octaves.frequency[i]);
+            typename L::Float noise = Perlin<L>(L::Mul(x, frequency), L::Mul(y, frequency), L::SetInt(octaves.seed + i));
+            value = L::Add(value, L::Mul(noise, L::Set(octaves.amplitude[i])));
+        }
+        return L::Div(value, L::Set(octaves.maxValue));
+    }
+
+    // Approximates signal^sharpness for a sharpness of power + fraction: the
+    // integer power, then a linear blend towards one more factor of signal
+    // (exact for whole sharpnesses only; see GenerateRidgedCPU)
+    template<typename L>
+    typename L::Float Sharpen(typename L::Float signal, int32 power, float32 fraction) {
+        typename L::Float result = L::Set(1.0f);
+        for (int32 i = 0; i < power; i++) {
+            result = L::Mul(result, signal);
+        }
+        if (fraction == 0.0f) {
+            return result; // The blend would multiply by exactly one
+        }
+        return L::Mul(result, L::Add(L::Set(1.0f - fraction), L::Mul(L::Set(fraction), signal)));
+    }
+
+    // Kernels turn noise-space positions (before the octave frequencies)
+    // into final heights
+
+    // fBm remapped to [0, amplitude], as perlin_noise.comp
+    struct FbmKernel {
+        const PerlinParams& params;
+        OctaveTable octaves;
+
+        explicit FbmKernel(const PerlinParams& params) : params(params), octaves(params) {}
+
+        template<typename L, int32 Octaves>
+        typename L::Float Heights(typename L::Float posX, typename L::Float posY) const {
+            typename L::Float noise = Fbm<L, Octaves>(posX, posY, octaves);
+            return L::Mul(L::Add(L::Mul(noise, L::Set(0.5f)), L::Set(0.5f)), L::Set(params.amplitude));
+        }
+    };
+
+    // Ridged multifractal, as ridged_noise.comp
+    struct RidgedKernel {
+        const RidgedParams& params;
+        OctaveTable octaves;
+        int32 power = 0;
+        float32 fraction = 0.0f;
+        float32 maxValue = 0.0f; // Of the weighted sum, 0 if every signal is
+
+        explicit RidgedKernel(const RidgedParams& params) : params(params), octaves(params) {
+            float32 sharpness = std::clamp(params.sharpness, 0.0f, kMaxRidgeSharpness);
+            power = static_cast<int32>(std::floor(sharpness));
+            fraction = sharpness - static_cast<float32>(power);
+            // Weights never exceed one, so the sum peaks where every octave
+            // is at its ridge
+            float32 peak = Sharpen<ScalarLanes>(std::max(params.ridgeOffset, 0.0f), power, fraction);
+            maxValue = octaves.maxValue * peak;
+        }
+
+        template<typename L, int32 Octaves>
+        typename L::Float Heights(typename L::Float x, typename L::Float y) const {
+            using F = typename L::Float;
+            if (!(maxValue > 0.0f)) {
+                return L::Set(0.0f);
+            }
+
+            const F zero = L::Set(0.0f);
+            const F one = L::Set(1.0f);
+            const F offset = L::Set(params.ridgeOffset);
+            const F gain = L::Set(params.gain);
+            F value = zero;
+            F weight = one;
+            int32 count = Octaves > 0 ? Octaves : octaves.count;
+            for (int32 i = 0; i < count; i++) {
+                F frequency = L::Set(octaves.frequency[i]);
+                F noise = Perlin<L>(L::Mul(x, frequency), L::Mul(y, frequency), L::SetInt(octaves.seed + i));
+                F signal = Sharpen<L>(L::Max(L::Sub(offset, L::Abs(noise)), zero), power, fraction);
+                // Octaves only add detail where the ones below are near a ridge
+                signal = L::Mul(signal, weight);
+                weight = L::Min(L::Max(L::Mul(signal, gain), zero), one);
+                value = L::Add(value, L::Mul(signal, L::Set(octaves.amplitude[i])));
+            }
+            return L::Mul(L::Div(value, L::Set(maxValue)), L::Set(params.amplitude));
+        }
+    };
+
+    // Noise-space positions of a view's columns and rows. Samples only
+    // depend on them, so kernels over different views agree wherever their
+    // positions do.
+    struct SamplePositions {
+        std::vector<float32> x;
+        std::vector<float32> y;
+    };
+
+    // The shader's: pixel / size * frequency, in float
+    SamplePositions GetImagePositions(uint32 width, uint32 height, float32 frequency) {
+        SamplePositions positions;
+        positions.x.resize(width);
+        positions.y.resize(height);
+        for (uint32 x = 0; x < width; x++) {
+            positions.x[x] = (static_cast<float32>(x) / static_cast<float32>(width)) * frequency;
+        }
+        for (uint32 y = 0; y < height; y++) {
+            positions.y[y] = (static_cast<float32>(y) / static_cast<float32>(height)) * frequency;
+        }
+        return positions;
+    }
+
+    // World position * frequency, in double, rounded once
+    SamplePositions GetWorldPositions(const WorldRegion& region, float32 frequency) {
+        SamplePositions positions;
+        positions.x.resize(region.width);
+        positions.y.resize(region.height);
+        for (uint32 x = 0; x < region.width; x++) {
+            positions.x[x] = static_cast<float32>(region.GetWorldX(x) * frequency);
+        }
+        for (uint32 y = 0; y < region.height; y++) {
+            positions.y[y] = static_cast<float32>(region.GetWorldY(y) * frequency);
+        }
+        return positions;
+    }
+
+    template<int32 Octaves, typename Kernel>
+    void GenerateRows(HeightfieldView<float32> view, const SamplePositions& positions, const Kernel& kernel) {
+        ParallelForRows(view.height, [&](uint32 rowBegin, uint32 rowEnd) {
+            const float32* xs = positions.x.data();
+            for (uint32 y = rowBegin; y < rowEnd; y++) {
+                float32* row = view.Row(y).data();
+                SimdLanes::Float simdY = SimdLanes::Set(positions.y[y]);
+                uint32 x = 0;
+                for (; x + SimdLanes::kWidth <= view.width; x += SimdLanes::kWidth) {
+                    SimdLanes::Store(row + x, kernel.template Heights<SimdLanes, Octaves>(SimdLanes::Load(xs + x), simdY));
+                }
+                for (; x < view.width; x++) {
+                    row[x] = kernel.template Heights<ScalarLanes, Octaves>(xs[x], positions.y[y]);
+                }
+            }
+        });
+    }
+
+    template<typename Kernel, int32... Counts>
+    void Dispatch(HeightfieldView<float32> view, const SamplePositions& positions, const Kernel& kernel,
+                  std::integer_sequence<int32, Counts...>) {
+        int32 octaveCount = kernel.octaves.count;
+        bool specialized = ((octaveCount == Counts + 1 ? (GenerateRows<Counts + 1>(view, positions, kernel), true) : false) || ...);
+        if (!specialized) {
+            GenerateRows<0>(view, positions, kernel);
+        }
+    }
+
+    template<typename Kernel>
+    void Generate(HeightfieldView<float32> view, const SamplePositions& positions, const Kernel& kernel) {
+        Dispatch(view, positions, kernel, std::make_integer_sequence<int32, kMaxSpecializedOctaves>());
+    }
+
+    template<typename Kernel>
+    float32 SampleImage(uint32 x, uint32 y, uint32 width, uint32 height, float32 frequency, const Kernel& kernel) {
+        float32 posX = (static_cast<float32>(x) / static_cast<float32>(width)) * frequency;
+        float32 posY = (static_cast<float32>(y) / static_cast<float32>(height)) * frequency;
+        return kernel.template Heights<ScalarLanes, 0>(posX, posY);
+    }
+
+    template<typename Kernel>
+    float32 SampleWorld(float64 worldX, float64 worldY, float32 frequency, const Kernel& kernel) {
+        return kernel.template Heights<ScalarLanes, 0>(static_cast<float32>(worldX * frequency),
+                                                       static_cast<float32>(worldY * frequency));
+    }
+}
+
+const char* GetPerlinInstructionSet() {
+    return kNoiseInstructionSet;
+}
+
+void GeneratePerlinCPU(HeightfieldView<float32> view, const PerlinParams& params) {
+    Generate(view, GetImagePositions(view.width, view.height, params.frequency), FbmKernel(params));
+}
+
+void GeneratePerlinCPU(HeightfieldView<float32> view, const WorldRegion& region, const PerlinParams& params) {
+    assert(view.width == region.width && view.height == region.height);
+    Generate(view, GetWorldPositions(region, params.frequency), FbmKernel(params));
+}
+
+float32 SamplePerlinCPU(uint32 x, uint32 y, uint32 width, uint32 height, const PerlinParams& params) {
+    return SampleImage(x, y, width, height, params.frequency, FbmKernel(params));
+}
+
+float32 SamplePerlinCPU(float64 worldX, float64 worldY, const PerlinParams& params) {
+    return SampleWorld(worldX, worldY, params.frequency, FbmKernel(params));
+}
+
+void GenerateRidgedCPU(HeightfieldView<float32> view, const RidgedParams& params) {
+    Generate(view, GetImagePositions(view.width, view.height, params.frequency), RidgedKernel(params));
+}
+
+void GenerateRidgedCPU(HeightfieldView<float32> view, const WorldRegion& region, const RidgedParams& params) {
+    assert(view.width == region.width && view.height == region.height);
+    Generate(view, GetWorldPositions(region, params.frequency), RidgedKernel(params));
+}
+
+float32 SampleRidgedCPU(uint32 x, uint32 y, uint32 width, uint32 height, const RidgedParams& params) {
+    return SampleImage(x, y, width, height, params.frequency, RidgedKernel(params));
+}
+
+float32 SampleRidgedCPU(float64 worldX, float64 worldY, const RidgedParams& params) {
+    return SampleWorld(worldX, worldY, params.frequency, RidgedKernel(params));
+}
+
+} // namespace Terrain
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Core/Types.h"
+#include "HeightfieldView.h"
+#include "WorldRegion.h"
+
+namespace Terrain {
+
+struct PerlinParams {
+    float32 frequency = 1.0f;
+    float32 amplitude = 1.0f;
+    int32 octaves = 6;
+    float32 lacunarity = 2.0f;
+    float32 persistence = 0.5f;
+    uint32 seed = 12345;
+};
+
+struct RidgedParams {
+    float32 frequency = 1.0f;
+    float32 amplitude = 1.0f;
+    int32 octaves = 6;
+    float32 lacunarity = 2.0f;
+    float32 persistence = 0.5f;
+    float32 ridgeOffset = 1.0f; // Signal at a ridge; |noise| is subtracted from it
+    float32 gain = 2.0f;        // Weight of the next octave per unit of this one's signal
+    float32 sharpness = 2.0f;   // Approximate exponent on each octave's signal (see below), 0 to kMaxRidgeSharpness
+    uint32 seed = 12345;
+};
+
+constexpr float32 kMaxRidgeSharpness = 8.0f;
+
+// CPU implementation of shaders/perlin_noise.comp. It uses the shader's
+// permutation table, fade, gradients, octave loop and normalization with the
+// same float operations in the same order, so the two agree up to the GPU's
+// own rounding (the CPU never fuses multiply-adds).
+//
+// Kernels are compiled for AVX2 (8 samples at a time), SSE4.1 (4) or plain
+// scalar code, whichever the build targets; all three produce identical
+// results. Octave counts up to kMaxSpecializedOctaves get a fully unrolled
+// kernel.
+constexpr int32 kMaxSpecializedOctaves = 12;
+
+// Instruction set the kernels were compiled for ("AVX2", "SSE4.1", "scalar")
+const char* GetPerlinInstructionSet();
+
+// Fill a view with the fBm heights the shader computes for an image of the
+// view's dimensions, on the job system
+void GeneratePerlinCPU(HeightfieldView<float32> view, const PerlinParams& params);
+
+// Fill a view with a region of the world: sample (x, y) takes its noise
+// position from the region's world position times params.frequency, so
+// regions that overlap agree bit for bit
+void GeneratePerlinCPU(HeightfieldView<float32> view, const WorldRegion& region, const PerlinParams& params);
+
+// Height of one pixel of a width x height image (scalar reference)
+float32 SamplePerlinCPU(uint32 x, uint32 y, uint32 width, uint32 height, const PerlinParams& params);
+
+// Height at a world position (scalar reference)
+float32 SamplePerlinCPU(float64 worldX, float64 worldY, const PerlinParams& params);
+
+// CPU implementation of shaders/ridged_noise.comp, Musgrave's ridged
+// multifractal in one pass. Each octave's signal is
+//   Sharpen(max(ridgeOffset - |perlin|, 0)) * weight
+// where weight is the previous octave's signal times gain, clamped to
+// [0, 1]. Sharpen is pow(s, sharpness) for whole sharpnesses; in between it
+// blends linearly from s^n to s^(n+1), n = floor(sharpness):
+//   s^n * ((1 - f) + f * s), f = sharpness - n
+// which is cheaper than pow, monotonic in the sharpness and exact at the
+// ends, but not a true power: sharpness 2.5 turns 0.25 into 0.039 where
+// pow gives 0.031. The sum is divided by its largest possible value, so heights lie
+// in [0, amplitude] without a normalization pass. Same positions, lanes and
+// octave specializations as the fBm kernels.
+void GenerateRidgedCPU(HeightfieldView<float32> view, const RidgedParams& params);
+void GenerateRidgedCPU(HeightfieldView<float32> view, const WorldRegion& region, const RidgedParams& params);
+float32 SampleRidgedCPU(uint32 x, uint32 y, uint32 width, uint32 height, const RidgedParams& params);
+float32 SampleRidgedCPU(float64 worldX, float64 worldY, const RidgedParams& params);
+
+} // namespace Terrain
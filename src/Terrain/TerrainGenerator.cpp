@@ -1,11 +1,15 @@
 #include "TerrainGenerator.h"
 #include "Core/Logger.h"
+#include "Core/JobSystem.h"
+#include "PagedHeightfield.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb/stb_image_write.h"
 
 #include <fstream>
 #include <algorithm>
+#include <chrono>
+#include <filesystem>
 
 namespace Terrain {
 
@@ -18,7 +22,28 @@ TerrainGenerator::~TerrainGenerator() {
 
 bool TerrainGenerator::Initialize() {
     LOG_INFO("Initializing Terrain Generator...");
+    m_Backend = s_DefaultBackend;
 
+    if (m_Backend == NoiseBackend::CPU) {
+        LOG_INFO("Terrain Generator initialized with the CPU noise backend (%s)", GetPerlinInstructionSet());
+        return true;
+    }
+
+    if (!InitializeGPU()) {
+        // Drop whatever part of the GPU setup succeeded
+        Shutdown();
+        if (m_Backend == NoiseBackend::GPU) {
+            return false;
+        }
+        LOG_WARN("Vulkan unavailable; generating noise on the CPU (%s)", GetPerlinInstructionSet());
+        return true;
+    }
+
+    LOG_INFO("Terrain Generator initialized successfully");
+    return true;
+}
+
+bool TerrainGenerator::InitializeGPU() {
     // Initialize Vulkan
     m_VulkanContext = MakeUnique<VulkanContext>();
     if (!m_VulkanContext->Initialize(true)) {
@@ -47,11 +72,18 @@ bool TerrainGenerator::Initialize() {
         return false;
     }
 
-    LOG_INFO("Terrain Generator initialized successfully");
+    // Load ridged multifractal pipeline. Optional: without it ridged noise
+    // is generated on the CPU and Perlin stays on the GPU.
+    m_RidgedPipeline = MakeUnique<ComputePipeline>(m_VulkanContext.get());
+    if (!m_RidgedPipeline->LoadShader("shaders/ridged_noise.comp.spv") || !m_RidgedPipeline->CreatePipeline()) {
+        LOG_WARN("Ridged noise shader unavailable; generating ridged noise on the CPU (%s)", GetPerlinInstructionSet());
+        m_RidgedPipeline.reset();
+    }
     return true;
 }
 
 void TerrainGenerator::Shutdown() {
+    m_RidgedPipeline.reset();
     m_PerlinPipeline.reset();
     m_CommandManager.reset();
     m_BufferManager.reset();
@@ -61,16 +93,47 @@ void TerrainGenerator::Shutdown() {
 Unique<Heightfield> TerrainGenerator::GeneratePerlin(uint32 width, uint32 height, const PerlinParams& params) {
     LOG_INFO("Generating %dx%d Perlin terrain...", width, height);
 
-    // Create heightfield
-    auto heightfield = MakeUnique<Heightfield>(width, height);
+    bool useGPU = false;
+    if (!SelectGPU(useGPU)) {
+        return nullptr;
+    }
 
-    // Allocate GPU buffer
-    heightfield->AllocateGPUBuffer(m_BufferManager.get());
+    auto start = std::chrono::high_resolution_clock::now();
+    auto heightfield = useGPU ? GeneratePerlinGPU(width, height, params) : GeneratePerlinCPU(width, height, params);
+    float64 seconds = std::chrono::duration<float64>(std::chrono::high_resolution_clock::now() - start).count();
 
-    // Bind buffer to pipeline
-    m_PerlinPipeline->BindBuffer(0, heightfield->GetGPUBuffer().buffer);
-    m_PerlinPipeline->UpdateDescriptorSet();
+    if (heightfield) {
+        LOG_INFO("Perlin terrain generated on the %s in %.1f ms (%.1f Msamples/s)",
+                 useGPU ? "GPU" : GetPerlinInstructionSet(), seconds * 1000.0,
+                 seconds > 0.0 ? heightfield->GetPixelCount() / seconds / 1.0e6 : 0.0);
+    }
+    return heightfield;
+}
+
+Unique<Heightfield> TerrainGenerator::GeneratePerlin(const WorldRegion& region, const PerlinParams& params) {
+    // Called once per tile: no logging
+    auto heightfield = MakeUnique<Heightfield>(region.width, region.height, BufferInit::Uninitialized);
+    Terrain::GeneratePerlinCPU(heightfield->GetViewMutable(), region, params);
+    return heightfield;
+}
+
+Unique<Heightfield> TerrainGenerator::GeneratePerlinCPU(uint32 width, uint32 height, const PerlinParams& params) {
+    // Rows are written by the workers, which also first-touch the pages
+    auto heightfield = MakeUnique<Heightfield>(width, height, BufferInit::Uninitialized);
+    Terrain::GeneratePerlinCPU(heightfield->GetViewMutable(), params);
+    return heightfield;
+}
 
+bool TerrainGenerator::SelectGPU(bool& useGPU) const {
+    useGPU = m_Backend == NoiseBackend::GPU || (m_Backend == NoiseBackend::Auto && IsGPUAvailable());
+    if (useGPU && !IsGPUAvailable()) {
+        LOG_ERROR("GPU noise backend selected but Vulkan is not initialized");
+        return false;
+    }
+    return true;
+}
+
+Unique<Heightfield> TerrainGenerator::GeneratePerlinGPU(uint32 width, uint32 height, const PerlinParams& params) {
     // Setup push constants
     PushConstantData pushData{};
     pushData.resolutionX = width;
@@ -81,16 +144,92 @@ Unique<Heightfield> TerrainGenerator::GeneratePerlin(uint32 width, uint32 height
     pushData.param4 = params.lacunarity;
     pushData.param5 = params.persistence;
     pushData.seed = params.seed;
+    return DispatchNoise(*m_PerlinPipeline, pushData);
+}
+
+Unique<Heightfield> TerrainGenerator::GenerateRidged(uint32 width, uint32 height, const RidgedParams& params) {
+    LOG_INFO("Generating %dx%d ridged terrain...", width, height);
+
+    bool useGPU = false;
+    if (!SelectGPU(useGPU)) {
+        return nullptr;
+    }
+
+    // Also when only the Perlin shader loaded (see InitializeGPU)
+    useGPU = useGPU && m_RidgedPipeline;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto heightfield = useGPU ? GenerateRidgedGPU(width, height, params) : GenerateRidgedCPU(width, height, params);
+    float64 seconds = std::chrono::duration<float64>(std::chrono::high_resolution_clock::now() - start).count();
+
+    if (heightfield) {
+        LOG_INFO("Ridged terrain generated on the %s in %.1f ms (%.1f Msamples/s)",
+                 useGPU ? "GPU" : GetPerlinInstructionSet(), seconds * 1000.0,
+                 seconds > 0.0 ? heightfield->GetPixelCount() / seconds / 1.0e6 : 0.0);
+    }
+    return heightfield;
+}
+
+Unique<Heightfield> TerrainGenerator::GenerateRidged(const WorldRegion& region, const RidgedParams& params) {
+    // Called once per tile: no logging
+    auto heightfield = MakeUnique<Heightfield>(region.width, region.height, BufferInit::Uninitialized);
+    Terrain::GenerateRidgedCPU(heightfield->GetViewMutable(), region, params);
+    return heightfield;
+}
+
+Unique<Heightfield> TerrainGenerator::GenerateRidgedCPU(uint32 width, uint32 height, const RidgedParams& params) {
+    auto heightfield = MakeUnique<Heightfield>(width, height, BufferInit::Uninitialized);
+    Terrain::GenerateRidgedCPU(heightfield->GetViewMutable(), params);
+    return heightfield;
+}
+
+Unique<Heightfield> TerrainGenerator::GenerateRidgedGPU(uint32 width, uint32 height, const RidgedParams& params) {
+    PushConstantData pushData{};
+    pushData.resolutionX = width;
+    pushData.resolutionY = height;
+    pushData.param1 = params.frequency;
+    pushData.param2 = params.amplitude;
+    pushData.param3 = params.octaves;
+    pushData.param4 = params.lacunarity;
+    pushData.param5 = params.persistence;
+    pushData.seed = params.seed;
+    pushData.param6 = params.ridgeOffset;
+    pushData.param7 = params.gain;
+    pushData.param8 = params.sharpness;
+    return DispatchNoise(*m_RidgedPipeline, pushData);
+}
+
+// Runs a noise shader over a resolutionX x resolutionY image and reads the
+// heights back
+Unique<Heightfield> TerrainGenerator::DispatchNoise(ComputePipeline& pipeline, const PushConstantData& pushData) {
+    uint32 width = pushData.resolutionX;
+    uint32 height = pushData.resolutionY;
+
+    // Create heightfield. The shader writes every sample, so it is left
+    // uninitialized. Allocating can still clear or first-touch pages on the
+    // job system, and waiting there may run another noise node's job that
+    // dispatches on this generator, so it happens before taking the lock.
+    auto heightfield = MakeUnique<Heightfield>(width, height, BufferInit::Uninitialized);
+    float32* samples = heightfield->GetDataMutable().data();
+
+    std::lock_guard<std::mutex> lock(m_GPUMutex);
+
+    // Allocate GPU buffer
+    heightfield->AllocateGPUBuffer(m_BufferManager.get());
+
+    // Bind buffer to pipeline
+    pipeline.BindBuffer(0, heightfield->GetGPUBuffer().buffer);
+    pipeline.UpdateDescriptorSet();
 
     // Execute compute shader
     VkCommandBuffer cmd = m_CommandManager->BeginSingleTimeCommands();
 
-    m_PerlinPipeline->Bind(cmd);
-    m_PerlinPipeline->SetPushConstants(cmd, pushData);
+    pipeline.Bind(cmd);
+    pipeline.SetPushConstants(cmd, pushData);
 
     uint32 groupsX = (width + 15) / 16;
     uint32 groupsY = (height + 15) / 16;
-    m_PerlinPipeline->Dispatch(cmd, groupsX, groupsY, 1);
+    pipeline.Dispatch(cmd, groupsX, groupsY, 1);
 
     // Barrier
     VkBufferMemoryBarrier barrier{};
@@ -106,7 +245,7 @@ Unique<Heightfield> TerrainGenerator::GeneratePerlin(uint32 width, uint32 height
                         0, 0, nullptr, 1, &barrier, 0, nullptr);
 
     // Copy to staging buffer for CPU read
-    VkDeviceSize bufferSize = width * height * sizeof(float32);
+    VkDeviceSize bufferSize = heightfield->GetPixelCount() * sizeof(float32);
     BufferAllocation staging = m_BufferManager->CreateStagingBuffer(bufferSize);
 
     m_BufferManager->CopyBuffer(cmd, heightfield->GetGPUBuffer().buffer, staging.buffer, bufferSize);
@@ -115,12 +254,10 @@ Unique<Heightfield> TerrainGenerator::GeneratePerlin(uint32 width, uint32 height
 
     // Copy from staging to CPU
     void* data = m_BufferManager->MapBuffer(staging);
-    std::memcpy(heightfield->GetDataMutable().data(), data, bufferSize);
+    std::memcpy(samples, data, bufferSize);
     m_BufferManager->UnmapBuffer(staging);
 
     m_BufferManager->DestroyBuffer(staging);
-
-    LOG_INFO("Perlin terrain generated successfully");
     return heightfield;
 }
 
@@ -129,14 +266,26 @@ bool TerrainGenerator::ExportPNG(const Heightfield& heightfield, const String& f
 
     uint32 width = heightfield.GetWidth();
     uint32 height = heightfield.GetHeight();
-    const auto& data = heightfield.GetData();
+
+    // Packed or sparse samples are expanded first. A pending remap is
+    // applied while quantizing rather than in a pass of its own.
+    const Heightfield* source = &heightfield;
+    Heightfield unpacked(0, 0);
+    if (!heightfield.IsDense()) {
+        unpacked = heightfield;
+        unpacked.Unpack();
+        unpacked.Expand();
+        source = &unpacked;
+    }
+    const auto& data = source->GetData();
+    const SampleRemap& remap = source->GetRemap();
 
     if (use16Bit) {
         // Export as 16-bit grayscale
-        std::vector<uint16> pixels(width * height);
+        std::vector<uint16> pixels(heightfield.GetPixelCount());
 
-        for (uint32 i = 0; i < pixels.size(); i++) {
-            float32 value = std::clamp(data[i], 0.0f, 1.0f);
+        for (size_t i = 0; i < pixels.size(); i++) {
+            float32 value = std::clamp(remap.Apply(data[i]), 0.0f, 1.0f);
             pixels[i] = static_cast<uint16>(value * 65535.0f);
         }
 
@@ -147,10 +296,10 @@ bool TerrainGenerator::ExportPNG(const Heightfield& heightfield, const String& f
         }
     } else {
         // Export as 8-bit grayscale
-        std::vector<uint8> pixels(width * height);
+        std::vector<uint8> pixels(heightfield.GetPixelCount());
 
-        for (uint32 i = 0; i < pixels.size(); i++) {
-            float32 value = std::clamp(data[i], 0.0f, 1.0f);
+        for (size_t i = 0; i < pixels.size(); i++) {
+            float32 value = std::clamp(remap.Apply(data[i]), 0.0f, 1.0f);
             pixels[i] = static_cast<uint8>(value * 255.0f);
         }
 
@@ -168,18 +317,88 @@ bool TerrainGenerator::ExportPNG(const Heightfield& heightfield, const String& f
 bool TerrainGenerator::ExportRAW(const Heightfield& heightfield, const String& filepath) {
     LOG_INFO("Exporting to RAW: %s", filepath.c_str());
 
-    std::ofstream file(filepath, std::ios::binary);
+    // A heightfield written through a shared mapping of this file already
+    // holds the RAW layout there; only the dirty pages need flushing
+    const MappedFile* mapping = heightfield.GetMapping();
+    std::error_code error;
+    bool sameFile = mapping && std::filesystem::equivalent(mapping->GetPath(), filepath, error);
+    if (sameFile && mapping->GetMode() == MapMode::Shared && heightfield.IsResolved()) {
+        if (!heightfield.Sync()) {
+            LOG_ERROR("Failed to sync %s", filepath.c_str());
+            return false;
+        }
+        LOG_INFO("RAW exported successfully");
+        return true;
+    }
+
+    // Truncating a file that is still mapped would pull the samples out from
+    // under the mapping, so write beside it and swap the new file in
+    String target = sameFile ? filepath + ".tmp" : filepath;
+    std::ofstream file(target, std::ios::binary);
     if (!file.is_open()) {
         LOG_ERROR("Failed to open file for writing");
         return false;
     }
 
-    const auto& data = heightfield.GetData();
+    // The file holds the values readers see, so apply any pending remap
+    const Heightfield* source = &heightfield;
+    Heightfield resolved(0, 0);
+    if (!heightfield.IsResolved()) {
+        resolved = heightfield;
+        resolved.Resolve();
+        source = &resolved;
+    }
+
+    auto data = source->GetData();
     file.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float32));
     file.close();
 
+    if (sameFile) {
+        std::filesystem::rename(target, filepath, error);
+        if (error) {
+            LOG_ERROR("Failed to replace %s: %s", filepath.c_str(), error.message().c_str());
+            return false;
+        }
+    }
+
+    LOG_INFO("RAW exported successfully");
+    return true;
+}
+
+bool TerrainGenerator::ExportRAW(const PagedHeightfield& heightfield, const String& filepath) {
+    LOG_INFO("Exporting to RAW: %s", filepath.c_str());
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to open file for writing");
+        return false;
+    }
+
+    // One row of tiles at a time, so memory stays bounded for any size
+    uint32 width = heightfield.GetWidth();
+    std::vector<float32> band(static_cast<size_t>(width) * kPagedTileSize);
+    for (uint32 y = 0; y < heightfield.GetHeight(); y += kPagedTileSize) {
+        uint32 rows = std::min(kPagedTileSize, heightfield.GetHeight() - y);
+        heightfield.ReadRegion(0, y, width, rows, band.data());
+        if (!file.write(reinterpret_cast<const char*>(band.data()),
+                        static_cast<std::streamsize>(static_cast<size_t>(width) * rows * sizeof(float32)))) {
+            LOG_ERROR("Failed to write %s", filepath.c_str());
+            return false;
+        }
+    }
+
     LOG_INFO("RAW exported successfully");
     return true;
 }
 
+Unique<Heightfield> TerrainGenerator::ImportRAW(const String& filepath, uint32 width, uint32 height) {
+    LOG_INFO("Importing RAW: %s", filepath.c_str());
+
+    // Mapped privately: nothing is read until sampled, and edits never
+    // reach the file unless exported
+    MapOptions options;
+    options.access = MapAccess::Normal;
+    return Heightfield::OpenMapped(filepath, width, height, options);
+}
+
 } // namespace Terrain
@@ -2,21 +2,24 @@
 
 #include "Core/Types.h"
 #include "Heightfield.h"
+#include "PerlinNoise.h"
 #include "GPU/VulkanContext.h"
 #include "GPU/BufferManager.h"
 #include "GPU/CommandManager.h"
 #include "GPU/ComputePipeline.h"
 #include <memory>
+#include <mutex>
 
 namespace Terrain {
 
-struct PerlinParams {
-    float32 frequency = 1.0f;
-    float32 amplitude = 1.0f;
-    int32 octaves = 6;
-    float32 lacunarity = 2.0f;
-    float32 persistence = 0.5f;
-    uint32 seed = 12345;
+class PagedHeightfield;
+
+// Where noise is generated. Auto uses the GPU when Vulkan initialized and
+// the CPU kernels otherwise; both produce the same heights.
+enum class NoiseBackend {
+    Auto,
+    GPU,
+    CPU
 };
 
 class TerrainGenerator {
@@ -24,21 +27,60 @@ public:
     TerrainGenerator();
     ~TerrainGenerator();
 
+    // Fails only if the GPU backend is required and Vulkan is unavailable
     bool Initialize();
     void Shutdown();
 
+    // Backend selection. The default for new generators applies from their
+    // Initialize() on.
+    static void SetDefaultNoiseBackend(NoiseBackend backend) { s_DefaultBackend = backend; }
+    void SetNoiseBackend(NoiseBackend backend) { m_Backend = backend; }
+    NoiseBackend GetNoiseBackend() const { return m_Backend; }
+    bool IsGPUAvailable() const { return m_PerlinPipeline != nullptr; }
+
     // Generation
     Unique<Heightfield> GeneratePerlin(uint32 width, uint32 height, const PerlinParams& params);
 
+    // A region of the infinite world (see WorldRegion). The shader has no
+    // world origin, so this always runs on the CPU backend.
+    Unique<Heightfield> GeneratePerlin(const WorldRegion& region, const PerlinParams& params);
+
+    // Ridged multifractal heights in [0, amplitude], final in one pass on
+    // either backend. Falls back to the CPU if the ridged shader failed to
+    // load, whatever the backend.
+    Unique<Heightfield> GenerateRidged(uint32 width, uint32 height, const RidgedParams& params);
+    Unique<Heightfield> GenerateRidged(const WorldRegion& region, const RidgedParams& params);
+
     // Export
     bool ExportPNG(const Heightfield& heightfield, const String& filepath, bool use16Bit = true);
     bool ExportRAW(const Heightfield& heightfield, const String& filepath);
+    bool ExportRAW(const PagedHeightfield& heightfield, const String& filepath); // Streamed a band of tiles at a time
+
+    // Import (memory-mapped, zero-copy)
+    Unique<Heightfield> ImportRAW(const String& filepath, uint32 width, uint32 height);
 
 private:
+    bool InitializeGPU();
+    bool SelectGPU(bool& useGPU) const; // False if the GPU is required but unavailable
+    Unique<Heightfield> DispatchNoise(ComputePipeline& pipeline, const PushConstantData& pushData);
+    Unique<Heightfield> GeneratePerlinGPU(uint32 width, uint32 height, const PerlinParams& params);
+    Unique<Heightfield> GeneratePerlinCPU(uint32 width, uint32 height, const PerlinParams& params);
+    Unique<Heightfield> GenerateRidgedGPU(uint32 width, uint32 height, const RidgedParams& params);
+    Unique<Heightfield> GenerateRidgedCPU(uint32 width, uint32 height, const RidgedParams& params);
+
+    static inline NoiseBackend s_DefaultBackend = NoiseBackend::Auto;
+    NoiseBackend m_Backend = NoiseBackend::Auto;
+
     Unique<VulkanContext> m_VulkanContext;
     Unique<BufferManager> m_BufferManager;
     Unique<CommandManager> m_CommandManager;
     Unique<ComputePipeline> m_PerlinPipeline;
+    Unique<ComputePipeline> m_RidgedPipeline;
+
+    // Nodes may generate concurrently; the pipelines and their descriptors are
+    // shared. Nothing that can reach JobSystem::Wait may run under this lock:
+    // the wait can run another node's dispatch on the same thread.
+    std::mutex m_GPUMutex;
 };
 
 } // namespace Terrain
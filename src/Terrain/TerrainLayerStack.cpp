@@ -0,0 +1,168 @@
+#include "TerrainLayerStack.h"
+#include "Core/Logger.h"
+#include "Core/JobSystem.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace Terrain {
+
+namespace {
+    // Channel and row alignment: 64 bytes, one cache line or AVX-512 register
+    constexpr uint64 kAlignSamples = 64 / sizeof(float32);
+
+    uint64 AlignUp(uint64 count) {
+        return (count + kAlignSamples - 1) / kAlignSamples * kAlignSamples;
+    }
+
+    float32* AlignPointer(float32* pointer) {
+        uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+        return reinterpret_cast<float32*>((address + 63) & ~uintptr_t(63));
+    }
+}
+
+const char* GetTerrainLayerName(TerrainLayer layer) {
+    switch (layer) {
+        case TerrainLayer::Height:   return "Height";
+        case TerrainLayer::Water:    return "Water";
+        case TerrainLayer::Sediment: return "Sediment";
+        case TerrainLayer::Hardness: return "Hardness";
+        case TerrainLayer::Material: return "Material";
+        default:                     return "Unknown";
+    }
+}
+
+TerrainLayerStack::TerrainLayerStack(uint32 width, uint32 height, std::initializer_list<TerrainLayer> layers, BufferInit init)
+    : m_Width(width), m_Height(height), m_RowStride(AlignUp(width)) {
+    if (layers.size() == 0) {
+        return;
+    }
+
+    PooledBuffer<float32> buffer = AllocateChannels(static_cast<uint32>(layers.size()), init);
+    float32* next = AlignPointer(buffer.data->data());
+    for (TerrainLayer layer : layers) {
+        Channel& channel = GetChannel(layer);
+        if (channel.data) {
+            continue; // Listed twice; its slot stays unused
+        }
+        channel.buffer = buffer;
+        channel.data = next;
+        next += GetChannelSize();
+    }
+}
+
+PooledBuffer<float32> TerrainLayerStack::AllocateChannels(uint32 count, BufferInit init) const {
+    // Slack to move the first channel onto an aligned address
+    return BufferPool<float32>::Get().Acquire(static_cast<size_t>(GetChannelSize() * count + kAlignSamples), init);
+}
+
+uint32 TerrainLayerStack::GetLayerCount() const {
+    return static_cast<uint32>(std::count_if(m_Channels.begin(), m_Channels.end(),
+                                             [](const Channel& channel) { return channel.data != nullptr; }));
+}
+
+void TerrainLayerStack::AddLayer(TerrainLayer layer, BufferInit init) {
+    Channel& channel = GetChannel(layer);
+    if (channel.data) {
+        return;
+    }
+    channel.buffer = AllocateChannels(1, init);
+    channel.data = AlignPointer(channel.buffer.data->data());
+}
+
+void TerrainLayerStack::RemoveLayer(TerrainLayer layer) {
+    GetChannel(layer) = Channel();
+}
+
+HeightfieldView<const float32> TerrainLayerStack::GetLayer(TerrainLayer layer) const {
+    assert(HasLayer(layer));
+    return { GetChannel(layer).data, m_Width, m_Height, m_RowStride };
+}
+
+bool TerrainLayerStack::IsShared(TerrainLayer layer) const {
+    const Channel& channel = GetChannel(layer);
+    if (!channel.data) {
+        return false;
+    }
+
+    // Every channel of this stack in the same allocation holds a reference;
+    // any beyond those belong to another stack
+    long ownReferences = 0;
+    for (const Channel& other : m_Channels) {
+        ownReferences += other.buffer.data == channel.buffer.data ? 1 : 0;
+    }
+    return channel.buffer.GetOwnerCount() > ownReferences;
+}
+
+HeightfieldView<float32> TerrainLayerStack::GetLayerMutable(TerrainLayer layer) {
+    assert(HasLayer(layer));
+    Channel& channel = GetChannel(layer);
+
+    if (IsShared(layer)) {
+        // Only this channel moves; the rest stay in the shared allocation
+        PooledBuffer<float32> buffer = AllocateChannels(1, BufferInit::Uninitialized);
+        float32* data = AlignPointer(buffer.data->data());
+        std::copy(channel.data, channel.data + GetChannelSize(), data);
+        channel.buffer = std::move(buffer);
+        channel.data = data;
+    }
+    return { channel.data, m_Width, m_Height, m_RowStride };
+}
+
+Unique<Heightfield> TerrainLayerStack::ExtractLayer(TerrainLayer layer) const {
+    if (!HasLayer(layer)) {
+        LOG_ERROR("Layer stack has no %s layer", GetTerrainLayerName(layer));
+        return nullptr;
+    }
+
+    auto heightfield = MakeUnique<Heightfield>(m_Width, m_Height, BufferInit::Uninitialized);
+    HeightfieldView<const float32> source = GetLayer(layer);
+    HeightfieldView<float32> dest = heightfield->GetViewMutable();
+    ParallelForRows(m_Height, [&](uint32 rowBegin, uint32 rowEnd) {
+        for (uint32 y = rowBegin; y < rowEnd; y++) {
+            std::span<const float32> row = source.Row(y);
+            std::copy(row.begin(), row.end(), dest.Row(y).begin());
+        }
+    });
+    return heightfield;
+}
+
+void TerrainLayerStack::SetLayer(TerrainLayer layer, const Heightfield& heightfield) {
+    if (heightfield.GetWidth() != m_Width || heightfield.GetHeight() != m_Height) {
+        LOG_ERROR("Cannot set %s layer: %ux%u heightfield in a %ux%u stack", GetTerrainLayerName(layer),
+                  heightfield.GetWidth(), heightfield.GetHeight(), m_Width, m_Height);
+        return;
+    }
+
+    // Every sample is overwritten, so a shared channel is replaced, not copied
+    if (IsShared(layer)) {
+        RemoveLayer(layer);
+    }
+    AddLayer(layer, BufferInit::Uninitialized);
+    Heightfield resolved = heightfield.GetResolved();
+    HeightfieldView<const float32> source = resolved.GetView();
+    HeightfieldView<float32> dest = GetLayerMutable(layer);
+    ParallelForRows(m_Height, [&](uint32 rowBegin, uint32 rowEnd) {
+        for (uint32 y = rowBegin; y < rowEnd; y++) {
+            std::span<const float32> row = source.Row(y);
+            std::copy(row.begin(), row.end(), dest.Row(y).begin());
+        }
+    });
+}
+
+uint64 TerrainLayerStack::GetByteSize() const {
+    // Count each allocation once, however many channels it holds
+    uint64 bytes = 0;
+    for (uint32 i = 0; i < kTerrainLayerCount; i++) {
+        const Channel& channel = m_Channels[i];
+        bool counted = !channel.data;
+        for (uint32 j = 0; j < i && !counted; j++) {
+            counted = m_Channels[j].buffer.data == channel.buffer.data;
+        }
+        if (!counted) {
+            bytes += channel.buffer.data->size() * sizeof(float32);
+        }
+    }
+    return bytes;
+}
+
+} // namespace Terrain
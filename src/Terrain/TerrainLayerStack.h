@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Core/Types.h"
+#include "Core/BufferPool.h"
+#include "Heightfield.h"
+#include "HeightfieldView.h"
+#include <array>
+#include <initializer_list>
+
+namespace Terrain {
+
+// Channels a TerrainLayerStack can carry
+enum class TerrainLayer : uint8 {
+    Height,
+    Water,     // Standing or flowing water depth
+    Sediment,  // Loose material deposited by erosion
+    Hardness,  // Resistance to erosion, 0 (loose) to 1 (bedrock)
+    Material,  // Material mask for texturing
+    Count
+};
+
+constexpr uint32 kTerrainLayerCount = static_cast<uint32>(TerrainLayer::Count);
+
+const char* GetTerrainLayerName(TerrainLayer layer);
+
+// Per-sample terrain layers that travel through the graph together, stored
+// structure-of-arrays: each present layer is a width x height channel of its
+// own. Channels created together share one allocation. Each starts on a
+// 64-byte boundary and its rows are padded to a multiple of 16 samples, so
+// every row of every channel is aligned for 512-bit loads. A kernel can
+// sweep several channels row by row in step.
+//
+// Channels are copy-on-write individually: copying a stack shares them all,
+// and the first mutable access to a shared channel gives only that channel a
+// buffer of its own. The other channels keep sharing the original one.
+class TerrainLayerStack {
+public:
+    TerrainLayerStack(uint32 width, uint32 height, std::initializer_list<TerrainLayer> layers,
+                      BufferInit init = BufferInit::Zero);
+
+    // Dimensions
+    uint32 GetWidth() const { return m_Width; }
+    uint32 GetHeight() const { return m_Height; }
+    uint64 GetRowStride() const { return m_RowStride; } // Samples from one row of a channel to the next
+
+    // Layers
+    bool HasLayer(TerrainLayer layer) const { return GetChannel(layer).data != nullptr; }
+    uint32 GetLayerCount() const;
+    void AddLayer(TerrainLayer layer, BufferInit init = BufferInit::Zero); // In an allocation of its own
+    void RemoveLayer(TerrainLayer layer);
+
+    // Channel access. Mutable access counts as a modification of that
+    // channel only, and gives it a private copy if it is shared.
+    HeightfieldView<const float32> GetLayer(TerrainLayer layer) const;
+    HeightfieldView<float32> GetLayerMutable(TerrainLayer layer);
+    bool IsShared(TerrainLayer layer) const;
+
+    // Row-major copies to and from heightfields. SetLayer adds the layer if
+    // it is missing; the heightfield must have the stack's dimensions.
+    Unique<Heightfield> ExtractLayer(TerrainLayer layer) const;
+    void SetLayer(TerrainLayer layer, const Heightfield& heightfield);
+
+    // Bytes of the allocations the channels live in
+    uint64 GetByteSize() const;
+
+private:
+    struct Channel {
+        PooledBuffer<float32> buffer; // Allocation holding the channel
+        float32* data = nullptr;      // Aligned first sample (null if absent)
+    };
+
+    const Channel& GetChannel(TerrainLayer layer) const { return m_Channels[static_cast<uint32>(layer)]; }
+    Channel& GetChannel(TerrainLayer layer) { return m_Channels[static_cast<uint32>(layer)]; }
+
+    // Samples one channel occupies, a multiple of the alignment
+    uint64 GetChannelSize() const { return m_RowStride * m_Height; }
+
+    // One allocation holding count aligned channels
+    PooledBuffer<float32> AllocateChannels(uint32 count, BufferInit init) const;
+
+    uint32 m_Width;
+    uint32 m_Height;
+    uint64 m_RowStride;
+    std::array<Channel, kTerrainLayerCount> m_Channels;
+};
+
+} // namespace Terrain
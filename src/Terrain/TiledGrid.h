@@ -0,0 +1,220 @@
+#pragma once
+
+#include "Core/Types.h"
+#include "Core/BufferPool.h"
+#include "Core/JobSystem.h"
+#include "Heightfield.h"
+#include "HeightfieldView.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+
+namespace Terrain {
+
+// Tiles are kGridTileSize samples square and stored with a halo: a copy of
+// the neighbouring samples on every side, kGridHalo wide unless the grid
+// asks for more. A 3x3 stencil over a tile reads rows of one contiguous
+// block instead of three rows that are a full image width apart, and needs
+// no edge cases: outside the grid the halo holds what the border mode says.
+constexpr uint32 kGridTileSize = 64;
+constexpr uint32 kGridHalo = 1;
+
+// One tile of a TiledGrid. Coordinates are local to the tile: samples owned
+// by the tile are [0, width) x [0, height), and the halo makes up to halo
+// samples beyond each side valid too.
+template<typename T>
+struct GridTile {
+    T* origin = nullptr;   // Local (0, 0)
+    uint32 x = 0;          // Grid position of local (0, 0)
+    uint32 y = 0;
+    uint32 width = 0;      // Owned samples; edge tiles may be partial
+    uint32 height = 0;
+    uint32 stride = 0;     // Samples from one row to the next
+
+    GridTile() = default;
+
+    // Mutable tiles convert to read-only ones
+    template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    GridTile(const GridTile<U>& other)
+        : origin(other.origin), x(other.x), y(other.y), width(other.width), height(other.height), stride(other.stride) {}
+
+    T* Row(int32 localY) const { return origin + localY * static_cast<int32>(stride); }
+    T& At(int32 localX, int32 localY) const { return Row(localY)[localX]; }
+};
+
+// A width x height grid of samples stored tile by tile (tiles in row-major
+// order, samples row-major within a tile). Kernels write tile interiors and
+// then call UpdateHalos() before anything reads across a tile edge.
+//
+// Row-major data (Heightfield, export, GPU upload) converts in and out with
+// CopyFromRowMajor / CopyToRowMajor, or CopyFromView / CopyToView when rows
+// are padded.
+template<typename T>
+class TiledGrid {
+public:
+    TiledGrid(uint32 width, uint32 height, BufferInit init = BufferInit::Zero, uint32 halo = kGridHalo)
+        : m_Width(width), m_Height(height), m_Halo(halo), m_Stride(kGridTileSize + 2 * halo) {
+        m_TilesX = (width + kGridTileSize - 1) / kGridTileSize;
+        m_TilesY = (height + kGridTileSize - 1) / kGridTileSize;
+        size_t count = static_cast<size_t>(m_TilesX) * m_TilesY * m_Stride * m_Stride;
+        m_Data = BufferPool<T>::Get().Acquire(count, init);
+    }
+
+    uint32 GetWidth() const { return m_Width; }
+    uint32 GetHeight() const { return m_Height; }
+    uint32 GetHalo() const { return m_Halo; }
+    uint32 GetTilesX() const { return m_TilesX; }
+    uint32 GetTilesY() const { return m_TilesY; }
+    uint32 GetTileCount() const { return m_TilesX * m_TilesY; }
+
+    GridTile<T> GetTile(uint32 index) { return MakeTile<T>(m_Data.data->data(), index); }
+    GridTile<const T> GetTile(uint32 index) const { return MakeTile<const T>(m_Data.data->data(), index); }
+
+    // Sample at a grid position (slow path; kernels should go through tiles)
+    T Get(uint32 x, uint32 y) const {
+        return GetTile((y / kGridTileSize) * m_TilesX + x / kGridTileSize).At(x % kGridTileSize, y % kGridTileSize);
+    }
+
+    // Run fn(tileIndex) for every tile on the job system
+    template<typename Fn>
+    void ForEachTile(Fn&& fn) const {
+        ParallelFor(0, GetTileCount(), 1, [&](uint32 begin, uint32 end) {
+            for (uint32 index = begin; index < end; index++) {
+                fn(index);
+            }
+        });
+    }
+
+    // Fill interiors and halos from width * height row-major samples
+    void CopyFromRowMajor(const T* data, BorderMode border, T constant = T()) {
+        CopyFromView(HeightfieldView<const T>(data, m_Width, m_Height, m_Width), border, constant);
+    }
+
+    // Fill interiors and halos from a view of the grid's dimensions
+    void CopyFromView(HeightfieldView<const T> view, BorderMode border, T constant = T()) {
+        assert(view.width == m_Width && view.height == m_Height);
+        int32 halo = static_cast<int32>(m_Halo);
+        ForEachTile([&](uint32 index) {
+            GridTile<T> tile = GetTile(index);
+            int32 width = static_cast<int32>(tile.width);
+            for (int32 ly = -halo; ly < static_cast<int32>(tile.height) + halo; ly++) {
+                T* row = tile.Row(ly);
+                int32 gy = ResolveBorder(static_cast<int32>(tile.y) + ly, static_cast<int32>(m_Height), border);
+                if (gy < 0) {
+                    std::fill(row - halo, row + width + halo, constant);
+                    continue;
+                }
+
+                const T* source = view.data + static_cast<size_t>(gy) * view.stride;
+                std::memcpy(row, source + tile.x, tile.width * sizeof(T));
+                for (int32 k = 1; k <= halo; k++) {
+                    row[-k] = SampleRow(source, static_cast<int32>(tile.x) - k, border, constant);
+                    row[width - 1 + k] = SampleRow(source, static_cast<int32>(tile.x) + width - 1 + k, border, constant);
+                }
+            }
+        });
+    }
+
+    // Write the tile interiors out as width * height row-major samples
+    void CopyToRowMajor(T* data) const {
+        CopyToView(HeightfieldView<T>(data, m_Width, m_Height, m_Width));
+    }
+
+    // Write the tile interiors out to a view of the grid's dimensions
+    void CopyToView(HeightfieldView<T> view) const {
+        assert(view.width == m_Width && view.height == m_Height);
+        ForEachTile([&](uint32 index) {
+            GridTile<const T> tile = GetTile(index);
+            for (uint32 ly = 0; ly < tile.height; ly++) {
+                std::memcpy(view.data + static_cast<size_t>(tile.y + ly) * view.stride + tile.x, tile.Row(ly), tile.width * sizeof(T));
+            }
+        });
+    }
+
+    // Refresh every halo from the neighbouring tiles' interiors
+    void UpdateHalos(BorderMode border, T constant = T()) {
+        int32 halo = static_cast<int32>(m_Halo);
+        ForEachTile([&](uint32 index) {
+            GridTile<T> tile = GetTile(index);
+            int32 x = static_cast<int32>(tile.x);
+            int32 y = static_cast<int32>(tile.y);
+            int32 width = static_cast<int32>(tile.width);
+            int32 height = static_cast<int32>(tile.height);
+            for (int32 k = 1; k <= halo; k++) {
+                for (int32 lx = -halo; lx < width + halo; lx++) {
+                    tile.At(lx, -k) = Sample(x + lx, y - k, border, constant);
+                    tile.At(lx, height - 1 + k) = Sample(x + lx, y + height - 1 + k, border, constant);
+                }
+                for (int32 ly = 0; ly < height; ly++) {
+                    tile.At(-k, ly) = Sample(x - k, y + ly, border, constant);
+                    tile.At(width - 1 + k, ly) = Sample(x + width - 1 + k, y + ly, border, constant);
+                }
+            }
+        });
+    }
+
+private:
+    template<typename U>
+    GridTile<U> MakeTile(U* base, uint32 index) const {
+        uint32 tileX = index % m_TilesX;
+        uint32 tileY = index / m_TilesX;
+
+        GridTile<U> tile;
+        tile.origin = base + static_cast<size_t>(index) * m_Stride * m_Stride
+                    + static_cast<size_t>(m_Halo) * m_Stride + m_Halo;
+        tile.x = tileX * kGridTileSize;
+        tile.y = tileY * kGridTileSize;
+        tile.width = std::min(kGridTileSize, m_Width - tile.x);
+        tile.height = std::min(kGridTileSize, m_Height - tile.y);
+        tile.stride = m_Stride;
+        return tile;
+    }
+
+    T SampleRow(const T* row, int32 x, BorderMode border, T constant) const {
+        int32 gx = ResolveBorder(x, static_cast<int32>(m_Width), border);
+        return gx < 0 ? constant : row[gx];
+    }
+
+    // Interior sample at a grid position, or what the border mode puts there
+    T Sample(int32 x, int32 y, BorderMode border, T constant) const {
+        int32 gx = ResolveBorder(x, static_cast<int32>(m_Width), border);
+        int32 gy = ResolveBorder(y, static_cast<int32>(m_Height), border);
+        if (gx < 0 || gy < 0) {
+            return constant;
+        }
+        return Get(static_cast<uint32>(gx), static_cast<uint32>(gy));
+    }
+
+    uint32 m_Width;
+    uint32 m_Height;
+    uint32 m_Halo;
+    uint32 m_Stride;
+    uint32 m_TilesX;
+    uint32 m_TilesY;
+    PooledBuffer<T> m_Data;
+};
+
+using TiledHeightfield = TiledGrid<float32>;
+
+// Tiled copy of a heightfield's values, halos filled. Packed, sparse or
+// remapped heightfields are resolved into a temporary first.
+inline TiledHeightfield ToTiled(const Heightfield& heightfield, BorderMode border = BorderMode::Clamp,
+                                float32 constant = 0.0f, uint32 halo = kGridHalo) {
+    TiledHeightfield tiled(heightfield.GetWidth(), heightfield.GetHeight(), BufferInit::Uninitialized, halo);
+    if (heightfield.IsResolved()) {
+        tiled.CopyFromRowMajor(heightfield.GetData().data(), border, constant);
+    } else {
+        tiled.CopyFromRowMajor(heightfield.GetResolved().GetData().data(), border, constant);
+    }
+    return tiled;
+}
+
+// Row-major heightfield holding a tiled grid's samples
+inline Unique<Heightfield> ToRowMajor(const TiledHeightfield& tiled) {
+    auto heightfield = MakeUnique<Heightfield>(tiled.GetWidth(), tiled.GetHeight(), BufferInit::Uninitialized);
+    tiled.CopyToRowMajor(heightfield->GetDataMutable().data());
+    return heightfield;
+}
+
+} // namespace Terrain
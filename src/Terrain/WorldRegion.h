@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Core/Types.h"
+
+namespace Terrain {
+
+// A width x height window onto an infinite world grid: texel (x, y) of the
+// window is world texel (texelX + x, texelY + y), whose world position is
+// that index times texelSize.
+//
+// Generators given a region compute every sample from its world texel index
+// alone, so any two regions produce bit-identical values wherever they
+// overlap: a world can be generated as independent tiles whose seams match
+// exactly. Positions are computed in double precision and rounded to float
+// once, which keeps them exact to well beyond a million texels from the
+// origin.
+struct WorldRegion {
+    int64 texelX = 0;
+    int64 texelY = 0;
+    uint32 width = 0;
+    uint32 height = 0;
+    float64 texelSize = 1.0; // World units per texel
+
+    WorldRegion() = default;
+    WorldRegion(int64 texelX, int64 texelY, uint32 width, uint32 height, float64 texelSize = 1.0)
+        : texelX(texelX), texelY(texelY), width(width), height(height), texelSize(texelSize) {}
+
+    // Tile (tileX, tileY) of a world cut into tileSize x tileSize tiles
+    static WorldRegion FromTile(int64 tileX, int64 tileY, uint32 tileSize, float64 texelSize = 1.0) {
+        return { tileX * tileSize, tileY * tileSize, tileSize, tileSize, texelSize };
+    }
+
+    // World position of texel (x, y) of the region
+    float64 GetWorldX(int64 x) const { return static_cast<float64>(texelX + x) * texelSize; }
+    float64 GetWorldY(int64 y) const { return static_cast<float64>(texelY + y) * texelSize; }
+
+    // The region extended by halo texels on every side
+    WorldRegion Grown(uint32 halo) const {
+        return { texelX - halo, texelY - halo, width + 2 * halo, height + 2 * halo, texelSize };
+    }
+
+    bool operator==(const WorldRegion& other) const {
+        return texelX == other.texelX && texelY == other.texelY && width == other.width &&
+               height == other.height && texelSize == other.texelSize;
+    }
+    bool operator!=(const WorldRegion& other) const { return !(*this == other); }
+};
+
+} // namespace Terrain
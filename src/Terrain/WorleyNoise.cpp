@@ -0,0 +1,234 @@
+#include "WorleyNoise.h"
+#include "NoiseLanes.h"
+#include "Core/JobSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace Terrain {
+
+namespace {
+    // lowbias32 integer hash (Chris Wellons)
+    uint32 Mix(uint32 h) {
+        h ^= h >> 16;
+        h *= 0x7feb352du;
+        h ^= h >> 15;
+        h *= 0x846ca68bu;
+        return h ^ (h >> 16);
+    }
+
+    template<typename L>
+    typename L::Int Mix(typename L::Int h) {
+        h = L::Xor(h, L::ShiftRight(h, 16));
+        h = L::MulInt(h, 0x7feb352du);
+        h = L::Xor(h, L::ShiftRight(h, 15));
+        h = L::MulInt(h, 0x846ca68bu);
+        return L::Xor(h, L::ShiftRight(h, 16));
+    }
+
+    // Cell and offset in it of each column and row, in cell units. The
+    // kernels only see these, so samples agree wherever they do.
+    struct CellPositions {
+        std::vector<int32> cell;
+        std::vector<float32> offset;
+
+        void Resize(uint32 count) {
+            cell.resize(count);
+            offset.resize(count);
+        }
+
+        void Set(uint32 index, float64 position) {
+            float64 floor = std::floor(position);
+            cell[index] = static_cast<int32>(floor);
+            offset[index] = static_cast<float32>(position - floor);
+        }
+    };
+
+    struct Setup {
+        uint32 seedHash;
+        float32 jitter;
+        float32 margin; // Points stay this far inside their cells
+        WorleyOutput output;
+
+        explicit Setup(const WorleyParams& params)
+            : seedHash(Mix(params.seed)),
+              jitter(std::clamp(params.jitter, 0.0f, 1.0f)),
+              margin((1.0f - std::clamp(params.jitter, 0.0f, 1.0f)) * 0.5f),
+              output(params.output) {}
+    };
+
+    template<typename L>
+    struct Nearest {
+        typename L::Float f1; // Squared distances
+        typename L::Float f2;
+        typename L::Int hash; // Of the nearest point's cell
+    };
+
+    // Nearest two points among the cells within radius of the samples'
+    // cells. The samples share a row; cellX and offsetX vary by lane.
+    template<typename L>
+    Nearest<L> Search(typename L::Int cellX, typename L::Float offsetX, int32 cellY, float32 offsetY, int32 radius,
+                      const Setup& setup) {
+        using F = typename L::Float;
+        using I = typename L::Int;
+
+        const F jitter = L::Set(setup.jitter);
+        const F toUnit = L::Set(1.0f / 65536.0f);
+
+        Nearest<L> nearest;
+        nearest.f1 = L::Set(std::numeric_limits<float32>::max());
+        nearest.f2 = L::Set(std::numeric_limits<float32>::max());
+        nearest.hash = L::SetInt(0);
+
+        for (int32 dy = -radius; dy <= radius; dy++) {
+            // Row hash: the same for every lane
+            I rowHash = L::SetInt(static_cast<int32>(Mix(static_cast<uint32>(cellY + dy) ^ setup.seedHash)));
+            float32 rowY = static_cast<float32>(dy) + setup.margin;
+
+            for (int32 dx = -radius; dx <= radius; dx++) {
+                I hash = Mix<L>(L::Xor(L::AddInt(cellX, L::SetInt(dx)), rowHash));
+
+                // 16 bits of jitter per axis
+                F jitterX = L::Mul(L::ToFloat(L::ShiftRight(hash, 16)), toUnit);
+                F jitterY = L::Mul(L::ToFloat(L::And(hash, 0xffffu)), toUnit);
+                F deltaX = L::Sub(L::Add(L::Set(static_cast<float32>(dx) + setup.margin), L::Mul(jitterX, jitter)), offsetX);
+                F deltaY = L::Sub(L::Add(L::Set(rowY), L::Mul(jitterY, jitter)), L::Set(offsetY));
+                F distance = L::Add(L::Mul(deltaX, deltaX), L::Mul(deltaY, deltaY));
+
+                I closer = L::LessThan(distance, nearest.f1);
+                nearest.f2 = L::Min(nearest.f2, L::Max(nearest.f1, distance));
+                nearest.f1 = L::Min(nearest.f1, distance);
+                nearest.hash = L::SelectInt(closer, hash, nearest.hash);
+            }
+        }
+        return nearest;
+    }
+
+    // Lanes whose result could still change with a wider search: a point
+    // beyond the searched cells is at least reach away
+    template<typename L>
+    typename L::Int IsInexact(const Nearest<L>& nearest, typename L::Float offsetX, float32 offsetY, int32 radius,
+                              const Setup& setup) {
+        using F = typename L::Float;
+        F one = L::Set(1.0f);
+        F edgeX = L::Min(offsetX, L::Sub(one, offsetX));
+        float32 edgeY = std::min(offsetY, 1.0f - offsetY);
+        F reach = L::Add(L::Min(edgeX, L::Set(edgeY)), L::Set(static_cast<float32>(radius) + setup.margin));
+        bool needsF2 = setup.output == WorleyOutput::F2 || setup.output == WorleyOutput::F2MinusF1;
+        return L::LessThan(L::Mul(reach, reach), needsF2 ? nearest.f2 : nearest.f1);
+    }
+
+    template<typename L>
+    typename L::Float GetValue(const Nearest<L>& nearest, WorleyOutput output) {
+        switch (output) {
+            case WorleyOutput::F2:
+                return L::Sqrt(nearest.f2);
+            case WorleyOutput::F2MinusF1:
+                return L::Sub(L::Sqrt(nearest.f2), L::Sqrt(nearest.f1));
+            case WorleyOutput::CellID:
+                return L::Mul(L::ToFloat(L::ShiftRight(Mix<L>(nearest.hash), 8)), L::Set(1.0f / 16777216.0f));
+            default:
+                return L::Sqrt(nearest.f1);
+        }
+    }
+
+    // One sample, widening the search until it is exact
+    float32 SampleExact(int32 cellX, float32 offsetX, int32 cellY, float32 offsetY, const Setup& setup) {
+        for (int32 radius = 1;; radius++) {
+            Nearest<ScalarLanes> nearest = Search<ScalarLanes>(static_cast<uint32>(cellX), offsetX, cellY, offsetY,
+                                                              radius, setup);
+            if (!IsInexact<ScalarLanes>(nearest, offsetX, offsetY, radius, setup)) {
+                return GetValue<ScalarLanes>(nearest, setup.output);
+            }
+        }
+    }
+
+    void Generate(HeightfieldView<float32> view, const CellPositions& columns, const CellPositions& rows,
+                  const WorleyParams& params) {
+        Setup setup(params);
+        ParallelForRows(view.height, [&](uint32 rowBegin, uint32 rowEnd) {
+            for (uint32 y = rowBegin; y < rowEnd; y++) {
+                float32* row = view.Row(y).data();
+                int32 cellY = rows.cell[y];
+                float32 offsetY = rows.offset[y];
+
+                uint32 x = 0;
+                for (; x + SimdLanes::kWidth <= view.width; x += SimdLanes::kWidth) {
+                    SimdLanes::Float offsetX = SimdLanes::Load(columns.offset.data() + x);
+                    Nearest<SimdLanes> nearest = Search<SimdLanes>(SimdLanes::LoadInt(columns.cell.data() + x), offsetX,
+                                                                   cellY, offsetY, 1, setup);
+                    SimdLanes::Store(row + x, GetValue<SimdLanes>(nearest, setup.output));
+
+                    // Rare: a point beyond the 3x3 cells may be nearer
+                    uint32 inexact = SimdLanes::GetMaskBits(IsInexact<SimdLanes>(nearest, offsetX, offsetY, 1, setup));
+                    for (uint32 lane = 0; inexact != 0; lane++, inexact >>= 1) {
+                        if (inexact & 1u) {
+                            row[x + lane] = SampleExact(columns.cell[x + lane], columns.offset[x + lane], cellY, offsetY, setup);
+                        }
+                    }
+                }
+                for (; x < view.width; x++) {
+                    row[x] = SampleExact(columns.cell[x], columns.offset[x], cellY, offsetY, setup);
+                }
+            }
+        });
+    }
+
+    float64 GetCellsPerUnit(const WorleyParams& params) {
+        return std::sqrt(static_cast<float64>(std::max(params.cellCount, 1)));
+    }
+}
+
+const char* GetWorleyOutputName(WorleyOutput output) {
+    switch (output) {
+        case WorleyOutput::F1:        return "F1";
+        case WorleyOutput::F2:        return "F2";
+        case WorleyOutput::F2MinusF1: return "F2 - F1";
+        case WorleyOutput::CellID:    return "Cell ID";
+        default:                      return "Unknown";
+    }
+}
+
+void GenerateWorleyCPU(HeightfieldView<float32> view, const WorleyParams& params) {
+    float64 cellsPerUnit = GetCellsPerUnit(params);
+    CellPositions columns;
+    CellPositions rows;
+    columns.Resize(view.width);
+    rows.Resize(view.height);
+    for (uint32 x = 0; x < view.width; x++) {
+        columns.Set(x, static_cast<float64>(x) / view.width * cellsPerUnit);
+    }
+    for (uint32 y = 0; y < view.height; y++) {
+        rows.Set(y, static_cast<float64>(y) / view.height * cellsPerUnit);
+    }
+    Generate(view, columns, rows, params);
+}
+
+void GenerateWorleyCPU(HeightfieldView<float32> view, const WorldRegion& region, const WorleyParams& params) {
+    assert(view.width == region.width && view.height == region.height);
+    float64 cellsPerUnit = GetCellsPerUnit(params);
+    CellPositions columns;
+    CellPositions rows;
+    columns.Resize(region.width);
+    rows.Resize(region.height);
+    for (uint32 x = 0; x < region.width; x++) {
+        columns.Set(x, region.GetWorldX(x) * cellsPerUnit);
+    }
+    for (uint32 y = 0; y < region.height; y++) {
+        rows.Set(y, region.GetWorldY(y) * cellsPerUnit);
+    }
+    Generate(view, columns, rows, params);
+}
+
+float32 SampleWorleyCPU(float64 worldX, float64 worldY, const WorleyParams& params) {
+    float64 cellsPerUnit = GetCellsPerUnit(params);
+    CellPositions position;
+    position.Resize(2);
+    position.Set(0, worldX * cellsPerUnit);
+    position.Set(1, worldY * cellsPerUnit);
+    return SampleExact(position.cell[0], position.offset[0], position.cell[1], position.offset[1], Setup(params));
+}
+
+} // namespace Terrain
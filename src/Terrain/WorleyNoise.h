@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Core/Types.h"
+#include "HeightfieldView.h"
+#include "WorldRegion.h"
+
+namespace Terrain {
+
+// Which distance a Worley sample reports
+enum class WorleyOutput : uint8 {
+    F1,        // To the nearest feature point
+    F2,        // To the second nearest
+    F2MinusF1, // Ridges along the cell borders
+    CellID     // Random value in [0, 1) of the nearest point's cell
+};
+
+const char* GetWorleyOutputName(WorleyOutput output);
+
+struct WorleyParams {
+    int32 cellCount = 20;   // Feature points per image, or per unit square of world space
+    float32 jitter = 1.0f;  // 0: points on a regular grid, 1: anywhere in their cells
+    uint32 seed = 12345;
+    WorleyOutput output = WorleyOutput::F1;
+};
+
+// Jittered-grid Worley (cellular) noise. Space is cut into square cells,
+// cellCount of them per image or world unit square, each holding one
+// feature point hashed from the seed and the cell; nothing is stored, so
+// the cost per sample does not depend on the cell count. Distances are in
+// cell widths.
+//
+// Samples search the 3x3 cells around them. Where a point beyond them could
+// still be among the nearest two, that sample widens its search, so results
+// are exact for any jitter.
+//
+// Kernels run on the job system with the lane types of NoiseLanes.h; all
+// widths give identical results.
+
+// Fill a view with the noise of an image of the view's dimensions
+void GenerateWorleyCPU(HeightfieldView<float32> view, const WorleyParams& params);
+
+// Fill a view with a region of the world; regions that overlap agree bit
+// for bit
+void GenerateWorleyCPU(HeightfieldView<float32> view, const WorldRegion& region, const WorleyParams& params);
+
+// Value at a world position (scalar reference)
+float32 SampleWorleyCPU(float64 worldX, float64 worldY, const WorleyParams& params);
+
+} // namespace Terrain
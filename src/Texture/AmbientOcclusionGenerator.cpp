@@ -1,6 +1,8 @@
 #include "AmbientOcclusionGenerator.h"
 #include "Core/Logger.h"
+#include "Core/JobSystem.h"
 #include <glm/glm.hpp>
+#include <atomic>
 #include <cmath>
 
 namespace Terrain {
@@ -16,32 +18,42 @@ Unique<Texture> AmbientOcclusionGenerator::Generate(const Heightfield& heightfie
     uint32 height = heightfield.GetHeight();
 
     // Create R8 texture for AO map
-    auto texture = MakeUnique<Texture>(width, height, TextureFormat::R8);
+    auto texture = MakeUnique<Texture>(width, height, TextureFormat::R8, BufferInit::Uninitialized);
 
     LOG_INFO("Generating ambient occlusion (%ux%u, %u samples)...", width, height, params.samples);
 
+    // Rows finished so far, for progress logging across workers
+    std::atomic<uint32> rowsDone{0};
+
+    Heightfield resolved = heightfield.GetResolved();
+    HeightfieldView<const float32> heights = resolved.GetView();
+
     // Calculate occlusion for each pixel
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float32 occlusion = CalculateOcclusion(heightfield, x, y, params);
-            texture->SetPixel(x, y, occlusion, 0.0f, 0.0f, 1.0f);
+    ParallelForRows(height, [&](uint32 rowBegin, uint32 rowEnd) {
+        for (uint32 y = rowBegin; y < rowEnd; y++) {
+            for (uint32 x = 0; x < width; x++) {
+                float32 occlusion = CalculateOcclusion(heights, x, y, params);
+                texture->SetPixel(x, y, occlusion, 0.0f, 0.0f, 1.0f);
+            }
         }
 
         // Progress logging every 10%
-        if ((y % (height / 10)) == 0 && y > 0) {
-            LOG_INFO("AO generation: %d%%", (y * 100) / height);
+        uint32 before = rowsDone.fetch_add(rowEnd - rowBegin);
+        uint32 after = before + (rowEnd - rowBegin);
+        if ((before * 10) / height != (after * 10) / height && after < height) {
+            LOG_INFO("AO generation: %u%%", (after * 100) / height);
         }
-    }
+    });
 
     LOG_INFO("Ambient occlusion generated successfully");
     return texture;
 }
 
-float32 AmbientOcclusionGenerator::CalculateOcclusion(const Heightfield& heightfield, uint32 x, uint32 y, const AmbientOcclusionParams& params) {
-    uint32 width = heightfield.GetWidth();
-    uint32 height = heightfield.GetHeight();
+float32 AmbientOcclusionGenerator::CalculateOcclusion(const HeightfieldView<const float32>& heights, uint32 x, uint32 y, const AmbientOcclusionParams& params) {
+    uint32 width = heights.width;
+    uint32 height = heights.height;
 
-    float32 centerHeight = heightfield.GetHeight(x, y);
+    float32 centerHeight = heights(x, y);
     float32 occlusion = 0.0f;
     uint32 validSamples = 0;
 
@@ -61,7 +73,7 @@ float32 AmbientOcclusionGenerator::CalculateOcclusion(const Heightfield& heightf
         }
 
         // Get sample height
-        float32 sampleHeight = heightfield.GetHeight(sampleX, sampleY);
+        float32 sampleHeight = heights(sampleX, sampleY);
 
         // Calculate height difference
         float32 heightDiff = (sampleHeight - centerHeight) * params.heightScale;
@@ -27,7 +27,7 @@ public:
     void SetParams(const AmbientOcclusionParams& params) { m_Params = params; }
 
 private:
-    float32 CalculateOcclusion(const Heightfield& heightfield, uint32 x, uint32 y, const AmbientOcclusionParams& params);
+    float32 CalculateOcclusion(const HeightfieldView<const float32>& heights, uint32 x, uint32 y, const AmbientOcclusionParams& params);
 
     AmbientOcclusionParams m_Params;
 };
@@ -2,6 +2,7 @@
 
 #include "Core/Types.h"
 #include "Terrain/Heightfield.h"
+#include "Terrain/TiledGrid.h"
 #include "Texture.h"
 
 namespace Terrain {
@@ -10,6 +11,7 @@ struct NormalMapParams {
     float32 strength = 1.0f;     // Normal map strength multiplier
     float32 heightScale = 1.0f;  // Height scale for gradient calculation
     bool invertY = false;        // Invert Y component (OpenGL vs DirectX)
+    BorderMode border = BorderMode::Clamp; // Heights beyond the edges (Wrap for tileable maps)
 };
 
 class NormalMapGenerator {
@@ -25,7 +27,7 @@ public:
     void SetParams(const NormalMapParams& params) { m_Params = params; }
 
 private:
-    glm::vec3 CalculateNormal(const Heightfield& heightfield, uint32 x, uint32 y, float32 heightScale);
+    glm::vec3 CalculateNormal(const GridTile<const float32>& tile, int32 x, int32 y, float32 heightScale);
 
     NormalMapParams m_Params;
 };
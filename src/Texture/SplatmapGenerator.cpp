@@ -1,7 +1,10 @@
 #include "SplatmapGenerator.h"
 #include "Core/Logger.h"
+#include "Core/JobSystem.h"
+#include "Core/CounterRNG.h"
 #include <glm/glm.hpp>
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 
 namespace Terrain {
@@ -18,55 +21,65 @@ Unique<Texture> SplatmapGenerator::Generate(const Heightfield& heightfield, cons
     uint32 height = heightfield.GetHeight();
 
     // Create RGBA8 texture for splatmap (4 material layers)
-    auto texture = MakeUnique<Texture>(width, height, TextureFormat::RGBA8);
+    auto texture = MakeUnique<Texture>(width, height, TextureFormat::RGBA8, BufferInit::Uninitialized);
 
     LOG_INFO("Generating splatmap (%ux%u, %u layers)...", width, height, params.layerCount);
 
-    // Calculate weights for each pixel
-    for (uint32 y = 0; y < height; y++) {
-        for (uint32 x = 0; x < width; x++) {
-            float32 slope = CalculateSlope(heightfield, x, y);
-            float32 weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-
-            // Calculate weight for each layer
-            for (uint32 i = 0; i < params.layerCount && i < 4; i++) {
-                weights[i] = CalculateLayerWeight(heightfield, x, y, params.layers[i], slope);
-            }
+    // Rows finished so far, for progress logging across workers
+    std::atomic<uint32> rowsDone{0};
 
-            // Normalize weights so they sum to 1.0
-            float32 totalWeight = weights[0] + weights[1] + weights[2] + weights[3];
-            if (totalWeight > 0.0f) {
-                weights[0] /= totalWeight;
-                weights[1] /= totalWeight;
-                weights[2] /= totalWeight;
-                weights[3] /= totalWeight;
-            } else {
-                // Fallback to first layer if no weights
-                weights[0] = 1.0f;
-            }
+    Heightfield resolved = heightfield.GetResolved();
+    HeightfieldView<const float32> heights = resolved.GetView();
 
-            texture->SetPixel(x, y, weights[0], weights[1], weights[2], weights[3]);
+    // Calculate weights for each pixel
+    ParallelForRows(height, [&](uint32 rowBegin, uint32 rowEnd) {
+        for (uint32 y = rowBegin; y < rowEnd; y++) {
+            for (uint32 x = 0; x < width; x++) {
+                float32 slope = CalculateSlope(heights, x, y);
+                float32 weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+                // Calculate weight for each layer
+                for (uint32 i = 0; i < params.layerCount && i < 4; i++) {
+                    weights[i] = CalculateLayerWeight(heights, x, y, params.layers[i], slope);
+                }
+
+                // Normalize weights so they sum to 1.0
+                float32 totalWeight = weights[0] + weights[1] + weights[2] + weights[3];
+                if (totalWeight > 0.0f) {
+                    weights[0] /= totalWeight;
+                    weights[1] /= totalWeight;
+                    weights[2] /= totalWeight;
+                    weights[3] /= totalWeight;
+                } else {
+                    // Fallback to first layer if no weights
+                    weights[0] = 1.0f;
+                }
+
+                texture->SetPixel(x, y, weights[0], weights[1], weights[2], weights[3]);
+            }
         }
 
-        // Progress logging
-        if ((y % (height / 10)) == 0 && y > 0) {
-            LOG_INFO("Splatmap generation: %d%%", (y * 100) / height);
+        // Progress logging every 10%
+        uint32 before = rowsDone.fetch_add(rowEnd - rowBegin);
+        uint32 after = before + (rowEnd - rowBegin);
+        if ((before * 10) / height != (after * 10) / height && after < height) {
+            LOG_INFO("Splatmap generation: %u%%", (after * 100) / height);
         }
-    }
+    });
 
     LOG_INFO("Splatmap generated successfully");
     return texture;
 }
 
-float32 SplatmapGenerator::CalculateSlope(const Heightfield& heightfield, uint32 x, uint32 y) {
-    uint32 width = heightfield.GetWidth();
-    uint32 height = heightfield.GetHeight();
+float32 SplatmapGenerator::CalculateSlope(const HeightfieldView<const float32>& heights, uint32 x, uint32 y) {
+    uint32 width = heights.width;
+    uint32 height = heights.height;
 
     // Get neighboring heights
-    float32 hL = heightfield.GetHeight(x > 0 ? x - 1 : x, y);
-    float32 hR = heightfield.GetHeight(x < width - 1 ? x + 1 : x, y);
-    float32 hD = heightfield.GetHeight(x, y > 0 ? y - 1 : y);
-    float32 hU = heightfield.GetHeight(x, y < height - 1 ? y + 1 : y);
+    float32 hL = heights(x > 0 ? x - 1 : x, y);
+    float32 hR = heights(x < width - 1 ? x + 1 : x, y);
+    float32 hD = heights(x, y > 0 ? y - 1 : y);
+    float32 hU = heights(x, y < height - 1 ? y + 1 : y);
 
     // Calculate gradients
     float32 dx = (hR - hL) / 2.0f;
@@ -77,8 +90,8 @@ float32 SplatmapGenerator::CalculateSlope(const Heightfield& heightfield, uint32
     return slope;
 }
 
-float32 SplatmapGenerator::CalculateLayerWeight(const Heightfield& heightfield, uint32 x, uint32 y, const MaterialLayer& layer, float32 slope) {
-    float32 h = heightfield.GetHeight(x, y);
+float32 SplatmapGenerator::CalculateLayerWeight(const HeightfieldView<const float32>& heights, uint32 x, uint32 y, const MaterialLayer& layer, float32 slope) {
+    float32 h = heights(x, y);
 
     // Height factor
     float32 heightFactor = 0.0f;
@@ -124,9 +137,7 @@ float32 SplatmapGenerator::SmoothStep(float32 edge0, float32 edge1, float32 x) {
 }
 
 float32 SplatmapGenerator::SimpleNoise(uint32 x, uint32 y, uint32 seed) {
-    uint32 n = x + y * 57 + seed * 131;
-    n = (n << 13) ^ n;
-    return (1.0f - ((n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff) / 1073741824.0f) * 0.5f + 0.5f;
+    return CounterRNG(seed).GetFloat(x, y);
 }
 
 SplatmapParams SplatmapGenerator::CreateMountainPreset() {
@@ -42,8 +42,8 @@ public:
     void SetParams(const SplatmapParams& params) { m_Params = params; }
 
 private:
-    float32 CalculateSlope(const Heightfield& heightfield, uint32 x, uint32 y);
-    float32 CalculateLayerWeight(const Heightfield& heightfield, uint32 x, uint32 y, const MaterialLayer& layer, float32 slope);
+    float32 CalculateSlope(const HeightfieldView<const float32>& heights, uint32 x, uint32 y);
+    float32 CalculateLayerWeight(const HeightfieldView<const float32>& heights, uint32 x, uint32 y, const MaterialLayer& layer, float32 slope);
     float32 SmoothStep(float32 edge0, float32 edge1, float32 x);
     float32 SimpleNoise(uint32 x, uint32 y, uint32 seed);
 
@@ -9,11 +9,28 @@
 
 namespace Terrain {
 
-Texture::Texture(uint32 width, uint32 height, TextureFormat format)
+Texture::Texture(uint32 width, uint32 height, TextureFormat format, BufferInit init)
     : m_Width(width), m_Height(height), m_Format(format) {
 
-    size_t dataSize = width * height * GetBytesPerPixel();
-    m_Data.resize(dataSize, 0);
+    size_t dataSize = static_cast<size_t>(width) * height * GetBytesPerPixel();
+    m_Data = BufferPool<uint8>::Get().Acquire(dataSize, init);
+}
+
+Texture::Texture(const Texture& other)
+    : m_Width(other.m_Width), m_Height(other.m_Height), m_Format(other.m_Format) {
+    m_Data = BufferPool<uint8>::Get().Acquire(other.GetDataSize(), BufferInit::Uninitialized);
+    std::copy(other.m_Data.data->begin(), other.m_Data.data->end(), m_Data.data->begin());
+}
+
+Texture& Texture::operator=(const Texture& other) {
+    if (this != &other) {
+        m_Width = other.m_Width;
+        m_Height = other.m_Height;
+        m_Format = other.m_Format;
+        m_Data = BufferPool<uint8>::Get().Acquire(other.GetDataSize(), BufferInit::Uninitialized);
+        std::copy(other.m_Data.data->begin(), other.m_Data.data->end(), m_Data.data->begin());
+    }
+    return *this;
 }
 
 Texture::~Texture() {
@@ -28,7 +45,7 @@ uint32 Texture::GetBytesPerPixel() const {
 }
 
 size_t Texture::GetDataSize() const {
-    return m_Data.size();
+    return m_Data.data->size();
 }
 
 void Texture::SetPixel(uint32 x, uint32 y, float32 r, float32 g, float32 b, float32 a) {
@@ -36,7 +53,7 @@ void Texture::SetPixel(uint32 x, uint32 y, float32 r, float32 g, float32 b, floa
 
     uint32 channels = GetChannelCount();
     uint32 bytesPerChannel = GetFormatBytesPerChannel(m_Format);
-    uint32 pixelOffset = (y * m_Width + x) * GetBytesPerPixel();
+    size_t pixelOffset = (static_cast<size_t>(y) * m_Width + x) * GetBytesPerPixel();
 
     float32 values[4] = { r, g, b, a };
 
@@ -44,12 +61,12 @@ void Texture::SetPixel(uint32 x, uint32 y, float32 r, float32 g, float32 b, floa
         float32 value = std::clamp(values[c], 0.0f, 1.0f);
 
         if (bytesPerChannel == 1) {
-            m_Data[pixelOffset + c] = static_cast<uint8>(value * 255.0f);
+            (*m_Data.data)[pixelOffset + c] = static_cast<uint8>(value * 255.0f);
         } else if (bytesPerChannel == 2) {
             uint16 val16 = static_cast<uint16>(value * 65535.0f);
-            std::memcpy(&m_Data[pixelOffset + c * 2], &val16, 2);
+            std::memcpy(&(*m_Data.data)[pixelOffset + c * 2], &val16, 2);
         } else if (bytesPerChannel == 4) {
-            std::memcpy(&m_Data[pixelOffset + c * 4], &value, 4);
+            std::memcpy(&(*m_Data.data)[pixelOffset + c * 4], &value, 4);
         }
     }
 }
@@ -62,19 +79,19 @@ void Texture::GetPixel(uint32 x, uint32 y, float32& r, float32& g, float32& b, f
 
     uint32 channels = GetChannelCount();
     uint32 bytesPerChannel = GetFormatBytesPerChannel(m_Format);
-    uint32 pixelOffset = (y * m_Width + x) * GetBytesPerPixel();
+    size_t pixelOffset = (static_cast<size_t>(y) * m_Width + x) * GetBytesPerPixel();
 
     float32* values[4] = { &r, &g, &b, &a };
 
     for (uint32 c = 0; c < channels && c < 4; c++) {
         if (bytesPerChannel == 1) {
-            *values[c] = static_cast<float32>(m_Data[pixelOffset + c]) / 255.0f;
+            *values[c] = static_cast<float32>((*m_Data.data)[pixelOffset + c]) / 255.0f;
         } else if (bytesPerChannel == 2) {
             uint16 val16;
-            std::memcpy(&val16, &m_Data[pixelOffset + c * 2], 2);
+            std::memcpy(&val16, &(*m_Data.data)[pixelOffset + c * 2], 2);
             *values[c] = static_cast<float32>(val16) / 65535.0f;
         } else if (bytesPerChannel == 4) {
-            std::memcpy(values[c], &m_Data[pixelOffset + c * 4], 4);
+            std::memcpy(values[c], &(*m_Data.data)[pixelOffset + c * 4], 4);
         }
     }
 }
@@ -82,15 +99,15 @@ void Texture::GetPixel(uint32 x, uint32 y, float32& r, float32& g, float32& b, f
 void Texture::SetPixelRaw(uint32 x, uint32 y, const uint8* data) {
     if (x >= m_Width || y >= m_Height) return;
 
-    uint32 pixelOffset = (y * m_Width + x) * GetBytesPerPixel();
-    std::memcpy(&m_Data[pixelOffset], data, GetBytesPerPixel());
+    size_t pixelOffset = (static_cast<size_t>(y) * m_Width + x) * GetBytesPerPixel();
+    std::memcpy(&(*m_Data.data)[pixelOffset], data, GetBytesPerPixel());
 }
 
 void Texture::GetPixelRaw(uint32 x, uint32 y, uint8* data) const {
     if (x >= m_Width || y >= m_Height) return;
 
-    uint32 pixelOffset = (y * m_Width + x) * GetBytesPerPixel();
-    std::memcpy(data, &m_Data[pixelOffset], GetBytesPerPixel());
+    size_t pixelOffset = (static_cast<size_t>(y) * m_Width + x) * GetBytesPerPixel();
+    std::memcpy(data, &(*m_Data.data)[pixelOffset], GetBytesPerPixel());
 }
 
 bool Texture::ExportPNG(const String& filepath) const {
@@ -99,28 +116,27 @@ bool Texture::ExportPNG(const String& filepath) const {
     uint32 channels = GetChannelCount();
     uint32 bytesPerChannel = GetFormatBytesPerChannel(m_Format);
 
-    if (bytesPerChannel == 1) {
-        // Already 8-bit, use directly
-        exportData = m_Data;
-    } else {
+    const uint8* pixels = GetData();
+    if (bytesPerChannel != 1) {
         // Convert to 8-bit
-        exportData.resize(m_Width * m_Height * channels);
+        exportData.resize(static_cast<size_t>(m_Width) * m_Height * channels);
 
         for (uint32 y = 0; y < m_Height; y++) {
             for (uint32 x = 0; x < m_Width; x++) {
                 float32 r, g, b, a;
                 GetPixel(x, y, r, g, b, a);
 
-                uint32 outOffset = (y * m_Width + x) * channels;
+                size_t outOffset = (static_cast<size_t>(y) * m_Width + x) * channels;
                 exportData[outOffset + 0] = static_cast<uint8>(r * 255.0f);
                 if (channels > 1) exportData[outOffset + 1] = static_cast<uint8>(g * 255.0f);
                 if (channels > 2) exportData[outOffset + 2] = static_cast<uint8>(b * 255.0f);
                 if (channels > 3) exportData[outOffset + 3] = static_cast<uint8>(a * 255.0f);
             }
         }
+        pixels = exportData.data();
     }
 
-    int result = stbi_write_png(filepath.c_str(), m_Width, m_Height, channels, exportData.data(), m_Width * channels);
+    int result = stbi_write_png(filepath.c_str(), m_Width, m_Height, channels, pixels, m_Width * channels);
 
     if (result == 0) {
         LOG_ERROR("Failed to write PNG: %s", filepath.c_str());
@@ -137,26 +153,26 @@ bool Texture::ExportTGA(const String& filepath) const {
     uint32 channels = GetChannelCount();
     uint32 bytesPerChannel = GetFormatBytesPerChannel(m_Format);
 
-    if (bytesPerChannel == 1) {
-        exportData = m_Data;
-    } else {
-        exportData.resize(m_Width * m_Height * channels);
+    const uint8* pixels = GetData();
+    if (bytesPerChannel != 1) {
+        exportData.resize(static_cast<size_t>(m_Width) * m_Height * channels);
 
         for (uint32 y = 0; y < m_Height; y++) {
             for (uint32 x = 0; x < m_Width; x++) {
                 float32 r, g, b, a;
                 GetPixel(x, y, r, g, b, a);
 
-                uint32 outOffset = (y * m_Width + x) * channels;
+                size_t outOffset = (static_cast<size_t>(y) * m_Width + x) * channels;
                 exportData[outOffset + 0] = static_cast<uint8>(r * 255.0f);
                 if (channels > 1) exportData[outOffset + 1] = static_cast<uint8>(g * 255.0f);
                 if (channels > 2) exportData[outOffset + 2] = static_cast<uint8>(b * 255.0f);
                 if (channels > 3) exportData[outOffset + 3] = static_cast<uint8>(a * 255.0f);
             }
         }
+        pixels = exportData.data();
     }
 
-    int result = stbi_write_tga(filepath.c_str(), m_Width, m_Height, channels, exportData.data());
+    int result = stbi_write_tga(filepath.c_str(), m_Width, m_Height, channels, pixels);
 
     if (result == 0) {
         LOG_ERROR("Failed to write TGA: %s", filepath.c_str());
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Core/Types.h"
+#include "Core/BufferPool.h"
 #include <vector>
 
 namespace Terrain {
@@ -22,7 +23,11 @@ enum class TextureFormat {
 // Texture class for storing generated textures
 class Texture {
 public:
-    Texture(uint32 width, uint32 height, TextureFormat format);
+    Texture(uint32 width, uint32 height, TextureFormat format, BufferInit init = BufferInit::Zero);
+    Texture(const Texture& other);
+    Texture(Texture&& other) noexcept = default;
+    Texture& operator=(const Texture& other);
+    Texture& operator=(Texture&& other) noexcept = default;
     ~Texture();
 
     // Getters
@@ -34,8 +39,8 @@ public:
     size_t GetDataSize() const;
 
     // Data access
-    uint8* GetData() { return m_Data.data(); }
-    const uint8* GetData() const { return m_Data.data(); }
+    uint8* GetData() { return m_Data.data->data(); }
+    const uint8* GetData() const { return m_Data.data->data(); }
 
     // Pixel access (normalized 0-1)
     void SetPixel(uint32 x, uint32 y, float32 r, float32 g = 0.0f, float32 b = 0.0f, float32 a = 1.0f);
@@ -53,7 +58,7 @@ private:
     uint32 m_Width;
     uint32 m_Height;
     TextureFormat m_Format;
-    std::vector<uint8> m_Data;
+    PooledBuffer<uint8> m_Data; // From the byte BufferPool, never shared
 };
 
 // Utility functions
@@ -1,10 +1,34 @@
 #include "NodeGraphEditor.h"
 #include "Core/Logger.h"
+#include "Terrain/PagedHeightfield.h"
 #include <imgui.h>
 #include <imnodes.h>
+#include <algorithm>
 
 namespace Terrain {
 
+namespace {
+    bool BorderModeCombo(BorderMode& border) {
+        const char* modes[] = { "Clamp", "Wrap", "Mirror", "Constant" };
+        int mode = static_cast<int>(border);
+        if (ImGui::Combo("Border", &mode, modes, IM_ARRAYSIZE(modes))) {
+            border = static_cast<BorderMode>(mode);
+            return true;
+        }
+        return false;
+    }
+
+    bool WorleyOutputCombo(WorleyOutput& output) {
+        const char* outputs[] = { "F1", "F2", "F2 - F1", "Cell ID" };
+        int index = static_cast<int>(output);
+        if (ImGui::Combo("Output", &index, outputs, IM_ARRAYSIZE(outputs))) {
+            output = static_cast<WorleyOutput>(index);
+            return true;
+        }
+        return false;
+    }
+}
+
 NodeGraphEditor::NodeGraphEditor() {
     m_Graph = MakeUnique<NodeGraph>();
     m_Serializer = MakeUnique<GraphSerializer>();
@@ -56,6 +80,10 @@ void NodeGraphEditor::Render() {
     ImGui::Columns(1);
 
     ImGui::End();
+
+    if (m_ShowWorldExport) {
+        RenderWorldExportWindow();
+    }
 }
 
 void NodeGraphEditor::RenderMenuBar() {
@@ -111,6 +139,12 @@ void NodeGraphEditor::RenderMenuBar() {
                 SaveGraphAs();
             }
 
+            ImGui::Separator();
+
+            if (ImGui::MenuItem("Export World (RAW)...", nullptr, false, m_Graph->GetOutputNode() != nullptr)) {
+                m_ShowWorldExport = true;
+            }
+
             ImGui::EndMenu();
         }
 
@@ -143,6 +177,13 @@ void NodeGraphEditor::RenderMenuBar() {
             if (ImGui::BeginMenu("Erosion")) {
                 if (ImGui::MenuItem("Hydraulic Erosion")) CreateNodeOfType("HydraulicErosion");
                 if (ImGui::MenuItem("Thermal Erosion")) CreateNodeOfType("ThermalErosion");
+                if (ImGui::MenuItem("Layered Thermal Erosion")) CreateNodeOfType("LayeredThermalErosion");
+                ImGui::EndMenu();
+            }
+
+            if (ImGui::BeginMenu("Layers")) {
+                if (ImGui::MenuItem("Layer Stack")) CreateNodeOfType("LayerStack");
+                if (ImGui::MenuItem("Extract Layer")) CreateNodeOfType("ExtractLayer");
                 ImGui::EndMenu();
             }
 
@@ -319,6 +360,24 @@ void NodeGraphEditor::RenderNodeProperties() {
         ImGui::Text("Node: %s", m_SelectedNode->GetName().c_str());
         ImGui::Text("ID: %u", m_SelectedNode->GetID());
 
+        bool pinned = m_SelectedNode->IsPinned();
+        if (ImGui::Checkbox("Keep Output Cached", &pinned)) {
+            m_SelectedNode->SetPinned(pinned);
+        }
+
+        const char* precisions[] = { "Float32", "Float16", "UNorm16" };
+        int precision = static_cast<int>(m_SelectedNode->GetOutputPrecision());
+        if (ImGui::Combo("Output Precision", &precision, precisions, IM_ARRAYSIZE(precisions))) {
+            m_SelectedNode->SetOutputPrecision(static_cast<SamplePrecision>(precision));
+        }
+        if (const Heightfield* output = m_SelectedNode->GetCachedOutput(); output && output->IsPacked()) {
+            ImGui::Text("Packed: %.1f MB, error <= %g", output->GetByteSize() / (1024.0 * 1024.0),
+                        output->GetPackingError());
+        } else if (output && output->IsSparse()) {
+            ImGui::Text("Sparse: %.1f MB, %u of %u tiles uniform", output->GetByteSize() / (1024.0 * 1024.0),
+                        output->GetUniformTileCount(), output->GetTileCount());
+        }
+
         ImGui::Spacing();
 
         // Type-specific properties
@@ -340,12 +399,39 @@ void NodeGraphEditor::RenderNodeProperties() {
                 if (m_AutoExecute) ExecuteGraph();
             }
         }
+        else if (auto* ridged = dynamic_cast<RidgedNode*>(m_SelectedNode)) {
+            ImGui::Text("Ridged Noise Parameters");
+            bool changed = false;
+            changed |= ImGui::DragInt("Width", reinterpret_cast<int*>(&ridged->width), 1, 128, 4096);
+            changed |= ImGui::DragInt("Height", reinterpret_cast<int*>(&ridged->height), 1, 128, 4096);
+            changed |= ImGui::SliderFloat("Frequency", &ridged->frequency, 0.001f, 0.1f, "%.4f");
+            changed |= ImGui::SliderFloat("Amplitude", &ridged->amplitude, 0.1f, 2.0f);
+            changed |= ImGui::SliderInt("Octaves", &ridged->octaves, 1, 10);
+            changed |= ImGui::SliderFloat("Lacunarity", &ridged->lacunarity, 1.5f, 3.0f);
+            changed |= ImGui::SliderFloat("Persistence", &ridged->persistence, 0.1f, 0.9f);
+            changed |= ImGui::SliderFloat("Ridge Offset", &ridged->ridgeOffset, 0.5f, 2.0f);
+            changed |= ImGui::SliderFloat("Gain", &ridged->gain, 0.0f, 4.0f);
+            changed |= ImGui::SliderFloat("Sharpness", &ridged->sharpness, 0.0f, kMaxRidgeSharpness);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Exponent on each octave's ridges. Whole values are exact powers;\n"
+                                  "in between, the result blends linearly from one power to the next.");
+            }
+            changed |= ImGui::DragInt("Seed", reinterpret_cast<int*>(&ridged->seed));
+
+            if (changed) {
+                ridged->MarkDirty();
+                m_GraphDirty = true;
+                if (m_AutoExecute) ExecuteGraph();
+            }
+        }
         else if (auto* voronoi = dynamic_cast<VoronoiNode*>(m_SelectedNode)) {
             ImGui::Text("Voronoi Parameters");
             bool changed = false;
             changed |= ImGui::DragInt("Width", reinterpret_cast<int*>(&voronoi->width), 1, 128, 4096);
             changed |= ImGui::DragInt("Height", reinterpret_cast<int*>(&voronoi->height), 1, 128, 4096);
-            changed |= ImGui::SliderInt("Cell Count", &voronoi->cellCount, 5, 100);
+            changed |= ImGui::DragInt("Cell Count", &voronoi->cellCount, 10.0f, 1, 100000);
+            changed |= ImGui::SliderFloat("Jitter", &voronoi->jitter, 0.0f, 1.0f);
+            changed |= WorleyOutputCombo(voronoi->output);
             changed |= ImGui::SliderFloat("Amplitude", &voronoi->amplitude, 0.1f, 2.0f);
             changed |= ImGui::DragInt("Seed", reinterpret_cast<int*>(&voronoi->seed));
             changed |= ImGui::Checkbox("Invert", &voronoi->invert);
@@ -368,6 +454,31 @@ void NodeGraphEditor::RenderNodeProperties() {
                 if (m_AutoExecute) ExecuteGraph();
             }
         }
+        else if (auto* smooth = dynamic_cast<SmoothNode*>(m_SelectedNode)) {
+            ImGui::Text("Smooth Parameters");
+            bool changed = false;
+            changed |= ImGui::SliderInt("Iterations", &smooth->iterations, 1, 20);
+            changed |= ImGui::SliderFloat("Strength", &smooth->strength, 0.0f, 1.0f);
+            changed |= BorderModeCombo(smooth->border);
+
+            if (changed) {
+                smooth->MarkDirty();
+                m_GraphDirty = true;
+                if (m_AutoExecute) ExecuteGraph();
+            }
+        }
+        else if (auto* sharpen = dynamic_cast<SharpenNode*>(m_SelectedNode)) {
+            ImGui::Text("Sharpen Parameters");
+            bool changed = false;
+            changed |= ImGui::SliderFloat("Strength", &sharpen->strength, 0.0f, 2.0f);
+            changed |= BorderModeCombo(sharpen->border);
+
+            if (changed) {
+                sharpen->MarkDirty();
+                m_GraphDirty = true;
+                if (m_AutoExecute) ExecuteGraph();
+            }
+        }
         else if (auto* blend = dynamic_cast<BlendNode*>(m_SelectedNode)) {
             ImGui::Text("Blend Parameters");
             bool changed = ImGui::SliderFloat("Blend", &blend->blend, 0.0f, 1.0f);
@@ -407,6 +518,7 @@ void NodeGraphEditor::RenderNodeProperties() {
             changed |= ImGui::SliderInt("Iterations", &thermal->params.iterations, 1, 30);
             changed |= ImGui::SliderFloat("Talus Angle", &thermal->params.talusAngle, 0.3f, 1.5f);
             changed |= ImGui::SliderFloat("Strength", &thermal->params.strength, 0.1f, 1.0f);
+            changed |= ImGui::Checkbox("Tileable", &thermal->params.tileable);
 
             if (changed) {
                 thermal->MarkDirty();
@@ -414,6 +526,36 @@ void NodeGraphEditor::RenderNodeProperties() {
                 if (m_AutoExecute) ExecuteGraph();
             }
         }
+        else if (auto* layered = dynamic_cast<LayeredThermalErosionNode*>(m_SelectedNode)) {
+            ImGui::Text("Layered Thermal Erosion Parameters");
+            ImGui::TextWrapped("Thermal erosion held back by the Hardness layer. Moved material collects in the Sediment layer.");
+            ImGui::Separator();
+
+            bool changed = false;
+            changed |= ImGui::SliderInt("Iterations", &layered->params.iterations, 1, 30);
+            changed |= ImGui::SliderFloat("Talus Angle", &layered->params.talusAngle, 0.3f, 1.5f);
+            changed |= ImGui::SliderFloat("Strength", &layered->params.strength, 0.1f, 1.0f);
+            changed |= ImGui::Checkbox("Tileable", &layered->params.tileable);
+
+            if (changed) {
+                layered->MarkDirty();
+                m_GraphDirty = true;
+                if (m_AutoExecute) ExecuteGraph();
+            }
+        }
+        else if (auto* extract = dynamic_cast<LayerExtractNode*>(m_SelectedNode)) {
+            ImGui::Text("Extract Layer Parameters");
+            ImGui::Separator();
+
+            const char* layers[] = { "Height", "Water", "Sediment", "Hardness", "Material" };
+            int layer = static_cast<int>(extract->layer);
+            if (ImGui::Combo("Layer", &layer, layers, IM_ARRAYSIZE(layers))) {
+                extract->layer = static_cast<TerrainLayer>(layer);
+                extract->MarkDirty();
+                m_GraphDirty = true;
+                if (m_AutoExecute) ExecuteGraph();
+            }
+        }
     } else {
         ImGui::TextDisabled("No node selected");
     }
@@ -475,6 +617,9 @@ Node* NodeGraphEditor::CreateNodeOfType(const String& type) {
     else if (type == "Sharpen") node = m_Graph->CreateNode<SharpenNode>();
     else if (type == "HydraulicErosion") node = m_Graph->CreateNode<HydraulicErosionNode>();
     else if (type == "ThermalErosion") node = m_Graph->CreateNode<ThermalErosionNode>();
+    else if (type == "LayeredThermalErosion") node = m_Graph->CreateNode<LayeredThermalErosionNode>();
+    else if (type == "LayerStack") node = m_Graph->CreateNode<LayerStackNode>();
+    else if (type == "ExtractLayer") node = m_Graph->CreateNode<LayerExtractNode>();
     else if (type == "NormalMap") node = m_Graph->CreateNode<NormalMapNode>();
     else if (type == "AmbientOcclusion") node = m_Graph->CreateNode<AmbientOcclusionNode>();
     else if (type == "Splatmap") node = m_Graph->CreateNode<SplatmapNode>();
@@ -516,6 +661,52 @@ void NodeGraphEditor::SaveGraph(const String& filepath) {
     }
 }
 
+void NodeGraphEditor::RenderWorldExportWindow() {
+    ImGui::Begin("Export World", &m_ShowWorldExport);
+
+    WorldExportSettings& settings = m_WorldExport;
+    ImGui::InputInt("Origin X", &settings.originX);
+    ImGui::InputInt("Origin Y", &settings.originY);
+    ImGui::DragInt("Width", &settings.width, 64.0f, 1, 65536);
+    ImGui::DragInt("Height", &settings.height, 64.0f, 1, 65536);
+    ImGui::DragFloat("Texel Size", &settings.texelSize, 0.01f, 0.001f, 100.0f, "%.3f");
+    ImGui::DragInt("Tile Size", &settings.tileSize, 16.0f, 64, 4096);
+
+    float64 gigabytes = static_cast<float64>(settings.width) * settings.height * sizeof(float32) / (1024.0 * 1024.0 * 1024.0);
+    ImGui::Text("Output: %.2f GB, paged through a bounded cache", gigabytes);
+
+    if (ImGui::Button("Export...", ImVec2(-1, 0))) {
+        std::vector<FileFilter> filters = {
+            {"RAW Heightmap (32-bit float)", "*.raw"},
+            {"All Files", "*.*"}
+        };
+        auto result = FileDialog::SaveFile("Export World", filters, "", "raw");
+        if (result.success) {
+            ExportWorld(result.filepath);
+        }
+    }
+
+    ImGui::End();
+}
+
+void NodeGraphEditor::ExportWorld(const String& filepath) {
+    const WorldExportSettings& settings = m_WorldExport;
+    WorldRegion region(settings.originX, settings.originY, static_cast<uint32>(std::max(settings.width, 1)),
+                       static_cast<uint32>(std::max(settings.height, 1)), settings.texelSize);
+
+    PagedHeightfield world(region.width, region.height);
+    if (!world.IsValid()) {
+        return;
+    }
+    if (!m_Graph->ExecuteWorld(region, static_cast<uint32>(std::max(settings.tileSize, 1)), world)) {
+        LOG_ERROR("World export failed");
+        return;
+    }
+    if (m_Graph->GetGenerator()->ExportRAW(world, filepath)) {
+        LOG_INFO("Exported %ux%u world region to: %s", region.width, region.height, filepath.c_str());
+    }
+}
+
 void NodeGraphEditor::SaveGraphAs() {
     // Define file filters
     std::vector<FileFilter> filters = {
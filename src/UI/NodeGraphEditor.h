@@ -5,6 +5,7 @@
 #include "Nodes/GeneratorNodes.h"
 #include "Nodes/ModifierNodes.h"
 #include "Nodes/ErosionNodes.h"
+#include "Nodes/LayerNodes.h"
 #include "Nodes/TextureNodes.h"
 #include "Nodes/MeshExportNodes.h"
 #include "Serialization/GraphSerializer.h"
@@ -19,6 +20,17 @@ struct NodeEditorState {
     glm::vec2 nodeListPos;
 };
 
+// World export: the output node's graph generated over a world region,
+// tile by tile, into a paged heightfield
+struct WorldExportSettings {
+    int32 originX = 0;  // In texels
+    int32 originY = 0;
+    int32 width = 16384;
+    int32 height = 16384;
+    float32 texelSize = 1.0f;
+    int32 tileSize = 1024;
+};
+
 class NodeGraphEditor {
 public:
     NodeGraphEditor();
@@ -52,6 +64,8 @@ private:
     void RenderNodeList();
     void RenderNodeCanvas();
     void RenderNodeProperties();
+    void RenderWorldExportWindow();
+    void ExportWorld(const String& filepath);
 
     // Node creation
     void ShowNodeCreationPopup();
@@ -70,6 +84,8 @@ private:
     Unique<GraphSerializer> m_Serializer;
     Unique<RecentFilesManager> m_RecentFiles;
     NodeEditorState m_State;
+    WorldExportSettings m_WorldExport;
+    bool m_ShowWorldExport = false;
 
     // UI state
     Node* m_SelectedNode = nullptr;
@@ -392,6 +392,15 @@ void TerrainEditor::RenderParametersPanel() {
     paramsChanged |= ImGui::SliderFloat("Lacunarity", &m_State.perlinParams.lacunarity, 1.5f, 3.0f);
     paramsChanged |= ImGui::SliderFloat("Persistence", &m_State.perlinParams.persistence, 0.1f, 0.9f);
 
+    // Noise backend; GPU can only be chosen when Vulkan initialized
+    const char* backends[] = { "Auto", "GPU", "CPU" };
+    int backend = static_cast<int>(m_Generator->GetNoiseBackend());
+    if (ImGui::Combo("Backend", &backend, backends, IM_ARRAYSIZE(backends)) &&
+        (static_cast<NoiseBackend>(backend) != NoiseBackend::GPU || m_Generator->IsGPUAvailable())) {
+        m_Generator->SetNoiseBackend(static_cast<NoiseBackend>(backend));
+        paramsChanged = true;
+    }
+
     ImGui::Spacing();
 
     // Seed
@@ -1,6 +1,14 @@
+#include "Core/BufferPool.h"
+#include "Core/CounterRNG.h"
+#include "Core/JobSystem.h"
 #include "Core/Logger.h"
+#include "Core/PageMemory.h"
 #include "Core/Types.h"
+#include "Nodes/DiskCache.h"
+#include "Nodes/NodeCache.h"
+#include "Terrain/TerrainGenerator.h"
 #include "UI/Application.h"
+#include <cstring>
 
 using namespace Terrain;
 
@@ -13,6 +21,52 @@ int main(int argc, char** argv) {
     LOG_INFO("Terrain Engine Pro v0.3 - Editor");
     LOG_INFO("========================================");
 
+    // Optional persistent node result cache, shareable between processes.
+    // On multi-socket machines --pin-threads keeps each worker on the node
+    // its buffers were placed on, and --huge-pages maps large buffers from
+    // the reserved huge page pool. --noise-backend cpu generates noise
+    // without Vulkan (the automatic fallback when it is unavailable).
+    // --self-test runs the built-in checks and exits.
+    PageMemoryOptions memoryOptions;
+    bool pinThreads = false;
+    bool selfTestOnly = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            DiskCache::Get().SetDirectory(argv[++i]);
+        } else if (std::strcmp(argv[i], "--self-test") == 0) {
+            selfTestOnly = true;
+        } else if (std::strcmp(argv[i], "--pin-threads") == 0) {
+            pinThreads = true;
+        } else if (std::strcmp(argv[i], "--huge-pages") == 0) {
+            memoryOptions.explicitHugePages = true;
+        } else if (std::strcmp(argv[i], "--noise-backend") == 0 && i + 1 < argc) {
+            const char* backend = argv[++i];
+            if (std::strcmp(backend, "cpu") == 0) {
+                TerrainGenerator::SetDefaultNoiseBackend(NoiseBackend::CPU);
+            } else if (std::strcmp(backend, "gpu") == 0) {
+                TerrainGenerator::SetDefaultNoiseBackend(NoiseBackend::GPU);
+            } else if (std::strcmp(backend, "auto") != 0) {
+                LOG_WARN("Unknown noise backend '%s'; using auto", backend);
+            }
+        }
+    }
+
+    // Random nodes all rely on the Philox generator, so a build whose
+    // intrinsics change its output is reported up front
+    bool selfTestPassed = CounterRNG::SelfTest();
+    if (!selfTestPassed) {
+        LOG_ERROR("Self-test failed: seeded nodes will not reproduce saved results");
+    }
+    if (selfTestOnly) {
+        LOG_INFO("Self-test %s", selfTestPassed ? "passed" : "failed");
+        return selfTestPassed ? 0 : 1;
+    }
+
+    PageMemory::Get().SetOptions(memoryOptions);
+    if (pinThreads) {
+        JobSystem::Get().SetThreadPinning(true);
+    }
+
     // Create and initialize application
     Application app;
     if (!app.Initialize()) {
@@ -26,6 +80,12 @@ int main(int argc, char** argv) {
     // Cleanup
     app.Shutdown();
 
+    NodeCache::Get().WaitForWrites();
+    NodeCache::Get().LogStats();
+    BufferPool<float32>::Get().LogStats("Sample");
+    BufferPool<uint8>::Get().LogStats("Byte");
+    PageMemory::Get().LogStats();
+
     LOG_INFO("Application shutting down");
     return 0;
 }